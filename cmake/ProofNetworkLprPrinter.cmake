@@ -1,10 +1,12 @@
 proof_add_target_sources(NetworkLprPrinter
     src/proofnetwork/lprprinter/errormessages.cpp
+    src/proofnetwork/lprprinter/ippapi.cpp
     src/proofnetwork/lprprinter/lprprinterapi.cpp
     src/proofnetwork/lprprinter/proofnetworklprprinter_init.cpp
 )
 
 proof_add_target_headers(NetworkLprPrinter
+    include/proofnetwork/lprprinter/ippapi.h
     include/proofnetwork/lprprinter/lprprinterapi.h
     include/proofnetwork/lprprinter/proofnetworklprprinter_global.h
     include/proofnetwork/lprprinter/proofnetworklprprinter_types.h
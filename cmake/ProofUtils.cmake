@@ -3,6 +3,13 @@ proof_add_target_sources(Utils
     src/proofutils/epllabelgenerator.cpp
     src/proofutils/qrcodegenerator.cpp
     src/proofutils/labelprinter.cpp
+    src/proofutils/labelpipeline.cpp
+    src/proofutils/labelprinterpool.cpp
+    src/proofutils/labelprinterregistry.cpp
+    src/proofutils/printlane.cpp
+    src/proofutils/printspool.cpp
+    src/proofutils/printcapture.cpp
+    src/proofutils/printercapabilities.cpp
 )
 
 proof_add_target_headers(Utils
@@ -10,12 +17,36 @@ proof_add_target_headers(Utils
     include/proofutils/epllabelgenerator.h
     include/proofutils/qrcodegenerator.h
     include/proofutils/labelprinter.h
+    include/proofutils/labelpipeline.h
+    include/proofutils/labelprinterpool.h
+    include/proofutils/labelprinterregistry.h
     include/proofutils/basic_package.h
+    include/proofutils/printspool.h
+    include/proofutils/printcapture.h
+    include/proofutils/printercapabilities.h
+)
+
+proof_add_target_private_headers(Utils
+    include/private/proofutils/printlane_p.h
 )
 
 if (NOT ANDROID)
-    proof_add_target_sources(Utils src/proofutils/lprprinter.cpp)
+    proof_add_target_sources(Utils
+        src/proofutils/lprprinter.cpp
+        src/proofutils/lprcommandrunner.cpp
+        src/proofutils/printjobtracker.cpp
+        src/proofutils/printratelimiter.cpp
+        src/proofutils/rawsocketsender.cpp
+        src/proofutils/snmpstatuspoller.cpp
+    )
     proof_add_target_headers(Utils include/proofutils/lprprinter.h)
+    proof_add_target_private_headers(Utils
+        include/private/proofutils/lprcommandrunner_p.h
+        include/private/proofutils/printjobtracker_p.h
+        include/private/proofutils/printratelimiter_p.h
+        include/private/proofutils/rawsocketsender_p.h
+        include/private/proofutils/snmpstatuspoller_p.h
+    )
 endif()
 
 find_package(QRencode REQUIRED)
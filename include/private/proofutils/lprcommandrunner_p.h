@@ -0,0 +1,97 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef PROOF_UTILS_LPRCOMMANDRUNNER_P_H
+#define PROOF_UTILS_LPRCOMMANDRUNNER_P_H
+
+#include "proofseed/asynqro_extra.h"
+
+#include "proofutils/proofutils_global.h"
+
+#include <QProcess>
+#include <QScopedPointer>
+#include <QStringList>
+
+#include <functional>
+
+namespace Proof {
+
+struct LprCommandResult
+{
+    QProcess::ProcessError error = QProcess::UnknownError;
+    int exitCode = 0;
+    QByteArray standardOutput;
+    QByteArray standardError;
+    bool aborted = false;
+
+    bool isStarted() const { return error != QProcess::FailedToStart; }
+    bool isSucceeded() const { return !aborted && error == QProcess::UnknownError && !exitCode; }
+};
+
+// Runs lpr/lpq/lpoptions without blocking any thread.
+// All processes live in one dedicated thread and are driven by QProcess signals,
+// futures are filled when process finishes, fails to start or times out.
+class LprCommandRunnerPrivate;
+class PROOF_UTILS_EXPORT LprCommandRunner
+{
+    Q_DECLARE_PRIVATE(LprCommandRunner)
+public:
+    using CommandHandler = std::function<Future<LprCommandResult>(const QString &program,
+                                                                  const QStringList &arguments,
+                                                                  const QByteArray &input)>;
+
+    LprCommandRunner();
+    LprCommandRunner(const LprCommandRunner &other) = delete;
+    LprCommandRunner &operator=(const LprCommandRunner &other) = delete;
+    LprCommandRunner(LprCommandRunner &&other) = delete;
+    LprCommandRunner &operator=(LprCommandRunner &&other) = delete;
+    ~LprCommandRunner();
+
+    static LprCommandRunner *instance();
+
+    int maxParallelProcesses() const;
+    void setMaxParallelProcesses(int count);
+    int timeout() const;
+    void setTimeout(int msecs);
+
+    Future<LprCommandResult> run(const QString &program, const QStringList &arguments,
+                                 const QByteArray &input = QByteArray());
+    // Command is not started or its process is killed as soon as abortSignal fails
+    Future<LprCommandResult> run(const QString &program, const QStringList &arguments, const QByteArray &input,
+                                 const Future<bool> &abortSignal);
+
+    // Handler is called from runner thread instead of starting process, used to emulate lpr tools in tests.
+    // Empty handler restores processes
+    void setCommandHandler(const CommandHandler &handler);
+
+    // Calls callback from runner thread after delay
+    void runLater(int msecs, const std::function<void()> &callback);
+
+private:
+    QScopedPointer<LprCommandRunnerPrivate> d_ptr;
+};
+
+} // namespace Proof
+
+#endif // PROOF_UTILS_LPRCOMMANDRUNNER_P_H
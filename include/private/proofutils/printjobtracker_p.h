@@ -0,0 +1,96 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef PROOF_UTILS_PRINTJOBTRACKER_P_H
+#define PROOF_UTILS_PRINTJOBTRACKER_P_H
+
+#include "proofseed/asynqro_extra.h"
+
+#include "proofutils/proofutils_global.h"
+
+#include <QEnableSharedFromThis>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QStringList>
+
+namespace Proof {
+
+// Follows jobs in spooler queue of one printer.
+// Jobs are recognized by their unique titles, one lpq poll is shared by all tracked jobs of the printer.
+// Job is considered printed once it is not in the queue anymore. Job that left the queue before its id was known,
+// either from submission or from lpq, can't be told apart from lost one and is reported as failed.
+class PROOF_UTILS_EXPORT PrintJobTracker : public QEnableSharedFromThis<PrintJobTracker>
+{
+public:
+    PrintJobTracker(const PrintJobTracker &other) = delete;
+    PrintJobTracker &operator=(const PrintJobTracker &other) = delete;
+    PrintJobTracker(PrintJobTracker &&other) = delete;
+    PrintJobTracker &operator=(PrintJobTracker &&other) = delete;
+    ~PrintJobTracker();
+
+    static QSharedPointer<PrintJobTracker> forPrinter(const QString &printerHost, const QString &printerName);
+    static QString uniqueJobTitle();
+    // Returns spooler job id for each of titles found in queue, id is empty if it can't be recognized
+    static QHash<QString, QString> parseQueue(const QString &queueInfo, const QStringList &titles);
+    // Takes job id from lp output like "request id is Zebra-1033 (1 file(s))", empty if it is not there
+    static QString parseRequestId(const QString &submissionOutput);
+
+    QString key() const;
+
+    void setQueueCommand(const QString &program, const QStringList &arguments);
+    int pollInterval() const;
+    void setPollInterval(int msecs);
+    int trackedCount() const;
+
+    // Filled with spooler job id when job leaves spooler queue, jobId is the one reported on submission if any
+    Future<QString> track(const QString &jobTitle, const QString &jobId = QString());
+
+private:
+    struct TrackedJob
+    {
+        Promise<QString> promise;
+        QString jobId;
+    };
+
+    explicit PrintJobTracker(const QString &key);
+    void schedulePoll();
+    void poll();
+    void pollFinished(bool succeeded, const QString &queueInfo);
+
+    const QString m_key;
+    mutable QMutex m_mutex;
+    QHash<QString, TrackedJob> m_jobs;
+    QString m_program;
+    QStringList m_arguments;
+    int m_pollInterval = 1000;
+    int m_failedPolls = 0;
+    bool m_polling = false;
+};
+
+using PrintJobTrackerSP = QSharedPointer<PrintJobTracker>;
+
+} // namespace Proof
+
+#endif // PROOF_UTILS_PRINTJOBTRACKER_P_H
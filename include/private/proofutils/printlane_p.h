@@ -0,0 +1,146 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef PROOF_UTILS_PRINTLANE_P_H
+#define PROOF_UTILS_PRINTLANE_P_H
+
+#include "proofseed/asynqro_extra.h"
+
+#include "proofutils/proofutils_global.h"
+
+#include <QElapsedTimer>
+#include <QEnableSharedFromThis>
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QQueue>
+#include <QSharedPointer>
+
+#include <array>
+#include <functional>
+
+namespace Proof {
+
+// Ordered execution lane for one physical printer.
+// Jobs of the same priority are started strictly in the order they were added, no more than capacity() of them
+// at once. Higher priorities go first, waiting job is promoted by one priority class every agingInterval() msecs.
+// Queued and running jobs can be limited by count and payload size, overflowPolicy() decides what to do with job
+// that doesn't fit. Blocked jobs wait outside of queue and are admitted in order once there is enough room.
+// Lanes are shared between all printer objects that point to the same printer.
+class PROOF_UTILS_EXPORT PrintLane : public QEnableSharedFromThis<PrintLane>
+{
+public:
+    using Job = std::function<Future<bool>()>;
+    // Gets future of its own result, which fails as soon as job is canceled
+    using CancelableJob = std::function<Future<bool>(const Future<bool> &)>;
+    using Observer = std::function<void()>;
+
+    PrintLane(const PrintLane &other) = delete;
+    PrintLane &operator=(const PrintLane &other) = delete;
+    PrintLane(PrintLane &&other) = delete;
+    PrintLane &operator=(PrintLane &&other) = delete;
+    ~PrintLane();
+
+    static QSharedPointer<PrintLane> forPrinter(const QString &printerHost, const QString &printerName);
+
+    QString key() const;
+
+    int capacity() const;
+    void setCapacity(int capacity);
+
+    int agingInterval() const;
+    void setAgingInterval(int msecs);
+
+    int maxJobs() const;
+    void setMaxJobs(int jobs);
+    qint64 maxBytes() const;
+    void setMaxBytes(qint64 bytes);
+    PrintQueueOverflowPolicy overflowPolicy() const;
+    void setOverflowPolicy(PrintQueueOverflowPolicy policy);
+
+    int queuedCount() const;
+    int queuedCount(PrintPriority priority) const;
+    int runningCount() const;
+    int blockedCount() const;
+    qint64 bytesCount() const;
+    int availableJobs() const;
+    qint64 availableBytes() const;
+    // Whether job of this size would be admitted right now without overflow policy
+    bool canAdmit(qint64 bytes) const;
+
+    // Observers are called after any change of queue state, from the thread that made this change
+    int addObserver(const Observer &observer);
+    void removeObserver(int id);
+
+    // Canceled job is removed from queue if it is not started yet
+    CancelableFuture<bool> enqueue(const Job &job, PrintPriority priority = PrintPriority::Normal, qint64 bytes = 0);
+    CancelableFuture<bool> enqueue(const CancelableJob &job, PrintPriority priority = PrintPriority::Normal,
+                                   qint64 bytes = 0);
+
+private:
+    struct QueuedJob
+    {
+        CancelableJob job;
+        Promise<bool> promise;
+        qint64 enqueuedAt = 0;
+        qint64 bytes = 0;
+        quint64 order = 0;
+    };
+
+    explicit PrintLane(const QString &key);
+    bool fits(qint64 bytes) const;
+    void admit(const QueuedJob &job, PrintPriority priority);
+    void admitBlocked();
+    bool dropOldest(QVector<QueuedJob> &dropped);
+    void dropCanceled(quint64 order);
+    int nextQueueIndex() const;
+    void pump();
+    void jobFinished(qint64 bytes);
+    void notifyObservers();
+
+    const QString m_key;
+    mutable QMutex m_mutex;
+    std::array<QQueue<QueuedJob>, 3> m_queues;
+    QQueue<QPair<QueuedJob, PrintPriority>> m_blocked;
+    QElapsedTimer m_clock;
+    int m_capacity = 1;
+    int m_agingInterval = 5000;
+    int m_running = 0;
+    quint64 m_lastOrder = 0;
+    int m_jobs = 0;
+    qint64 m_bytes = 0;
+    int m_maxJobs = 0;
+    qint64 m_maxBytes = 0;
+    PrintQueueOverflowPolicy m_overflowPolicy = PrintQueueOverflowPolicy::Reject;
+
+    mutable QMutex m_observersMutex{QMutex::Recursive};
+    QHash<int, Observer> m_observers;
+    int m_lastObserverId = 0;
+};
+
+using PrintLaneSP = QSharedPointer<PrintLane>;
+
+} // namespace Proof
+
+#endif // PROOF_UTILS_PRINTLANE_P_H
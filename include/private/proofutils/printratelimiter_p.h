@@ -0,0 +1,83 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef PROOF_UTILS_PRINTRATELIMITER_P_H
+#define PROOF_UTILS_PRINTRATELIMITER_P_H
+
+#include "proofseed/asynqro_extra.h"
+
+#include "proofutils/proofutils_global.h"
+
+#include <QElapsedTimer>
+#include <QEnableSharedFromThis>
+#include <QMutex>
+#include <QSharedPointer>
+
+namespace Proof {
+
+// Token bucket that paces jobs to mechanical speed of printer.
+// Bucket holds free slots of printer buffer, each printed label takes one slot and slots are freed with print rate.
+// Job is sent once there are enough free slots for it or buffer is empty for jobs bigger than buffer.
+class PROOF_UTILS_EXPORT PrintRateLimiter : public QEnableSharedFromThis<PrintRateLimiter>
+{
+public:
+    explicit PrintRateLimiter(double labelsPerSecond = 0.0, int burst = 1);
+    PrintRateLimiter(const PrintRateLimiter &other) = delete;
+    PrintRateLimiter &operator=(const PrintRateLimiter &other) = delete;
+    PrintRateLimiter(PrintRateLimiter &&other) = delete;
+    PrintRateLimiter &operator=(PrintRateLimiter &&other) = delete;
+    ~PrintRateLimiter() = default;
+
+    // Sums EPL print commands, data without them is counted as one label
+    static int labelsCount(const QByteArray &data);
+
+    // 0 disables limiting
+    double rate() const;
+    int burst() const;
+    void setRate(double labelsPerSecond, int burst = 1);
+    bool isEnabled() const;
+
+    // Reserves slots for job and returns delay in msecs before job can be sent
+    qint64 reserve(int labels);
+    // Returns slots of job that was not sent
+    void release(int labels);
+    // Filled after reserved delay, fails with PrintJobCanceled if canceled is failed by that time
+    Future<bool> acquire(int labels, const Future<bool> &canceled);
+
+private:
+    void refill();
+
+    mutable QMutex m_mutex;
+    QElapsedTimer m_clock;
+    double m_rate = 0.0;
+    int m_burst = 1;
+    double m_tokens = 1.0;
+    qint64 m_refilledAt = 0;
+};
+
+using PrintRateLimiterSP = QSharedPointer<PrintRateLimiter>;
+
+} // namespace Proof
+
+#endif // PROOF_UTILS_PRINTRATELIMITER_P_H
@@ -0,0 +1,53 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef PROOF_UTILS_RAWSOCKETSENDER_P_H
+#define PROOF_UTILS_RAWSOCKETSENDER_P_H
+
+#include "proofseed/asynqro_extra.h"
+
+#include "proofutils/proofutils_global.h"
+
+#include <functional>
+
+namespace Proof {
+
+// Streams files to printer raw port (JetDirect, usually 9100) with constant memory use.
+// On Linux file is sent by kernel with sendfile, on other platforms it is sent in fixed size chunks.
+// Sending is done in its own thread pool, progress callback is called from there.
+class PROOF_UTILS_EXPORT RawSocketSender
+{
+public:
+    using ProgressCallback = std::function<void(qint64 bytesSent, qint64 bytesTotal)>;
+
+    RawSocketSender() = delete;
+
+    static Future<bool> sendFile(const QString &host, int port, const QString &fileName, unsigned int copies,
+                                 const Future<bool> &canceled, const ProgressCallback &progress = ProgressCallback(),
+                                 int timeout = 30000);
+};
+
+} // namespace Proof
+
+#endif // PROOF_UTILS_RAWSOCKETSENDER_P_H
@@ -0,0 +1,133 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef PROOF_UTILS_SNMPSTATUSPOLLER_P_H
+#define PROOF_UTILS_SNMPSTATUSPOLLER_P_H
+
+#include "proofseed/asynqro_extra.h"
+
+#include "proofutils/proofutils_global.h"
+
+#include <QScopedPointer>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+namespace Proof {
+
+struct PROOF_UTILS_EXPORT SnmpVarBind
+{
+    // Dotted form without leading dot
+    QString oid;
+    // Integer types are qint64, strings are QByteArray, NULL and missing objects are invalid QVariant
+    QVariant value;
+};
+
+struct PROOF_UTILS_EXPORT SnmpMessage
+{
+    enum PduType
+    {
+        GetRequest = 0xa0,
+        GetResponse = 0xa2
+    };
+
+    QByteArray community;
+    int pduType = GetRequest;
+    qint32 requestId = 0;
+    int errorStatus = 0;
+    int errorIndex = 0;
+    QVector<SnmpVarBind> varBinds;
+
+    // SNMPv2c BER encoding
+    QByteArray encode() const;
+    static bool decode(const QByteArray &datagram, SnmpMessage *message);
+};
+
+// Host Resources MIB printer state
+struct PROOF_UTILS_EXPORT SnmpPrinterStatus
+{
+    static const QString HR_DEVICE_STATUS_OID;
+    static const QString HR_PRINTER_STATUS_OID;
+    static const QString HR_PRINTER_DETECTED_ERROR_STATE_OID;
+
+    enum class DeviceStatus
+    {
+        Unknown = 1,
+        Running = 2,
+        Warning = 3,
+        Testing = 4,
+        Down = 5
+    };
+    enum class PrinterStatus
+    {
+        Other = 1,
+        Unknown = 2,
+        Idle = 3,
+        Printing = 4,
+        WarmUp = 5
+    };
+
+    DeviceStatus deviceStatus = DeviceStatus::Unknown;
+    PrinterStatus printerStatus = PrinterStatus::Unknown;
+    QByteArray detectedErrorState;
+
+    static SnmpPrinterStatus fromVarBinds(const QVector<SnmpVarBind> &varBinds);
+    // Detected errors that are set in error state bitmask, media and supply warnings included
+    QStringList errors() const;
+    bool isReady() const;
+    QString reason() const;
+};
+
+// Polls printers with SNMPv2c GET requests from one UDP socket in its own thread.
+// All status objects are requested in one datagram, concurrent requests to the same printer share one datagram.
+class SnmpStatusPollerPrivate;
+class PROOF_UTILS_EXPORT SnmpStatusPoller
+{
+    Q_DECLARE_PRIVATE(SnmpStatusPoller)
+public:
+    SnmpStatusPoller();
+    SnmpStatusPoller(const SnmpStatusPoller &other) = delete;
+    SnmpStatusPoller &operator=(const SnmpStatusPoller &other) = delete;
+    SnmpStatusPoller(SnmpStatusPoller &&other) = delete;
+    SnmpStatusPoller &operator=(SnmpStatusPoller &&other) = delete;
+    ~SnmpStatusPoller();
+
+    static SnmpStatusPoller *instance();
+
+    // Per attempt
+    int timeout() const;
+    void setTimeout(int msecs);
+    int retries() const;
+    void setRetries(int retries);
+
+    Future<SnmpPrinterStatus> fetchStatus(const QString &host, int port = 161,
+                                          const QByteArray &community = QByteArrayLiteral("public"));
+
+private:
+    QScopedPointer<SnmpStatusPollerPrivate> d_ptr;
+};
+
+} // namespace Proof
+
+#endif // PROOF_UTILS_SNMPSTATUSPOLLER_P_H
@@ -0,0 +1,110 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef PROOF_NETWORKSERVICES_IPPAPI_H
+#define PROOF_NETWORKSERVICES_IPPAPI_H
+
+#include "proofnetworklprprinter_global.h"
+
+#include "proofnetwork/baserestapi.h"
+
+#include <QString>
+#include <QStringList>
+
+namespace Proof {
+namespace NetworkServices {
+
+struct PROOF_NETWORK_LPRPRINTER_EXPORT IppPrinterStatus
+{
+    enum class State
+    {
+        Unknown = 0,
+        Idle = 3,
+        Processing = 4,
+        Stopped = 5
+    };
+
+    State state = State::Unknown;
+    QStringList stateReasons;
+    int queuedJobCount = 0;
+    bool isAcceptingJobs = true;
+
+    bool isReady() const;
+    QString reason() const;
+};
+
+struct PROOF_NETWORK_LPRPRINTER_EXPORT IppJobStatus
+{
+    enum class State
+    {
+        Unknown = 0,
+        Pending = 3,
+        PendingHeld = 4,
+        Processing = 5,
+        ProcessingStopped = 6,
+        Canceled = 7,
+        Aborted = 8,
+        Completed = 9
+    };
+
+    State state = State::Unknown;
+    QStringList stateReasons;
+
+    bool isFinished() const;
+};
+
+struct PROOF_NETWORK_LPRPRINTER_EXPORT IppPrinterCapabilities
+{
+    QString makeAndModel;
+    // Dots per inch, 0 if printer doesn't report it
+    int resolution = 0;
+    QString mediaName;
+    // Default media size in hundredths of millimeter, 0 if it can't be taken from media name
+    int mediaWidth = 0;
+    int mediaLength = 0;
+    QStringList documentFormats;
+};
+
+// Minimal IPP/1.1 client (RFC 8011) over plain HTTP, usually pointed to CUPS at port 631.
+class IppApiPrivate;
+class PROOF_NETWORK_LPRPRINTER_EXPORT IppApi : public BaseRestApi
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(IppApi)
+public:
+    explicit IppApi(const RestClientSP &restClient, QObject *parent = nullptr);
+
+    CancelableFuture<IppPrinterStatus> fetchPrinterStatus(const QString &printer);
+    CancelableFuture<IppPrinterCapabilities> fetchPrinterCapabilities(const QString &printer);
+    CancelableFuture<IppJobStatus> fetchJobStatus(const QString &printer, int jobId);
+};
+
+} // namespace NetworkServices
+} // namespace Proof
+
+Q_DECLARE_METATYPE(Proof::NetworkServices::IppPrinterStatus)
+Q_DECLARE_METATYPE(Proof::NetworkServices::IppPrinterCapabilities)
+Q_DECLARE_METATYPE(Proof::NetworkServices::IppJobStatus)
+
+#endif // PROOF_NETWORKSERVICES_IPPAPI_H
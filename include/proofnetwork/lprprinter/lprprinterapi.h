@@ -48,16 +48,50 @@ struct PROOF_NETWORK_LPRPRINTER_EXPORT LprPrinterInfo
     bool acceptsFiles = false;
 };
 
+struct PROOF_NETWORK_LPRPRINTER_EXPORT LprPrintResult
+{
+    bool isPrinted = false;
+    QString reason;
+};
+
 class LprPrinterApiPrivate;
 class PROOF_NETWORK_LPRPRINTER_EXPORT LprPrinterApi : public ProofServiceRestApi
 {
     Q_OBJECT
     Q_DECLARE_PRIVATE(LprPrinterApi)
 public:
+    enum class LabelUploadMode
+    {
+        // Raw bytes are sent to binary endpoint until service reports it doesn't have one
+        Auto,
+        // Default, base64 in JSON is understood by all services
+        Json,
+        Binary
+    };
+
     explicit LprPrinterApi(const RestClientSP &restClient, QObject *parent = nullptr);
 
+    LabelUploadMode labelUploadMode() const;
+    void setLabelUploadMode(LabelUploadMode mode);
+    int batchSize() const;
+    void setBatchSize(int size);
+    // Binary labels and batches not smaller than threshold are sent with Content-Encoding: deflate
+    // if service reports support for it in /lpr/capabilities. Files are never compressed
+    bool compressionEnabled() const;
+    void setCompressionEnabled(bool enabled);
+    int compressionThreshold() const;
+    void setCompressionThreshold(int bytes);
+    bool compressionIsSupported() const;
+
+    // Also updates compressionIsSupported, it is fetched automatically when compression is enabled
+    Future<bool> fetchCompressionSupport();
     CancelableFuture<LprPrinterStatus> fetchStatus(const QString &printer = QString());
     CancelableFuture<bool> printLabel(const QByteArray &label, const QString &printer = QString());
+    // Labels are sent in batches of batchSize() labels, each label gets its own result.
+    // Labels of batch that wasn't delivered and all labels after it are marked as not printed
+    CancelableFuture<QVector<LprPrintResult>> printLabels(const QVector<QByteArray> &labels,
+                                                          const QString &printer = QString());
+    // File is memory mapped and sent as request body without reading it whole
     CancelableFuture<bool> printFile(const QString &fileName, const QString &printer = QString(),
                                      unsigned int copies = 1);
     CancelableFuture<QVector<LprPrinterInfo>> fetchPrintersList();
@@ -68,5 +102,6 @@ public:
 
 Q_DECLARE_METATYPE(Proof::NetworkServices::LprPrinterStatus)
 Q_DECLARE_METATYPE(Proof::NetworkServices::LprPrinterInfo)
+Q_DECLARE_METATYPE(Proof::NetworkServices::LprPrintResult)
 
 #endif // PROOF_NETWORKSERVICES_LPRPRINTERAPI_H
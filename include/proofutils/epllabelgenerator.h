@@ -31,6 +31,18 @@
 
 namespace Proof {
 
+struct EplLabelProfile
+{
+    int dpi = 203;
+    int width = 795;
+    int height = 1250;
+    int speed = 4;
+    int density = 10;
+    int gapLength = 24;
+    // QR codes are rendered by printer with b command instead of being sent as bitmaps
+    bool nativeQrCode = false;
+};
+
 class EplLabelGeneratorPrivate;
 class PROOF_UTILS_EXPORT EplLabelGenerator
 {
@@ -81,6 +93,7 @@ public:
     };
 
     explicit EplLabelGenerator(int printerDpi = 203);
+    explicit EplLabelGenerator(const EplLabelProfile &profile);
     EplLabelGenerator(const EplLabelGenerator &other) = delete;
     EplLabelGenerator &operator=(const EplLabelGenerator &other) = delete;
     EplLabelGenerator(EplLabelGenerator &&other) = delete;
@@ -88,12 +101,16 @@ public:
     virtual ~EplLabelGenerator();
 
     void startLabel(int width = 795, int height = 1250, int speed = 4, int density = 10, int gapLength = 24);
+    void startLabel(const EplLabelProfile &profile);
+    EplLabelProfile profile() const;
 
     QRect addText(const QString &text, int x, int y, int fontSize = 4, int horizontalScale = 1, int verticalScale = 1,
                   int rotation = 0, bool inverseColors = false);
 
     QSize textSize(const QString &text, int fontSize = 4, int horizontalScale = 1, int verticalScale = 1) const;
     QSize labelSize() const;
+    // Mechanical print rate of current label setup, speed setting is treated as inches per second
+    double labelsPerSecond() const;
 
     QRect addBarcode(const QString &data, BarcodeType type, int x, int y, int height = 200,
                      bool printReadableCode = true, int narrowBarWidth = 2, int wideBarWidth = 4, int rotation = 0);
@@ -109,6 +126,12 @@ public:
 
     QByteArray labelData() const;
 
+    // Rewrites print command of label to print copies of it if it is the only one and comes last,
+    // otherwise label is repeated
+    static QByteArray labelWithCopies(const QByteArray &label, int copies);
+    // Sum of all print commands, at least 1
+    static int printedLabelsCount(const QByteArray &data);
+
 private:
     QScopedPointer<EplLabelGeneratorPrivate> d_ptr;
 };
@@ -0,0 +1,94 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef PROOF_UTILS_LABELPIPELINE_H
+#define PROOF_UTILS_LABELPIPELINE_H
+
+#include "proofseed/asynqro_extra.h"
+
+#include "proofcore/proofobject.h"
+
+#include "proofutils/epllabelgenerator.h"
+#include "proofutils/labelprinter.h"
+#include "proofutils/proofutils_global.h"
+
+#include <functional>
+
+namespace Proof {
+
+// Summary time spent by labels in each stage, in microseconds
+struct LabelPipelineStats
+{
+    int generated = 0;
+    int printed = 0;
+    int failed = 0;
+    // Waiting for free generation thread or for space in generated labels queue
+    qint64 inputWaitTime = 0;
+    qint64 generationTime = 0;
+    // Waiting in generated labels queue for printer
+    qint64 outputWaitTime = 0;
+    qint64 printTime = 0;
+};
+
+// Builds labels with EplLabelGenerator in worker threads while previous labels are sent to printer.
+// Stages are connected with bounded queue, generation stops when queue is full until printer takes labels from it.
+// Labels are sent to printer in order they were added.
+// Queued labels are canceled when pipeline is destroyed, labels already sent to printer should be finished before it.
+class LabelPipelinePrivate;
+class PROOF_UTILS_EXPORT LabelPipeline : public ProofObject
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(LabelPipeline)
+public:
+    // Fills label content, label is started with pipeline profile and print command is added after it
+    using LabelBuilder = std::function<void(EplLabelGenerator &generator)>;
+
+    explicit LabelPipeline(LabelPrinter *printer, const EplLabelProfile &profile = EplLabelProfile(),
+                           QObject *parent = nullptr);
+    LabelPipeline(const LabelPipeline &other) = delete;
+    LabelPipeline &operator=(const LabelPipeline &other) = delete;
+    LabelPipeline(LabelPipeline &&other) = delete;
+    LabelPipeline &operator=(LabelPipeline &&other) = delete;
+    ~LabelPipeline();
+
+    CancelableFuture<bool> addLabel(const LabelBuilder &builder, int copies = 1,
+                                    PrintPriority priority = PrintPriority::Normal) const;
+    Future<bool> addLabels(const QVector<LabelBuilder> &builders,
+                           PrintPriority priority = PrintPriority::Normal) const;
+
+    int pendingLabelsCount() const;
+    LabelPipelineStats stats() const;
+    void resetStats();
+
+    int generationThreads() const;
+    void setGenerationThreads(int threads);
+    int queueCapacity() const;
+    void setQueueCapacity(int capacity);
+    int printsInFlight() const;
+    void setPrintsInFlight(int prints);
+};
+
+} // namespace Proof
+
+#endif // PROOF_UTILS_LABELPIPELINE_H
@@ -29,6 +29,9 @@
 
 #include "proofcore/proofobject.h"
 
+#include "proofutils/printcapture.h"
+#include "proofutils/printercapabilities.h"
+#include "proofutils/printspool.h"
 #include "proofutils/proofutils_global.h"
 
 namespace Proof {
@@ -43,19 +46,67 @@ struct LabelPrinterParams
           forceServiceUsage(forceServiceUsage), strictHardwareCheck(strictHardwareCheck)
     {}
 
+    bool operator==(const LabelPrinterParams &other) const
+    {
+        return printerTitle == other.printerTitle && printerHost == other.printerHost
+               && printerName == other.printerName && printerPort == other.printerPort
+               && forceServiceUsage == other.forceServiceUsage && strictHardwareCheck == other.strictHardwareCheck
+               && spoolFileName == other.spoolFileName && captureMode == other.captureMode
+               && capturePath == other.capturePath && captureRingSize == other.captureRingSize
+               && transportFailover == other.transportFailover && snmpPort == other.snmpPort
+               && snmpCommunity == other.snmpCommunity && readinessCacheTime == other.readinessCacheTime
+               && serviceLaneCapacity == other.serviceLaneCapacity;
+    }
+    bool operator!=(const LabelPrinterParams &other) const { return !(*this == other); }
+
     QString printerTitle;
     QString printerHost;
     QString printerName;
     int printerPort = 0;
     bool forceServiceUsage = false;
     bool strictHardwareCheck = true;
+    QString spoolFileName;
+    // Labels are captured instead of being printed, used for throughput testing without printers
+    PrintCapture::Mode captureMode = PrintCapture::Mode::None;
+    QString capturePath;
+    int captureRingSize = 1024;
+    // Both local printer and print service are used if possible, each label goes to the healthier one
+    bool transportFailover = false;
+    // Hardware printer status is polled over SNMP instead of lpq if set, usually 161
+    int snmpPort = 0;
+    QByteArray snmpCommunity = QByteArrayLiteral("public");
+    // See LprPrinter::setReadinessCacheTime, caching is off by default
+    int readinessCacheTime = 0;
+    // Requests sent to print service for this printer at once. Lane is shared by all printers
+    // with same service and printer name, so last created one sets it
+    int serviceLaneCapacity = 1;
+};
+
+struct LabelPrinterWarmUpResult
+{
+    QString printerTitle;
+    bool ready = false;
+    long errorCode = 0;
+    QString message;
+    qint64 elapsed = 0;
 };
 
 class PROOF_UTILS_EXPORT LabelPrinter : public ProofObject
 {
     Q_OBJECT
     Q_DECLARE_PRIVATE(LabelPrinter)
+    Q_PROPERTY(int queuedJobsCount READ queuedJobsCount NOTIFY queueChanged)
+    Q_PROPERTY(int runningJobsCount READ runningJobsCount NOTIFY queueChanged)
+    Q_PROPERTY(qint64 queuedBytes READ queuedBytes NOTIFY queueChanged)
+    Q_PROPERTY(int availableJobs READ availableJobs NOTIFY queueChanged)
+    Q_PROPERTY(qint64 availableBytes READ availableBytes NOTIFY queueChanged)
 public:
+    enum class Transport
+    {
+        Hardware,
+        Service
+    };
+
     explicit LabelPrinter(const LabelPrinterParams &params, QObject *parent = nullptr);
     LabelPrinter(const LabelPrinter &other) = delete;
     LabelPrinter &operator=(const LabelPrinter &other) = delete;
@@ -63,9 +114,50 @@ public:
     LabelPrinter &operator=(LabelPrinter &&other) = delete;
     ~LabelPrinter();
 
-    Future<bool> printLabel(const QByteArray &label, bool ignorePrinterState = false) const;
+    // Copies are printed in one job, same as in LprPrinter::printRawData
+    CancelableFuture<bool> printLabel(const QByteArray &label, bool ignorePrinterState = false,
+                                      PrintPriority priority = PrintPriority::Normal, int copies = 1) const;
     Future<bool> printerIsReady() const;
+    // Probes printer and fills its readiness cache, never fails.
+    // Capabilities of hardware printer are probed in background too, so capabilities() is answered from cache
+    Future<LabelPrinterWarmUpResult> warmUp() const;
+    // Printers are probed in parallel, results are in the same order as printers
+    static Future<QVector<LabelPrinterWarmUpResult>> warmUpAll(const QVector<LabelPrinter *> &printers);
+    Future<bool> spoolLabel(const QByteArray &label, bool ignorePrinterState = false,
+                            PrintPriority priority = PrintPriority::Normal) const;
+    Future<bool> replaySpool() const;
     QString title() const;
+    PrintCaptureSP capture() const;
+    // Probed once per printer, only local printers can be probed
+    Future<PrinterCapabilities> capabilities() const;
+
+    bool transportFailoverEnabled() const;
+    // Transport with better rolling score of latency and errors, labels are sent to it first.
+    // It is picked again only when no labels are in flight or when current one fails,
+    // so labels keep their order unless one of them fails over
+    Transport preferredTransport() const;
+    // Failures caused by printer or transport state before label was submitted, another printer or transport
+    // can still succeed. Failures after submission (lpr exit code, broken connection, bad reply) are not
+    // transport ones, since label can already be printed
+    static bool isTransportFailure(const Failure &failure);
+
+    // Same limits as in LprPrinter, for print service they cover requests in flight
+    int maxQueuedJobs() const;
+    void setMaxQueuedJobs(int jobs);
+    qint64 maxQueuedBytes() const;
+    void setMaxQueuedBytes(qint64 bytes);
+    PrintQueueOverflowPolicy overflowPolicy() const;
+    void setOverflowPolicy(PrintQueueOverflowPolicy policy);
+
+    // Jobs waiting for their turn, running ones are counted separately (same as in LprPrinter)
+    int queuedJobsCount() const;
+    int runningJobsCount() const;
+    qint64 queuedBytes() const;
+    int availableJobs() const;
+    qint64 availableBytes() const;
+
+signals:
+    void queueChanged();
 };
 
 } // namespace Proof
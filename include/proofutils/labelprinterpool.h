@@ -0,0 +1,72 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef PROOF_UTILS_LABELPRINTERPOOL_H
+#define PROOF_UTILS_LABELPRINTERPOOL_H
+
+#include "proofseed/asynqro_extra.h"
+
+#include "proofcore/proofobject.h"
+
+#include "proofutils/labelprinter.h"
+#include "proofutils/proofutils_global.h"
+
+namespace Proof {
+
+// Spreads labels across several identical printers by queue depth.
+// Printer that fails because of its state is skipped for recovery interval and its labels go to other printers.
+class LabelPrinterPoolPrivate;
+class PROOF_UTILS_EXPORT LabelPrinterPool : public ProofObject
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(LabelPrinterPool)
+public:
+    explicit LabelPrinterPool(const QVector<LabelPrinterParams> &params, QObject *parent = nullptr);
+    LabelPrinterPool(const LabelPrinterPool &other) = delete;
+    LabelPrinterPool &operator=(const LabelPrinterPool &other) = delete;
+    LabelPrinterPool(LabelPrinterPool &&other) = delete;
+    LabelPrinterPool &operator=(LabelPrinterPool &&other) = delete;
+    ~LabelPrinterPool();
+
+    // Labels with the same group key go to the same printer while any of them is in flight, so they keep order.
+    // Labels without group key have no ordering guarantees
+    CancelableFuture<bool> printLabel(const QByteArray &label, const QString &groupKey = QString(),
+                                      bool ignorePrinterState = false, PrintPriority priority = PrintPriority::Normal,
+                                      int copies = 1) const;
+    Future<QVector<LabelPrinterWarmUpResult>> warmUp() const;
+
+    QVector<LabelPrinter *> printers() const;
+    bool isPrinterHealthy(int index) const;
+    int healthyPrintersCount() const;
+
+    int recoveryInterval() const;
+    void setRecoveryInterval(int msecs);
+
+signals:
+    void printerHealthChanged(int index, bool healthy);
+};
+
+} // namespace Proof
+
+#endif // PROOF_UTILS_LABELPRINTERPOOL_H
@@ -0,0 +1,77 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef PROOF_UTILS_LABELPRINTERREGISTRY_H
+#define PROOF_UTILS_LABELPRINTERREGISTRY_H
+
+#include "proofutils/labelprinter.h"
+#include "proofutils/proofutils_global.h"
+
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QStringList>
+
+namespace Proof {
+class Settings;
+
+using LabelPrinterSP = QSharedPointer<LabelPrinter>;
+
+// Process-wide label printers keyed by printer name.
+// Printers are created on first request and live in main thread, so readiness caches, lanes and connections
+// are shared by all screens.
+class LabelPrinterRegistryPrivate;
+class PROOF_UTILS_EXPORT LabelPrinterRegistry
+{
+    Q_DECLARE_PRIVATE(LabelPrinterRegistry)
+public:
+    LabelPrinterRegistry();
+    LabelPrinterRegistry(const LabelPrinterRegistry &other) = delete;
+    LabelPrinterRegistry &operator=(const LabelPrinterRegistry &other) = delete;
+    LabelPrinterRegistry(LabelPrinterRegistry &&other) = delete;
+    LabelPrinterRegistry &operator=(LabelPrinterRegistry &&other) = delete;
+    ~LabelPrinterRegistry();
+
+    static LabelPrinterRegistry *instance();
+
+    // Reads label_printers list and printer groups, already created printers with changed params are recreated
+    void loadSettings(Settings *settings);
+    static LabelPrinterParams paramsFromSettings(Settings *settings, const QString &name);
+    void registerPrinter(const QString &name, const LabelPrinterParams &params);
+    void clear();
+
+    QStringList printerNames() const;
+    // Printer marked as selected_printer in settings
+    QString selectedPrinterName() const;
+    bool contains(const QString &name) const;
+    // Null if there is no such printer
+    LabelPrinterSP printer(const QString &name) const;
+    LabelPrinterSP selectedPrinter() const;
+
+private:
+    QScopedPointer<LabelPrinterRegistryPrivate> d_ptr;
+};
+
+} // namespace Proof
+
+#endif // PROOF_UTILS_LABELPRINTERREGISTRY_H
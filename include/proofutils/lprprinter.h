@@ -29,22 +29,121 @@
 
 #include "proofcore/proofobject.h"
 
+#include "proofutils/printcapture.h"
+#include "proofutils/printspool.h"
 #include "proofutils/proofutils_global.h"
 
 namespace Proof {
+class EplLabelGenerator;
 namespace Hardware {
 class LprPrinterPrivate;
 class PROOF_UTILS_EXPORT LprPrinter : public ProofObject
 {
     Q_OBJECT
     Q_DECLARE_PRIVATE(LprPrinter)
+    Q_PROPERTY(int queuedJobsCount READ queuedJobsCount NOTIFY queueChanged)
+    Q_PROPERTY(int runningJobsCount READ runningJobsCount NOTIFY queueChanged)
+    Q_PROPERTY(qint64 queuedBytes READ queuedBytes NOTIFY queueChanged)
+    Q_PROPERTY(int availableJobs READ availableJobs NOTIFY queueChanged)
+    Q_PROPERTY(qint64 availableBytes READ availableBytes NOTIFY queueChanged)
 public:
+    enum class StatusSource
+    {
+        LprUtilities,
+        Ipp,
+        Snmp
+    };
+
     explicit LprPrinter(const QString &printerHost, const QString &printerName, bool strictPrinterCheck = false,
                         QObject *parent = nullptr);
+    LprPrinter(const LprPrinter &other) = delete;
+    LprPrinter &operator=(const LprPrinter &other) = delete;
+    LprPrinter(LprPrinter &&other) = delete;
+    LprPrinter &operator=(LprPrinter &&other) = delete;
+    ~LprPrinter();
 
-    Future<bool> printRawData(const QByteArray &data, bool ignorePrinterState = false) const;
-    Future<bool> printFile(const QString &fileName, unsigned int quantity = 1, bool ignorePrinterState = false) const;
+    // Canceled job is removed from queue, or its lpr process is killed if job is already running.
+    // Copies are sent in one job, EPL print command is rewritten if possible, otherwise data is repeated
+    CancelableFuture<bool> printRawData(const QByteArray &data, bool ignorePrinterState = false,
+                                        PrintPriority priority = PrintPriority::Normal, int copies = 1) const;
+    CancelableFuture<bool> printFile(const QString &fileName, unsigned int quantity = 1,
+                                     bool ignorePrinterState = false,
+                                     PrintPriority priority = PrintPriority::Normal) const;
+    // Filled with spooler job id once job leaves spooler queue. Fails if job was canceled or aborted by spooler,
+    // which is known only with IPP status source, or if job left queue before its id was recognized.
+    // Canceling after job is submitted to spooler only stops tracking.
+    CancelableFuture<QString> printRawDataTracked(const QByteArray &data, bool ignorePrinterState = false,
+                                                  PrintPriority priority = PrintPriority::Normal) const;
+    // Always queries printer, successful result is cached for print jobs
     Future<bool> printerIsReady() const;
+    // Fills readiness cache before first print, started at application start
+    Future<bool> warmUp() const;
+    // Print jobs skip readiness check if printer was ready within this time, 0 (default) disables caching.
+    // Printer that goes offline within this time gets jobs accepted without readiness error
+    int readinessCacheTime() const;
+    void setReadinessCacheTime(int msecs);
+
+    // Spooled labels are acknowledged once they are durably stored, printing goes on in background
+    Future<bool> spoolRawData(const QByteArray &data, bool ignorePrinterState = false,
+                              PrintPriority priority = PrintPriority::Normal) const;
+    Future<bool> replaySpool() const;
+    PrintSpoolSP spool() const;
+    void setSpool(const PrintSpoolSP &spool);
+
+    // Jobs go to capture instead of lpr, printer is always considered ready
+    PrintCaptureSP capture() const;
+    void setCapture(const PrintCaptureSP &capture);
+
+    // printFile streams files directly to this printer port (usually 9100) instead of lpr, 0 uses lpr
+    int rawPort() const;
+    void setRawPort(int port);
+
+    int jobPollInterval() const;
+    void setJobPollInterval(int msecs);
+
+    StatusSource statusSource() const;
+    // 0 port means default port of status source, 631 for IPP and 161 for SNMP
+    void setStatusSource(StatusSource source, int port = 0);
+    QByteArray snmpCommunity() const;
+    void setSnmpCommunity(const QByteArray &community);
+
+    bool coalescingEnabled() const;
+    void setCoalescingEnabled(bool enabled);
+    int coalescingWindow() const;
+    void setCoalescingWindow(int msecs);
+    int coalescingMaxBytes() const;
+    void setCoalescingMaxBytes(int bytes);
+
+    // Raw data submissions are paced to mechanical print rate, burst is number of labels printer can buffer.
+    // 0 rate disables pacing
+    double printRate() const;
+    int printRateBurst() const;
+    void setPrintRate(double labelsPerSecond, int burst = 2);
+    void setPrintRate(const EplLabelGenerator &generator, int burst = 2);
+
+    int laneCapacity() const;
+    void setLaneCapacity(int capacity);
+    int priorityAgingInterval() const;
+    void setPriorityAgingInterval(int msecs);
+    // Limits are shared by all objects of the same printer and cover both queued and running jobs, 0 is unlimited
+    int maxQueuedJobs() const;
+    void setMaxQueuedJobs(int jobs);
+    qint64 maxQueuedBytes() const;
+    void setMaxQueuedBytes(qint64 bytes);
+    PrintQueueOverflowPolicy overflowPolicy() const;
+    void setOverflowPolicy(PrintQueueOverflowPolicy policy);
+
+    int queuedJobsCount() const;
+    int runningJobsCount() const;
+    qint64 queuedBytes() const;
+    // -1 if there is no limit
+    int availableJobs() const;
+    qint64 availableBytes() const;
+
+signals:
+    void queueChanged();
+    // Emitted from sender thread while file is streamed to raw port
+    void fileProgress(const QString &fileName, qint64 bytesSent, qint64 bytesTotal);
 };
 } // namespace Hardware
 } // namespace Proof
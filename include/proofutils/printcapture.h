@@ -0,0 +1,96 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef PROOF_UTILS_PRINTCAPTURE_H
+#define PROOF_UTILS_PRINTCAPTURE_H
+
+#include "proofutils/proofutils_global.h"
+
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QVector>
+
+namespace Proof {
+
+// Print transport that doesn't need a printer.
+// Payloads are appended to one file, written to separate files in directory, kept in memory ring or discarded.
+// Submission time and size of last jobs are recorded in every mode.
+class PrintCapturePrivate;
+class PROOF_UTILS_EXPORT PrintCapture
+{
+    Q_DECLARE_PRIVATE(PrintCapture)
+public:
+    enum class Mode
+    {
+        None,
+        File,
+        Directory,
+        Memory,
+        Discard
+    };
+
+    struct Record
+    {
+        quint64 sequence = 0;
+        // Since capture creation
+        qint64 submittedAtNsecs = 0;
+        qint64 size = 0;
+        // Only in Memory mode
+        QByteArray data;
+    };
+
+    PrintCapture(const PrintCapture &other) = delete;
+    PrintCapture &operator=(const PrintCapture &other) = delete;
+    PrintCapture(PrintCapture &&other) = delete;
+    PrintCapture &operator=(PrintCapture &&other) = delete;
+    ~PrintCapture();
+
+    // path is file or directory name, for Memory mode ringSize limits kept records in every mode
+    static QSharedPointer<PrintCapture> create(Mode mode, const QString &path = QString(), int ringSize = 1024);
+    static Mode modeFromString(const QString &mode);
+
+    Mode mode() const;
+    QString path() const;
+    int ringSize() const;
+
+    bool write(const QByteArray &data);
+
+    QVector<Record> records() const;
+    quint64 jobsCount() const;
+    qint64 bytesCount() const;
+    // Between first and last submission
+    double jobsPerSecond() const;
+    double bytesPerSecond() const;
+    void reset();
+
+private:
+    PrintCapture(Mode mode, const QString &path, int ringSize);
+    QScopedPointer<PrintCapturePrivate> d_ptr;
+};
+
+using PrintCaptureSP = QSharedPointer<PrintCapture>;
+
+} // namespace Proof
+
+#endif // PROOF_UTILS_PRINTCAPTURE_H
@@ -0,0 +1,71 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef PROOF_UTILS_PRINTERCAPABILITIES_H
+#define PROOF_UTILS_PRINTERCAPABILITIES_H
+
+#include "proofseed/asynqro_extra.h"
+
+#include "proofutils/epllabelgenerator.h"
+#include "proofutils/proofutils_global.h"
+
+#include <QStringList>
+
+namespace Proof {
+namespace NetworkServices {
+struct IppPrinterCapabilities;
+} // namespace NetworkServices
+
+struct PROOF_UTILS_EXPORT PrinterCapabilities
+{
+    QString makeAndModel;
+    // 0 values are not reported by printer
+    int dpi = 0;
+    // In dots
+    int printWidth = 0;
+    int labelLength = 0;
+    QStringList documentFormats;
+    bool rawSupported = false;
+    bool nativeQrCode = false;
+
+    static PrinterCapabilities fromIpp(const NetworkServices::IppPrinterCapabilities &ippCapabilities);
+    // Values not reported by printer are taken from default profile and scaled to printer dpi
+    EplLabelProfile labelProfile() const;
+};
+
+// Printers are queried with IPP once, result is cached per printer for the whole process.
+// Failed probes are not cached.
+class PROOF_UTILS_EXPORT PrinterCapabilityProbe
+{
+public:
+    PrinterCapabilityProbe() = delete;
+
+    static Future<PrinterCapabilities> probe(const QString &printerHost, const QString &printerName,
+                                             int ippPort = 631);
+    static void invalidate(const QString &printerHost, const QString &printerName);
+};
+
+} // namespace Proof
+
+#endif // PROOF_UTILS_PRINTERCAPABILITIES_H
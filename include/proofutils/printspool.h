@@ -0,0 +1,91 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef PROOF_UTILS_PRINTSPOOL_H
+#define PROOF_UTILS_PRINTSPOOL_H
+
+#include "proofseed/asynqro_extra.h"
+
+#include "proofutils/proofutils_global.h"
+
+#include <QEnableSharedFromThis>
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QVector>
+
+#include <functional>
+
+namespace Proof {
+
+// Append-only memory-mapped journal of labels that were accepted but are not printed yet.
+// Appends are made durable in batches (group commit), pending entries survive process crash
+// and are available after next open(). Completed entries are compacted away.
+// Delivery is at-least-once: markDone() is not synced, so label printed right before power loss
+// can be replayed again.
+// open() returns the same instance for the same file while it is alive. replay() skips entries
+// that are being sent by print() or spool() at the moment.
+class PrintSpoolPrivate;
+class PROOF_UTILS_EXPORT PrintSpool : public QEnableSharedFromThis<PrintSpool>
+{
+    Q_DECLARE_PRIVATE(PrintSpool)
+public:
+    using Sender = std::function<Future<bool>(const QByteArray &)>;
+    using CancelableSender = std::function<CancelableFuture<bool>(const QByteArray &)>;
+
+    struct Entry
+    {
+        quint64 sequence = 0;
+        QByteArray data;
+    };
+
+    PrintSpool(const PrintSpool &other) = delete;
+    PrintSpool &operator=(const PrintSpool &other) = delete;
+    PrintSpool(PrintSpool &&other) = delete;
+    PrintSpool &operator=(PrintSpool &&other) = delete;
+    ~PrintSpool();
+
+    static QSharedPointer<PrintSpool> open(const QString &fileName);
+
+    QString fileName() const;
+    int pendingCount() const;
+    QVector<Entry> pendingEntries() const;
+
+    Future<quint64> append(const QByteArray &data);
+    void markDone(quint64 sequence);
+    bool sync();
+
+    CancelableFuture<bool> print(const QByteArray &data, const CancelableSender &sender);
+    Future<bool> spool(const QByteArray &data, const Sender &sender);
+    Future<bool> replay(const Sender &sender);
+
+private:
+    explicit PrintSpool(const QString &fileName);
+    QScopedPointer<PrintSpoolPrivate> d_ptr;
+};
+
+using PrintSpoolSP = QSharedPointer<PrintSpool>;
+
+} // namespace Proof
+
+#endif // PROOF_UTILS_PRINTSPOOL_H
@@ -54,9 +54,33 @@ enum Code
     PrinterOptionsCannotBeQueried = 106,
     PrinterNotReady = 107,
     TemporaryFileError = 108,
-    PrinterOffline = 109
+    PrinterOffline = 109,
+    PrintSpoolError = 110,
+    PrintQueueFull = 111,
+    PrintJobDropped = 112,
+    PrintJobCanceled = 113,
+    PrintCaptureError = 114,
+    PrinterConnectionError = 115,
+    PrintFileCannotBeOpened = 116,
+    PrinterConnectionLost = 117,
+    PrintJobStateUnknown = 118,
+    PrintJobAborted = 119
 };
 } // namespace UtilsErrorCode
+
+enum class PrintPriority
+{
+    Interactive = 0,
+    Normal = 1,
+    Bulk = 2
+};
+
+enum class PrintQueueOverflowPolicy
+{
+    Reject,
+    Block,
+    DropOldest
+};
 constexpr long UTILS_MODULE_CODE = 200;
 } // namespace Proof
 #endif // PROOFUTILITIES_GLOBAL_H
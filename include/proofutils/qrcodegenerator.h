@@ -51,6 +51,9 @@ PROOF_UTILS_EXPORT QImage generateBitmap(const QString &string, int width = 200,
                                          ErrorCorrection errorCorrection = ErrorCorrection::QuartileLevel);
 PROOF_UTILS_EXPORT QByteArray generateEplBinaryData(const QString &string, int width = 200, Mode mode = Mode::Character,
                                                     ErrorCorrection errorCorrection = ErrorCorrection::QuartileLevel);
+// Size of QR code side in modules
+PROOF_UTILS_EXPORT int modulesCount(const QString &string, Mode mode = Mode::Character,
+                                    ErrorCorrection errorCorrection = ErrorCorrection::QuartileLevel);
 
 PROOF_UTILS_EXPORT uint qHash(Proof::QrCodeGenerator::Mode arg, uint seed = 0);
 PROOF_UTILS_EXPORT uint qHash(Proof::QrCodeGenerator::ErrorCorrection arg, uint seed = 0);
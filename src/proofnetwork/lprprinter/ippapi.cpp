@@ -0,0 +1,344 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include "proofnetwork/lprprinter/ippapi.h"
+
+#include "proofnetwork/baserestapi_p.h"
+#include "proofnetwork/lprprinter/proofnetworklprprinter_types.h"
+
+#include <QAtomicInt>
+#include <QDataStream>
+#include <QRegularExpression>
+#include <QUrl>
+#include <QtEndian>
+
+//All constants here are taken from RFC 8010 and RFC 8011
+
+namespace {
+namespace IppTag {
+enum : quint8
+{
+    OperationAttributes = 0x01,
+    EndOfAttributes = 0x03,
+    MaxDelimiter = 0x0F,
+    Integer = 0x21,
+    Boolean = 0x22,
+    Enum = 0x23,
+    Resolution = 0x32,
+    TextWithoutLanguage = 0x41,
+    Keyword = 0x44,
+    Uri = 0x45,
+    Charset = 0x47,
+    NaturalLanguage = 0x48,
+    MimeMediaType = 0x49
+};
+} // namespace IppTag
+
+constexpr quint16 GET_JOB_ATTRIBUTES = 0x0009;
+constexpr quint16 GET_PRINTER_ATTRIBUTES = 0x000B;
+constexpr quint16 FIRST_ERROR_STATUS = 0x0400;
+constexpr char RESOLUTION_DOTS_PER_CM = 4;
+
+struct IppAttribute
+{
+    quint8 tag = 0;
+    QByteArray name;
+    QByteArray value;
+
+    int intValue() const
+    {
+        if ((tag != IppTag::Integer && tag != IppTag::Enum) || value.size() != 4)
+            return 0;
+        return static_cast<int>(qFromBigEndian<quint32>(value.constData()));
+    }
+};
+
+void writeAttribute(QDataStream &stream, quint8 tag, const QByteArray &name, const QByteArray &value)
+{
+    stream << tag << static_cast<quint16>(name.size());
+    stream.writeRawData(name.constData(), name.size());
+    stream << static_cast<quint16>(value.size());
+    stream.writeRawData(value.constData(), value.size());
+}
+
+// Additional values of multi-valued attributes get the name of the attribute they belong to
+bool parseReply(const QByteArray &reply, QVector<IppAttribute> *attributes, Proof::Failure *failure)
+{
+    QDataStream stream(reply);
+    stream.setByteOrder(QDataStream::BigEndian);
+    quint16 version = 0;
+    quint16 statusCode = 0;
+    quint32 requestId = 0;
+    stream >> version >> statusCode >> requestId;
+    if (stream.status() != QDataStream::Ok) {
+        *failure = Proof::Failure(QStringLiteral("IPP reply is too short"), Proof::NETWORK_LPR_PRINTER_MODULE_CODE,
+                                  Proof::NetworkErrorCode::InvalidReply);
+        return false;
+    }
+    if (statusCode >= FIRST_ERROR_STATUS) {
+        *failure = Proof::Failure(QStringLiteral("IPP request failed with status 0x%1")
+                                      .arg(statusCode, 4, 16, QChar('0')),
+                                  Proof::NETWORK_LPR_PRINTER_MODULE_CODE, Proof::NetworkErrorCode::ServerError);
+        return false;
+    }
+
+    QByteArray attributeName;
+    while (!stream.atEnd()) {
+        quint8 tag = 0;
+        stream >> tag;
+        if (tag == IppTag::EndOfAttributes)
+            break;
+        if (tag <= IppTag::MaxDelimiter)
+            continue;
+
+        quint16 nameLength = 0;
+        stream >> nameLength;
+        QByteArray name(nameLength, Qt::Uninitialized);
+        stream.readRawData(name.data(), nameLength);
+        quint16 valueLength = 0;
+        stream >> valueLength;
+        QByteArray value(valueLength, Qt::Uninitialized);
+        stream.readRawData(value.data(), valueLength);
+        if (stream.status() != QDataStream::Ok) {
+            *failure = Proof::Failure(QStringLiteral("IPP reply is malformed"), Proof::NETWORK_LPR_PRINTER_MODULE_CODE,
+                                      Proof::NetworkErrorCode::InvalidReply);
+            return false;
+        }
+        if (!name.isEmpty())
+            attributeName = name;
+        attributes->append(IppAttribute{tag, attributeName, value});
+    }
+    return true;
+}
+} // namespace
+
+namespace Proof {
+namespace NetworkServices {
+
+class IppApiPrivate : public BaseRestApiPrivate
+{
+    Q_DECLARE_PUBLIC(IppApi)
+
+    // Job attributes are requested if jobId is set
+    QByteArray attributesRequest(const QString &printer, const QVector<QByteArray> &attributes, int jobId = 0);
+    static IppPrinterStatus::State stateFromInt(int state);
+    static IppJobStatus::State jobStateFromInt(int state);
+    static void parseMediaSize(const QString &mediaName, int *width, int *length);
+
+    QAtomicInt lastRequestId{0};
+};
+
+} // namespace NetworkServices
+} // namespace Proof
+
+using namespace Proof;
+using namespace Proof::NetworkServices;
+
+bool IppPrinterStatus::isReady() const
+{
+    return reason().isEmpty();
+}
+
+QString IppPrinterStatus::reason() const
+{
+    if (state == State::Stopped)
+        return QStringLiteral("Printer is stopped");
+    if (!isAcceptingJobs)
+        return QStringLiteral("Printer doesn't accept jobs");
+    QStringList errorReasons;
+    for (const QString &stateReason : stateReasons) {
+        // CUPS reports unreachable printer as offline-report, printing to it only fills the queue
+        bool isOffline = stateReason == QLatin1String("offline-report");
+        if (!isOffline
+            && (stateReason == QLatin1String("none") || stateReason.endsWith(QLatin1String("-report"))
+                || stateReason.endsWith(QLatin1String("-warning")))) {
+            continue;
+        }
+        errorReasons << stateReason;
+    }
+    return errorReasons.join(QStringLiteral(", "));
+}
+
+bool IppJobStatus::isFinished() const
+{
+    return state == State::Canceled || state == State::Aborted || state == State::Completed;
+}
+
+IppApi::IppApi(const RestClientSP &restClient, QObject *parent) : BaseRestApi(restClient, *new IppApiPrivate, parent)
+{
+    restClient->setCustomHeader("Content-Type", "application/ipp");
+}
+
+CancelableFuture<IppPrinterStatus> IppApi::fetchPrinterStatus(const QString &printer)
+{
+    Q_D(IppApi);
+    auto unmarshaller = [](const RestApiReply &reply) -> IppPrinterStatus {
+        QVector<IppAttribute> attributes;
+        Failure failure;
+        if (!parseReply(reply.data, &attributes, &failure))
+            return WithFailure(failure);
+
+        IppPrinterStatus status;
+        for (const auto &attribute : qAsConst(attributes)) {
+            int intValue = attribute.intValue();
+            if (attribute.name == "printer-state" && attribute.tag == IppTag::Enum)
+                status.state = IppApiPrivate::stateFromInt(intValue);
+            else if (attribute.name == "printer-state-reasons")
+                status.stateReasons << QString::fromUtf8(attribute.value);
+            else if (attribute.name == "queued-job-count" && attribute.tag == IppTag::Integer)
+                status.queuedJobCount = intValue;
+            else if (attribute.name == "printer-is-accepting-jobs" && attribute.tag == IppTag::Boolean
+                     && attribute.value.size() == 1)
+                status.isAcceptingJobs = attribute.value[0];
+        }
+        return status;
+    };
+    return unmarshalReply(post(QStringLiteral("/printers/%1").arg(printer), QUrlQuery(),
+                               d->attributesRequest(printer, {"printer-state", "printer-state-reasons",
+                                                                     "queued-job-count",
+                                                                     "printer-is-accepting-jobs"})),
+                          unmarshaller);
+}
+
+CancelableFuture<IppPrinterCapabilities> IppApi::fetchPrinterCapabilities(const QString &printer)
+{
+    Q_D(IppApi);
+    auto unmarshaller = [](const RestApiReply &reply) -> IppPrinterCapabilities {
+        QVector<IppAttribute> attributes;
+        Failure failure;
+        if (!parseReply(reply.data, &attributes, &failure))
+            return WithFailure(failure);
+
+        IppPrinterCapabilities capabilities;
+        for (const auto &attribute : qAsConst(attributes)) {
+            if (attribute.name == "printer-make-and-model" && attribute.tag == IppTag::TextWithoutLanguage) {
+                capabilities.makeAndModel = QString::fromUtf8(attribute.value);
+            } else if (attribute.name == "printer-resolution-default" && attribute.tag == IppTag::Resolution
+                       && attribute.value.size() == 9) {
+                int resolution = static_cast<int>(qFromBigEndian<quint32>(attribute.value.constData()));
+                capabilities.resolution = attribute.value[8] == RESOLUTION_DOTS_PER_CM ? qRound(resolution * 2.54)
+                                                                                       : resolution;
+            } else if (attribute.name == "media-default" && attribute.tag == IppTag::Keyword) {
+                capabilities.mediaName = QString::fromUtf8(attribute.value);
+                IppApiPrivate::parseMediaSize(capabilities.mediaName, &capabilities.mediaWidth,
+                                              &capabilities.mediaLength);
+            } else if (attribute.name == "document-format-supported" && attribute.tag == IppTag::MimeMediaType) {
+                capabilities.documentFormats << QString::fromUtf8(attribute.value);
+            }
+        }
+        return capabilities;
+    };
+    return unmarshalReply(post(QStringLiteral("/printers/%1").arg(printer), QUrlQuery(),
+                               d->attributesRequest(printer, {"printer-make-and-model",
+                                                                     "printer-resolution-default", "media-default",
+                                                                     "document-format-supported"})),
+                          unmarshaller);
+}
+
+CancelableFuture<IppJobStatus> IppApi::fetchJobStatus(const QString &printer, int jobId)
+{
+    Q_D(IppApi);
+    auto unmarshaller = [](const RestApiReply &reply) -> IppJobStatus {
+        QVector<IppAttribute> attributes;
+        Failure failure;
+        if (!parseReply(reply.data, &attributes, &failure))
+            return WithFailure(failure);
+
+        IppJobStatus status;
+        for (const auto &attribute : qAsConst(attributes)) {
+            if (attribute.name == "job-state" && attribute.tag == IppTag::Enum)
+                status.state = IppApiPrivate::jobStateFromInt(attribute.intValue());
+            else if (attribute.name == "job-state-reasons")
+                status.stateReasons << QString::fromUtf8(attribute.value);
+        }
+        return status;
+    };
+    return unmarshalReply(post(QStringLiteral("/printers/%1").arg(printer), QUrlQuery(),
+                               d->attributesRequest(printer, {"job-state", "job-state-reasons"}, jobId)),
+                          unmarshaller);
+}
+
+QByteArray IppApiPrivate::attributesRequest(const QString &printer, const QVector<QByteArray> &attributes, int jobId)
+{
+    Q_Q(IppApi);
+    QUrl printerUri;
+    printerUri.setScheme(QStringLiteral("ipp"));
+    printerUri.setHost(q->restClient()->host());
+    printerUri.setPort(q->restClient()->port());
+    printerUri.setPath(QStringLiteral("/printers/%1").arg(printer));
+
+    QByteArray request;
+    QDataStream stream(&request, QIODevice::WriteOnly);
+    stream.setByteOrder(QDataStream::BigEndian);
+    stream << static_cast<quint8>(1) << static_cast<quint8>(1) << (jobId ? GET_JOB_ATTRIBUTES : GET_PRINTER_ATTRIBUTES)
+           << static_cast<quint32>(lastRequestId.fetchAndAddOrdered(1) + 1);
+    stream << static_cast<quint8>(IppTag::OperationAttributes);
+    writeAttribute(stream, IppTag::Charset, "attributes-charset", "utf-8");
+    writeAttribute(stream, IppTag::NaturalLanguage, "attributes-natural-language", "en");
+    writeAttribute(stream, IppTag::Uri, "printer-uri", printerUri.toEncoded());
+    if (jobId) {
+        QByteArray jobIdValue(4, Qt::Uninitialized);
+        qToBigEndian(static_cast<quint32>(jobId), jobIdValue.data());
+        writeAttribute(stream, IppTag::Integer, "job-id", jobIdValue);
+    }
+    for (int i = 0; i < attributes.count(); ++i)
+        writeAttribute(stream, IppTag::Keyword, i ? QByteArray() : QByteArray("requested-attributes"), attributes[i]);
+    stream << static_cast<quint8>(IppTag::EndOfAttributes);
+    return request;
+}
+
+void IppApiPrivate::parseMediaSize(const QString &mediaName, int *width, int *length)
+{
+    // PWG 5101.1 self-describing media name ends with dimensions, like na_index-4x6_4x6in or iso_a6_105x148mm
+    static const QRegularExpression sizeRegExp(QStringLiteral("_(\\d+(?:\\.\\d+)?)x(\\d+(?:\\.\\d+)?)(in|mm)$"));
+    QRegularExpressionMatch match = sizeRegExp.match(mediaName);
+    if (!match.hasMatch())
+        return;
+    double multiplier = match.captured(3) == QLatin1String("in") ? 2540.0 : 100.0;
+    *width = qRound(match.captured(1).toDouble() * multiplier);
+    *length = qRound(match.captured(2).toDouble() * multiplier);
+}
+
+IppPrinterStatus::State IppApiPrivate::stateFromInt(int state)
+{
+    switch (state) {
+    case 3:
+        return IppPrinterStatus::State::Idle;
+    case 4:
+        return IppPrinterStatus::State::Processing;
+    case 5:
+        return IppPrinterStatus::State::Stopped;
+    default:
+        return IppPrinterStatus::State::Unknown;
+    }
+}
+
+IppJobStatus::State IppApiPrivate::jobStateFromInt(int state)
+{
+    if (state < static_cast<int>(IppJobStatus::State::Pending)
+        || state > static_cast<int>(IppJobStatus::State::Completed)) {
+        return IppJobStatus::State::Unknown;
+    }
+    return static_cast<IppJobStatus::State>(state);
+}
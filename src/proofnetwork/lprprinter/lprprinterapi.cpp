@@ -32,16 +32,58 @@
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QMutex>
+#include <QtEndian>
+
+#include <atomic>
+#include <limits>
+#include <numeric>
+
+static constexpr int DEFAULT_BATCH_SIZE = 50;
+static constexpr int DEFAULT_COMPRESSION_THRESHOLD = 512;
+// Files that can't be mapped (e.g. compressed resources) are read to memory only up to this size
+static constexpr qint64 MAX_UNMAPPED_FILE_SIZE = 1024 * 1024;
 
 namespace Proof {
 namespace NetworkServices {
 
+// Posts binary payloads through client with its own content headers
+class RawPayloadApi : public ProofServiceRestApi
+{
+public:
+    RawPayloadApi(const RestClientSP &restClient, QObject *parent);
+    CancelableFuture<RestApiReply> postRaw(const QString &method, const QUrlQuery &query, const QByteArray &body);
+};
+
 class LprPrinterApiPrivate : public ProofServiceRestApiPrivate
 {
     Q_DECLARE_PUBLIC(LprPrinterApi)
 
     LprPrinterApiPrivate() : ProofServiceRestApiPrivate(lprPrinterServiceErrors()) {}
 
+    CancelableFuture<bool> printLabelAsJson(const QByteArray &label, const QUrlQuery &query);
+    CancelableFuture<bool> printLabelAsBinary(const QByteArray &label, const QUrlQuery &query);
+    static bool isMissingEndpoint(const Failure &failure);
+
+    enum class CompressionSupport
+    {
+        Unknown,
+        Checking,
+        Supported,
+        NotSupported
+    };
+    bool compressionIsUsable(qint64 size);
+    static QByteArray compressed(const QByteArray &data);
+    static RestClientSP rawPayloadClient(bool deflated);
+    static void copyClientSettings(const RestClientSP &from, const RestClientSP &to);
+    RawPayloadApi *rawPayloadApi(bool deflated);
+
+    Future<QVector<LprPrintResult>> printBatch(const QVector<QByteArray> &batch, const QString &printer,
+                                               const QUrlQuery &query);
+    Future<QVector<LprPrintResult>> printBatchSeparately(const QVector<QByteArray> &batch, const QString &printer);
+    void printBatches(const QVector<QByteArray> &labels, int offset, const QString &printer, const QUrlQuery &query,
+                      const QVector<LprPrintResult> &results, const Promise<QVector<LprPrintResult>> &promise);
+
     auto printerStatusUnmarshaller()
     {
         return [](const RestApiReply &reply) -> LprPrinterStatus {
@@ -83,6 +125,19 @@ class LprPrinterApiPrivate : public ProofServiceRestApiPrivate
             return true;
         };
     }
+
+    QMutex rawClientsMutex;
+    RestClientSP rawClient;
+    RestClientSP deflatedRawClient;
+    RawPayloadApi *rawApi = nullptr;
+    RawPayloadApi *deflatedRawApi = nullptr;
+    std::atomic<LprPrinterApi::LabelUploadMode> labelUploadMode{LprPrinterApi::LabelUploadMode::Json};
+    std::atomic_bool binaryEndpointIsMissing{false};
+    std::atomic_int batchSize{DEFAULT_BATCH_SIZE};
+    std::atomic_bool batchEndpointIsMissing{false};
+    std::atomic_bool compressionEnabled{false};
+    std::atomic_int compressionThreshold{DEFAULT_COMPRESSION_THRESHOLD};
+    std::atomic<CompressionSupport> compressionSupport{CompressionSupport::Unknown};
 };
 } // namespace NetworkServices
 } // namespace Proof
@@ -92,7 +147,92 @@ using namespace Proof::NetworkServices;
 
 LprPrinterApi::LprPrinterApi(const RestClientSP &restClient, QObject *parent)
     : ProofServiceRestApi(restClient, *new LprPrinterApiPrivate, parent)
-{}
+{
+    Q_D(LprPrinterApi);
+    d->rawClient = LprPrinterApiPrivate::rawPayloadClient(false);
+    d->deflatedRawClient = LprPrinterApiPrivate::rawPayloadClient(true);
+    d->rawApi = new RawPayloadApi(d->rawClient, this);
+    d->deflatedRawApi = new RawPayloadApi(d->deflatedRawClient, this);
+}
+
+LprPrinterApi::LabelUploadMode LprPrinterApi::labelUploadMode() const
+{
+    Q_D_CONST(LprPrinterApi);
+    return d->labelUploadMode;
+}
+
+void LprPrinterApi::setLabelUploadMode(LabelUploadMode mode)
+{
+    Q_D(LprPrinterApi);
+    d->labelUploadMode = mode;
+}
+
+int LprPrinterApi::batchSize() const
+{
+    Q_D_CONST(LprPrinterApi);
+    return d->batchSize;
+}
+
+void LprPrinterApi::setBatchSize(int size)
+{
+    Q_D(LprPrinterApi);
+    d->batchSize = qMax(1, size);
+}
+
+bool LprPrinterApi::compressionEnabled() const
+{
+    Q_D_CONST(LprPrinterApi);
+    return d->compressionEnabled;
+}
+
+void LprPrinterApi::setCompressionEnabled(bool enabled)
+{
+    Q_D(LprPrinterApi);
+    d->compressionEnabled = enabled;
+    if (enabled)
+        d->compressionIsUsable(d->compressionThreshold);
+}
+
+int LprPrinterApi::compressionThreshold() const
+{
+    Q_D_CONST(LprPrinterApi);
+    return d->compressionThreshold;
+}
+
+void LprPrinterApi::setCompressionThreshold(int bytes)
+{
+    Q_D(LprPrinterApi);
+    d->compressionThreshold = qMax(0, bytes);
+}
+
+bool LprPrinterApi::compressionIsSupported() const
+{
+    Q_D_CONST(LprPrinterApi);
+    return d->compressionSupport == LprPrinterApiPrivate::CompressionSupport::Supported;
+}
+
+Future<bool> LprPrinterApi::fetchCompressionSupport()
+{
+    Q_D(LprPrinterApi);
+    auto unmarshaller = [](const RestApiReply &reply) -> bool {
+        QJsonObject object = QJsonDocument::fromJson(reply.data).object();
+        return object.value(QStringLiteral("encodings")).toArray().contains(QStringLiteral("deflate"));
+    };
+    return unmarshalReply(get(QStringLiteral("/lpr/capabilities")), unmarshaller)
+        .map([d](bool supported) {
+            qCDebug(proofNetworkLprPrinterLog) << "Lpr-Printer: service supports compressed payloads:" << supported;
+            d->compressionSupport = supported ? LprPrinterApiPrivate::CompressionSupport::Supported
+                                              : LprPrinterApiPrivate::CompressionSupport::NotSupported;
+            return supported;
+        })
+        .recoverWith([d](const Failure &failure) {
+            // Old services have no capabilities endpoint, network errors are checked again next time
+            d->compressionSupport = LprPrinterApiPrivate::isMissingEndpoint(failure)
+                                        ? LprPrinterApiPrivate::CompressionSupport::NotSupported
+                                        : LprPrinterApiPrivate::CompressionSupport::Unknown;
+            return Future<bool>::failed(failure);
+        });
+}
 
 CancelableFuture<LprPrinterStatus> LprPrinterApi::fetchStatus(const QString &printer)
 {
@@ -109,23 +249,77 @@ CancelableFuture<bool> LprPrinterApi::printLabel(const QByteArray &label, const
     QUrlQuery query;
     if (!printer.isEmpty())
         query.addQueryItem(QStringLiteral("printer"), printer);
-    return unmarshalReply(post(QStringLiteral("/lpr/print-raw"), query,
-                               QStringLiteral("{\"data\": \"%1\"}").arg(label.toBase64().constData()).toLatin1()),
-                          d->discardingPrinterStatusUnmarshaller());
+
+    switch (d->labelUploadMode) {
+    case LabelUploadMode::Json:
+        return d->printLabelAsJson(label, query);
+    case LabelUploadMode::Binary:
+        return d->printLabelAsBinary(label, query);
+    case LabelUploadMode::Auto:
+        break;
+    }
+    if (d->binaryEndpointIsMissing)
+        return d->printLabelAsJson(label, query);
+
+    Promise<bool> promise;
+    CancelableFuture<bool> current = d->printLabelAsBinary(label, query);
+    promise.future().onFailure([current](const Failure &) { current.cancel(); });
+    current.recoverWith([d, label, query, promise](const Failure &failure) -> Future<bool> {
+               if (promise.isFilled() || !LprPrinterApiPrivate::isMissingEndpoint(failure))
+                   return Future<bool>::failed(failure);
+               qCDebug(proofNetworkLprPrinterLog) << "Lpr-Printer: service has no binary labels endpoint, "
+                                                     "labels are sent as JSON";
+               d->binaryEndpointIsMissing = true;
+               CancelableFuture<bool> fallback = d->printLabelAsJson(label, query);
+               promise.future().onFailure([fallback](const Failure &) { fallback.cancel(); });
+               return fallback;
+           })
+        .onSuccess([promise](bool result) { promise.success(result); })
+        .onFailure([promise](const Failure &failure) { promise.failure(failure); });
+    return CancelableFuture<bool>(promise);
+}
+
+CancelableFuture<QVector<LprPrintResult>> LprPrinterApi::printLabels(const QVector<QByteArray> &labels,
+                                                                     const QString &printer)
+{
+    Q_D(LprPrinterApi);
+    QUrlQuery query;
+    if (!printer.isEmpty())
+        query.addQueryItem(QStringLiteral("printer"), printer);
+
+    // Cancelation takes effect before next batch
+    Promise<QVector<LprPrintResult>> promise;
+    QVector<LprPrintResult> results;
+    results.reserve(labels.count());
+    d->printBatches(labels, 0, printer, query, results, promise);
+    return CancelableFuture<QVector<LprPrintResult>>(promise);
 }
 
 CancelableFuture<bool> LprPrinterApi::printFile(const QString &fileName, const QString &printer, unsigned int copies)
 {
     Q_D(LprPrinterApi);
-    QFile file(fileName);
-    if (!file.open(QIODevice::ReadOnly)) {
-        qCWarning(proofNetworkLprPrinterLog) << "Lpr-Printer: file error:" << file.error() << file.errorString();
+    auto file = QSharedPointer<QFile>::create(fileName);
+    if (!file->open(QIODevice::ReadOnly)) {
+        qCWarning(proofNetworkLprPrinterLog) << "Lpr-Printer: file error:" << file->error() << file->errorString();
         return invalidArgumentsFailure<bool>(
             Failure(QStringLiteral("Can't open file"), NETWORK_LPR_PRINTER_MODULE_CODE, NetworkErrorCode::FileError));
     }
-    QByteArray data = file.readAll();
-    if (file.error() != QFileDevice::NoError) {
-        qCWarning(proofNetworkLprPrinterLog) << "Lpr-Printer: file error:" << file.error() << file.errorString();
+    // Mapped file is posted without copying, its pages are read from disk while request body is sent
+    QByteArray data;
+    uchar *mapped = file->size() > 0 && file->size() <= std::numeric_limits<int>::max()
+                        ? file->map(0, file->size())
+                        : nullptr;
+    if (mapped) {
+        data = QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), static_cast<int>(file->size()));
+    } else if (file->size() <= MAX_UNMAPPED_FILE_SIZE) {
+        data = file->readAll();
+    } else {
+        qCWarning(proofNetworkLprPrinterLog) << "Lpr-Printer: file can't be mapped:" << file->errorString();
+        return invalidArgumentsFailure<bool>(
+            Failure(QStringLiteral("Can't read file"), NETWORK_LPR_PRINTER_MODULE_CODE, NetworkErrorCode::FileError));
+    }
+    if (file->error() != QFileDevice::NoError) {
+        qCWarning(proofNetworkLprPrinterLog) << "Lpr-Printer: file error:" << file->error() << file->errorString();
         return invalidArgumentsFailure<bool>(
             Failure(QStringLiteral("Can't read file"), NETWORK_LPR_PRINTER_MODULE_CODE, NetworkErrorCode::FileError));
     }
@@ -133,7 +327,11 @@ CancelableFuture<bool> LprPrinterApi::printFile(const QString &fileName, const Q
     query.addQueryItem(QStringLiteral("copies"), QString::number(copies));
     if (!printer.isEmpty())
         query.addQueryItem(QStringLiteral("printer"), printer);
-    return unmarshalReply(post(QStringLiteral("/lpr/print"), query, data), d->discardingPrinterStatusUnmarshaller());
+
+    // File is kept open till request is finished, so mapping stays valid while it is sent
+    CancelableFuture<RestApiReply> reply = post(QStringLiteral("/lpr/print"), query, data);
+    reply.onSuccess([file](const RestApiReply &) {}).onFailure([file](const Failure &) {});
+    return unmarshalReply(reply, d->discardingPrinterStatusUnmarshaller());
 }
 
 CancelableFuture<QVector<LprPrinterInfo>> LprPrinterApi::fetchPrintersList()
@@ -163,3 +361,214 @@ CancelableFuture<QVector<LprPrinterInfo>> LprPrinterApi::fetchPrintersList()
     };
     return unmarshalReply(get(QStringLiteral("/lpr/list")), unmarshaller);
 }
+
+CancelableFuture<bool> LprPrinterApiPrivate::printLabelAsJson(const QByteArray &label, const QUrlQuery &query)
+{
+    Q_Q(LprPrinterApi);
+    return q->unmarshalReply(q->post(QStringLiteral("/lpr/print-raw"), query,
+                                     QStringLiteral("{\"data\": \"%1\"}").arg(label.toBase64().constData()).toLatin1()),
+                             discardingPrinterStatusUnmarshaller());
+}
+
+CancelableFuture<bool> LprPrinterApiPrivate::printLabelAsBinary(const QByteArray &label, const QUrlQuery &query)
+{
+    Q_Q(LprPrinterApi);
+    if (!compressionIsUsable(label.size()))
+        return q->unmarshalReply(rawPayloadApi(false)->postRaw(QStringLiteral("/lpr/print-raw-binary"), query, label),
+                                 discardingPrinterStatusUnmarshaller());
+    return q->unmarshalReply(rawPayloadApi(true)->postRaw(QStringLiteral("/lpr/print-raw-binary"), query,
+                                                          compressed(label)),
+                             discardingPrinterStatusUnmarshaller());
+}
+
+bool LprPrinterApiPrivate::isMissingEndpoint(const Failure &failure)
+{
+    // Older services answer with Not Found or Method Not Allowed for unknown endpoint
+    if (failure.errorCode != NetworkErrorCode::ServerError)
+        return false;
+    int httpCode = failure.data.toInt();
+    return httpCode == 404 || httpCode == 405 || httpCode == 415;
+}
+
+Future<QVector<LprPrintResult>> LprPrinterApiPrivate::printBatch(const QVector<QByteArray> &batch,
+                                                                const QString &printer, const QUrlQuery &query)
+{
+    Q_Q(LprPrinterApi);
+    if (batchEndpointIsMissing)
+        return printBatchSeparately(batch, printer);
+
+    // Each label is prefixed with its size as 32-bit big endian integer
+    QByteArray body;
+    body.reserve(std::accumulate(batch.cbegin(), batch.cend(), 0,
+                                 [](int size, const QByteArray &label) { return size + label.size() + 4; }));
+    for (const QByteArray &label : batch) {
+        char size[4];
+        qToBigEndian<quint32>(static_cast<quint32>(label.size()), size);
+        body.append(size, 4);
+        body.append(label);
+    }
+    bool deflated = compressionIsUsable(body.size());
+    if (deflated)
+        body = compressed(body);
+    RawPayloadApi *api = rawPayloadApi(deflated);
+
+    int expectedCount = batch.count();
+    auto unmarshaller = [expectedCount](const RestApiReply &reply) -> QVector<LprPrintResult> {
+        QJsonParseError jsonError{};
+        QJsonDocument doc = QJsonDocument::fromJson(reply.data, &jsonError);
+        if (jsonError.error != QJsonParseError::NoError) {
+            return WithFailure(QStringLiteral("JSON error: %1").arg(jsonError.errorString()),
+                               NETWORK_LPR_PRINTER_MODULE_CODE, NetworkErrorCode::InvalidReply, Failure::NoHint,
+                               jsonError.error);
+        }
+        if (!doc.isArray() || doc.array().count() != expectedCount) {
+            return WithFailure(QStringLiteral("Array with result for each label is not found in document"),
+                               NETWORK_LPR_PRINTER_MODULE_CODE, NetworkErrorCode::InvalidReply);
+        }
+        QVector<LprPrintResult> results;
+        const QJsonArray array = doc.array();
+        for (const QJsonValue &value : array) {
+            QJsonObject object = value.toObject();
+            results << LprPrintResult{object.value(QStringLiteral("is_ready")).toBool(),
+                                      object.value(QStringLiteral("reason")).toString()};
+        }
+        return results;
+    };
+
+    return q->unmarshalReply(api->postRaw(QStringLiteral("/lpr/print-raw-batch"), query, body), unmarshaller)
+        .recoverWith([this, batch, printer](const Failure &failure) -> Future<QVector<LprPrintResult>> {
+            if (!isMissingEndpoint(failure))
+                return Future<QVector<LprPrintResult>>::failed(failure);
+            qCDebug(proofNetworkLprPrinterLog) << "Lpr-Printer: service has no batch endpoint, "
+                                                  "labels are sent one by one";
+            batchEndpointIsMissing = true;
+            return printBatchSeparately(batch, printer);
+        });
+}
+
+Future<QVector<LprPrintResult>> LprPrinterApiPrivate::printBatchSeparately(const QVector<QByteArray> &batch,
+                                                                          const QString &printer)
+{
+    Q_Q(LprPrinterApi);
+    Future<QVector<LprPrintResult>> result = Future<QVector<LprPrintResult>>::successful(QVector<LprPrintResult>());
+    for (const QByteArray &label : batch) {
+        result = result.flatMap([q, label, printer](const QVector<LprPrintResult> &results) {
+            return q->printLabel(label, printer)
+                .map([results](bool) {
+                    QVector<LprPrintResult> newResults = results;
+                    newResults << LprPrintResult{true, QString()};
+                    return newResults;
+                })
+                .recover([results](const Failure &failure) {
+                    QVector<LprPrintResult> newResults = results;
+                    newResults << LprPrintResult{false, failure.message};
+                    return newResults;
+                });
+        });
+    }
+    return result;
+}
+
+void LprPrinterApiPrivate::printBatches(const QVector<QByteArray> &labels, int offset, const QString &printer,
+                                        const QUrlQuery &query, const QVector<LprPrintResult> &results,
+                                        const Promise<QVector<LprPrintResult>> &promise)
+{
+    if (promise.isFilled())
+        return;
+    if (offset >= labels.count()) {
+        promise.success(results);
+        return;
+    }
+
+    QVector<QByteArray> batch = labels.mid(offset, batchSize);
+    Future<QVector<LprPrintResult>> request = printBatch(batch, printer, query);
+    request.onSuccess(
+        [this, labels, offset, printer, query, results, promise](const QVector<LprPrintResult> &batchResults) {
+            printBatches(labels, offset + batchResults.count(), printer, query, results + batchResults, promise);
+        });
+    request.onFailure([labels, offset, results, promise](const Failure &failure) {
+        if (promise.isFilled())
+            return;
+        qCWarning(proofNetworkLprPrinterLog) << "Lpr-Printer: batch of labels wasn't printed:" << failure.message;
+        QVector<LprPrintResult> newResults = results;
+        for (int i = offset; i < labels.count(); ++i)
+            newResults << LprPrintResult{false, failure.message};
+        promise.success(newResults);
+    });
+}
+
+bool LprPrinterApiPrivate::compressionIsUsable(qint64 size)
+{
+    Q_Q(LprPrinterApi);
+    if (!compressionEnabled || size < compressionThreshold)
+        return false;
+    CompressionSupport expected = CompressionSupport::Unknown;
+    if (compressionSupport.compare_exchange_strong(expected, CompressionSupport::Checking)) {
+        // Payloads are sent uncompressed until service confirms it can inflate them
+        q->fetchCompressionSupport();
+        return false;
+    }
+    return expected == CompressionSupport::Supported;
+}
+
+QByteArray LprPrinterApiPrivate::compressed(const QByteArray &data)
+{
+    // qCompress prepends uncompressed size to zlib stream, it is not a part of HTTP deflate encoding
+    return qCompress(data).mid(4);
+}
+
+RestClientSP LprPrinterApiPrivate::rawPayloadClient(bool deflated)
+{
+    // RestClient headers are client-wide, so each kind of raw payload gets own client
+    auto result = RestClientSP::create();
+    result->setCustomHeader("Content-Type", "application/octet-stream");
+    if (deflated)
+        result->setCustomHeader("Content-Encoding", "deflate");
+    return result;
+}
+
+void LprPrinterApiPrivate::copyClientSettings(const RestClientSP &from, const RestClientSP &to)
+{
+    // Only changed values are set, raw client isn't touched if main client wasn't reconfigured
+    if (to->authType() != from->authType())
+        to->setAuthType(from->authType());
+    if (to->scheme() != from->scheme())
+        to->setScheme(from->scheme());
+    if (to->host() != from->host())
+        to->setHost(from->host());
+    if (to->port() != from->port())
+        to->setPort(from->port());
+    if (to->postfix() != from->postfix())
+        to->setPostfix(from->postfix());
+    if (to->clientName() != from->clientName())
+        to->setClientName(from->clientName());
+    if (to->userName() != from->userName())
+        to->setUserName(from->userName());
+    if (to->password() != from->password())
+        to->setPassword(from->password());
+    if (to->token() != from->token())
+        to->setToken(from->token());
+    if (to->msecsForTimeout() != from->msecsForTimeout())
+        to->setMsecsForTimeout(from->msecsForTimeout());
+    if (to->followRedirects() != from->followRedirects())
+        to->setFollowRedirects(from->followRedirects());
+}
+
+RawPayloadApi *LprPrinterApiPrivate::rawPayloadApi(bool deflated)
+{
+    Q_Q(LprPrinterApi);
+    // Main client can be reconfigured (e.g. new token) at any moment, raw clients follow it on each request
+    QMutexLocker locker(&rawClientsMutex);
+    copyClientSettings(q->restClient(), deflated ? deflatedRawClient : rawClient);
+    return deflated ? deflatedRawApi : rawApi;
+}
+
+RawPayloadApi::RawPayloadApi(const RestClientSP &restClient, QObject *parent)
+    : ProofServiceRestApi(restClient, *new ProofServiceRestApiPrivate(lprPrinterServiceErrors()), parent)
+{}
+
+CancelableFuture<RestApiReply> RawPayloadApi::postRaw(const QString &method, const QUrlQuery &query,
+                                                      const QByteArray &body)
+{
+    return post(method, query, body);
+}
@@ -24,6 +24,7 @@
  */
 #include "proofcore/proofglobal.h"
 
+#include "proofnetwork/lprprinter/ippapi.h"
 #include "proofnetwork/lprprinter/lprprinterapi.h"
 #include "proofnetwork/lprprinter/proofnetworklprprinter_global.h"
 
@@ -35,5 +36,10 @@ PROOF_LIBRARY_INITIALIZER(libraryInit)
     qRegisterMetaType<Proof::NetworkServices::LprPrinterStatus>("Proof::NetworkServices::LprPrinterStatus");
     qRegisterMetaType<Proof::NetworkServices::LprPrinterInfo>("Proof::NetworkServices::LprPrinterInfo");
     qRegisterMetaType<QVector<Proof::NetworkServices::LprPrinterInfo>>("QVector<Proof::NetworkServices::LprPrinterInfo>");
+    qRegisterMetaType<Proof::NetworkServices::LprPrintResult>("Proof::NetworkServices::LprPrintResult");
+    qRegisterMetaType<QVector<Proof::NetworkServices::LprPrintResult>>("QVector<Proof::NetworkServices::LprPrintResult>");
+    qRegisterMetaType<Proof::NetworkServices::IppPrinterStatus>("Proof::NetworkServices::IppPrinterStatus");
+    qRegisterMetaType<Proof::NetworkServices::IppPrinterCapabilities>("Proof::NetworkServices::IppPrinterCapabilities");
+    qRegisterMetaType<Proof::NetworkServices::IppJobStatus>("Proof::NetworkServices::IppJobStatus");
     // clang-format on
 }
@@ -28,6 +28,8 @@
 
 #include "proofutils/qrcodegenerator.h"
 
+#include <QRegExp>
+#include <QVector>
 #include <QtMath>
 
 //All constants here are taken from manual https://www.zebra.com/content/dam/zebra/manuals/en-us/printer/epl2-pm-en.pdf
@@ -48,8 +50,57 @@ class EplLabelGeneratorPrivate
     int speed = 4;
     int density = 10;
     int gapLength = 24;
+    bool nativeQrCode = false;
 };
 
+struct EplPrintCommand
+{
+    int start;
+    int end;
+    int labelSets;
+    int copies;
+    QByteArray trailing;
+};
+
+// Raster data of GW commands is skipped, so bytes in it are never taken for commands.
+// Returns false if GW command is malformed
+static bool findPrintCommands(const QByteArray &data, QVector<EplPrintCommand> &commands)
+{
+    QRegExp printCommandRe(QStringLiteral("^P(\\d+)(?:,(\\d+))?(\\s*)$"));
+    int pos = 0;
+    while (pos < data.size()) {
+        if (data.mid(pos, 2) == "GW") {
+            // GWx,y,bytesPerRow,rows,DATA
+            int rasterStart = pos + 2;
+            QList<QByteArray> params;
+            for (int i = 0; i < 4; ++i) {
+                int comma = data.indexOf(',', rasterStart);
+                if (comma == -1)
+                    return false;
+                params << data.mid(rasterStart, comma - rasterStart);
+                rasterStart = comma + 1;
+            }
+            bool bytesPerRowOk = false;
+            bool rowsOk = false;
+            qint64 rasterSize = params[2].toLongLong(&bytesPerRowOk) * params[3].toLongLong(&rowsOk);
+            if (!bytesPerRowOk || !rowsOk || rasterSize < 0 || rasterStart + rasterSize > data.size())
+                return false;
+            pos = rasterStart + static_cast<int>(rasterSize);
+            continue;
+        }
+        int lineEnd = data.indexOf('\n', pos);
+        if (lineEnd == -1)
+            lineEnd = data.size();
+        if (data.at(pos) == 'P' && printCommandRe.indexIn(QString::fromLatin1(data.mid(pos, lineEnd - pos))) != -1) {
+            commands << EplPrintCommand{pos, lineEnd, printCommandRe.cap(1).toInt(),
+                                        printCommandRe.cap(2).isEmpty() ? 1 : printCommandRe.cap(2).toInt(),
+                                        printCommandRe.cap(3).toLatin1()};
+        }
+        pos = lineEnd + 1;
+    }
+    return true;
+}
+
 uint qHash(EplLabelGenerator::BarcodeType barcodeType, uint seed = 0)
 {
     return ::qHash(static_cast<int>(barcodeType), seed);
@@ -102,6 +153,17 @@ EplLabelGenerator::EplLabelGenerator(int printerDpi) : d_ptr(new EplLabelGenerat
     d_ptr->dpi = (printerDpi < 300) ? 203 : 300;
 }
 
+EplLabelGenerator::EplLabelGenerator(const EplLabelProfile &profile) : EplLabelGenerator(profile.dpi)
+{
+    Q_D(EplLabelGenerator);
+    d->labelWidth = profile.width;
+    d->labelHeight = profile.height;
+    d->speed = profile.speed;
+    d->density = profile.density;
+    d->gapLength = profile.gapLength;
+    d->nativeQrCode = profile.nativeQrCode;
+}
+
 EplLabelGenerator::~EplLabelGenerator()
 {}
 
@@ -117,6 +179,27 @@ void EplLabelGenerator::startLabel(int width, int height, int speed, int density
     startPage();
 }
 
+void EplLabelGenerator::startLabel(const EplLabelProfile &profile)
+{
+    Q_D(EplLabelGenerator);
+    d->nativeQrCode = profile.nativeQrCode;
+    startLabel(profile.width, profile.height, profile.speed, profile.density, profile.gapLength);
+}
+
+EplLabelProfile EplLabelGenerator::profile() const
+{
+    Q_D_CONST(EplLabelGenerator);
+    EplLabelProfile result;
+    result.dpi = d->dpi;
+    result.width = d->labelWidth;
+    result.height = d->labelHeight;
+    result.speed = d->speed;
+    result.density = d->density;
+    result.gapLength = d->gapLength;
+    result.nativeQrCode = d->nativeQrCode;
+    return result;
+}
+
 QRect EplLabelGenerator::addText(const QString &text, int x, int y, int fontSize, int horizontalScale,
                                  int verticalScale, int rotation, bool inverseColors)
 {
@@ -188,6 +271,12 @@ QSize EplLabelGenerator::labelSize() const
     return QSize(d->labelWidth, d->labelHeight);
 }
 
+double EplLabelGenerator::labelsPerSecond() const
+{
+    Q_D_CONST(EplLabelGenerator);
+    return static_cast<double>(qMax(1, d->speed) * d->dpi) / qMax(1, d->labelHeight + d->gapLength);
+}
+
 QRect EplLabelGenerator::addBarcode(const QString &data, EplLabelGenerator::BarcodeType type, int x, int y, int height,
                                     bool printReadableCode, int narrowBarWidth, int wideBarWidth, int rotation)
 {
@@ -233,6 +322,16 @@ QRect EplLabelGenerator::addBarcode(const QString &data, EplLabelGenerator::Barc
 QRect EplLabelGenerator::addQrCode(const QString &data, int x, int y, int width)
 {
     Q_D(EplLabelGenerator);
+    if (d->nativeQrCode) {
+        int modules = qMax(1, QrCodeGenerator::modulesCount(data));
+        int scale = qBound(1, width / modules, 99);
+        QString preparedData = data;
+        preparedData.replace(QLatin1String("\\"), QLatin1String("\\\\"))
+            .replace(QLatin1String("\""), QLatin1String("\\\""));
+        d->lastLabel.append(
+            QStringLiteral("b%1,%2,Q,m2,s%3,eQ,iA,\"%4\"\n").arg(x).arg(y).arg(scale).arg(preparedData));
+        return QRect(x, y, modules * scale, modules * scale);
+    }
     auto rawBinary = QrCodeGenerator::generateEplBinaryData(data, width);
     width = ((width + 7) / 8) * 8;
 
@@ -302,6 +401,36 @@ QByteArray EplLabelGenerator::labelData() const
     return d->lastLabel;
 }
 
+QByteArray EplLabelGenerator::labelWithCopies(const QByteArray &label, int copies)
+{
+    if (copies <= 1)
+        return label;
+    // Copies of each label set (Pp,c) are identical even if label uses counters
+    QVector<EplPrintCommand> commands;
+    if (!findPrintCommands(label, commands) || commands.count() != 1
+        || !label.mid(commands.first().end).trimmed().isEmpty()) {
+        return label.repeated(copies);
+    }
+    const EplPrintCommand &command = commands.first();
+    QByteArray printCommand = QStringLiteral("P%1,%2")
+                                  .arg(command.labelSets)
+                                  .arg(qMax(1, command.copies) * copies)
+                                  .toLatin1()
+                                  .append(command.trailing);
+    return QByteArray(label).replace(command.start, command.end - command.start, printCommand);
+}
+
+int EplLabelGenerator::printedLabelsCount(const QByteArray &data)
+{
+    QVector<EplPrintCommand> commands;
+    if (!findPrintCommands(data, commands))
+        return 1;
+    int result = 0;
+    for (const auto &command : qAsConst(commands))
+        result += qMax(1, command.labelSets) * qMax(1, command.copies);
+    return qMax(1, result);
+}
+
 QSize EplLabelGeneratorPrivate::charSize(int fontSize, int horizontalScale, int verticalScale) const
 {
     QSize result;
@@ -0,0 +1,336 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include "proofutils/labelpipeline.h"
+
+#include "proofcore/proofobject_p.h"
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+static constexpr int DEFAULT_QUEUE_CAPACITY = 8;
+static constexpr int DEFAULT_PRINTS_IN_FLIGHT = 2;
+static constexpr int MAX_DEFAULT_GENERATION_THREADS = 4;
+
+namespace Proof {
+class LabelPipelinePrivate : public ProofObjectPrivate
+{
+    Q_DECLARE_PUBLIC(LabelPipeline)
+
+    enum class JobState
+    {
+        Waiting,
+        Generating,
+        Generated
+    };
+
+    struct Job
+    {
+        LabelPipeline::LabelBuilder builder;
+        int copies = 1;
+        PrintPriority priority = PrintPriority::Normal;
+        JobState state = JobState::Waiting;
+        QByteArray label;
+        QElapsedTimer timer;
+        Promise<bool> promise;
+        QMutex mutex;
+        CancelableFuture<bool> current{Promise<bool>()};
+    };
+    using JobSP = QSharedPointer<Job>;
+
+    void schedule() const;
+    void generate(const JobSP &job) const;
+    void print(const JobSP &job) const;
+    void finishPrinting(const JobSP &job, bool succeeded) const;
+    void remove(const JobSP &job) const;
+
+    LabelPrinter *printer = nullptr;
+    EplLabelProfile profile;
+    mutable QMutex mutex;
+    // Labels that are not sent to printer yet, in order they were added
+    mutable QList<JobSP> jobs;
+    mutable int generatingCount = 0;
+    mutable int printingCount = 0;
+    mutable LabelPipelineStats stats;
+    int queueCapacity = DEFAULT_QUEUE_CAPACITY;
+    int printsInFlight = DEFAULT_PRINTS_IN_FLIGHT;
+    // Destroyed first, so running generations finish before anything else is gone
+    mutable QThreadPool generationPool;
+};
+
+class GenerationRunnable : public QRunnable
+{
+public:
+    explicit GenerationRunnable(const std::function<void()> &task) : m_task(task) {}
+    void run() override { m_task(); }
+
+private:
+    std::function<void()> m_task;
+};
+} // namespace Proof
+
+using namespace Proof;
+
+LabelPipeline::LabelPipeline(LabelPrinter *printer, const EplLabelProfile &profile, QObject *parent)
+    : ProofObject(*new LabelPipelinePrivate, parent)
+{
+    Q_D(LabelPipeline);
+    d->printer = printer;
+    d->profile = profile;
+    d->generationPool.setMaxThreadCount(qBound(1, QThread::idealThreadCount(), MAX_DEFAULT_GENERATION_THREADS));
+}
+
+LabelPipeline::~LabelPipeline()
+{
+    Q_D(LabelPipeline);
+    QList<LabelPipelinePrivate::JobSP> jobs;
+    {
+        QMutexLocker locker(&d->mutex);
+        jobs = d->jobs;
+        d->jobs.clear();
+    }
+    for (const auto &job : qAsConst(jobs)) {
+        job->promise.failure(Failure(QStringLiteral("Printing aborted.\nLabel pipeline is destroyed."),
+                                     UTILS_MODULE_CODE, UtilsErrorCode::PrintJobCanceled));
+    }
+    d->generationPool.waitForDone();
+}
+
+CancelableFuture<bool> LabelPipeline::addLabel(const LabelBuilder &builder, int copies, PrintPriority priority) const
+{
+    Q_D_CONST(LabelPipeline);
+    auto job = LabelPipelinePrivate::JobSP::create();
+    job->builder = builder;
+    job->copies = qMax(1, copies);
+    job->priority = priority;
+    job->timer.start();
+    Promise<bool> promise = job->promise;
+    promise.future().onFailure([d, job](const Failure &) {
+        {
+            QMutexLocker locker(&job->mutex);
+            job->current.cancel();
+        }
+        d->remove(job);
+    });
+    {
+        QMutexLocker locker(&d->mutex);
+        d->jobs << job;
+    }
+    d->schedule();
+    return CancelableFuture<bool>(promise);
+}
+
+Future<bool> LabelPipeline::addLabels(const QVector<LabelBuilder> &builders, PrintPriority priority) const
+{
+    QVector<CancelableFuture<bool>> labels;
+    labels.reserve(builders.count());
+    for (const auto &builder : builders)
+        labels << addLabel(builder, 1, priority);
+
+    Future<bool> result = futures::successful(true);
+    for (const auto &label : qAsConst(labels)) {
+        result = result.flatMap(
+            [label](bool results) { return label.map([results](bool printed) { return results && printed; }); });
+    }
+    return result;
+}
+
+int LabelPipeline::pendingLabelsCount() const
+{
+    Q_D_CONST(LabelPipeline);
+    QMutexLocker locker(&d->mutex);
+    return d->jobs.count() + d->printingCount;
+}
+
+LabelPipelineStats LabelPipeline::stats() const
+{
+    Q_D_CONST(LabelPipeline);
+    QMutexLocker locker(&d->mutex);
+    return d->stats;
+}
+
+void LabelPipeline::resetStats()
+{
+    Q_D(LabelPipeline);
+    QMutexLocker locker(&d->mutex);
+    d->stats = LabelPipelineStats();
+}
+
+int LabelPipeline::generationThreads() const
+{
+    Q_D_CONST(LabelPipeline);
+    return d->generationPool.maxThreadCount();
+}
+
+void LabelPipeline::setGenerationThreads(int threads)
+{
+    Q_D(LabelPipeline);
+    d->generationPool.setMaxThreadCount(qMax(1, threads));
+    d->schedule();
+}
+
+int LabelPipeline::queueCapacity() const
+{
+    Q_D_CONST(LabelPipeline);
+    QMutexLocker locker(&d->mutex);
+    return d->queueCapacity;
+}
+
+void LabelPipeline::setQueueCapacity(int capacity)
+{
+    Q_D(LabelPipeline);
+    {
+        QMutexLocker locker(&d->mutex);
+        d->queueCapacity = qMax(1, capacity);
+    }
+    d->schedule();
+}
+
+int LabelPipeline::printsInFlight() const
+{
+    Q_D_CONST(LabelPipeline);
+    QMutexLocker locker(&d->mutex);
+    return d->printsInFlight;
+}
+
+void LabelPipeline::setPrintsInFlight(int prints)
+{
+    Q_D(LabelPipeline);
+    {
+        QMutexLocker locker(&d->mutex);
+        d->printsInFlight = qMax(1, prints);
+    }
+    d->schedule();
+}
+
+void LabelPipelinePrivate::schedule() const
+{
+    QList<JobSP> toGenerate;
+    QList<JobSP> toPrint;
+    {
+        QMutexLocker locker(&mutex);
+        while (printingCount < printsInFlight && !jobs.isEmpty() && jobs.first()->state == JobState::Generated) {
+            toPrint << jobs.takeFirst();
+            ++printingCount;
+        }
+        // Labels that are generated or being generated are what occupies queue between stages
+        int queued = 0;
+        for (const auto &job : qAsConst(jobs)) {
+            if (generatingCount >= generationPool.maxThreadCount() || queued >= queueCapacity)
+                break;
+            if (job->state == JobState::Waiting) {
+                job->state = JobState::Generating;
+                stats.inputWaitTime += job->timer.nsecsElapsed() / 1000;
+                job->timer.start();
+                toGenerate << job;
+                ++generatingCount;
+            }
+            ++queued;
+        }
+    }
+    for (const auto &job : qAsConst(toPrint))
+        print(job);
+    for (const auto &job : qAsConst(toGenerate))
+        generationPool.start(new GenerationRunnable([this, job]() { generate(job); }));
+}
+
+void LabelPipelinePrivate::generate(const JobSP &job) const
+{
+    QByteArray label;
+    if (!job->promise.isFilled()) {
+        EplLabelGenerator generator(profile);
+        generator.startLabel(profile);
+        job->builder(generator);
+        generator.addPrintCommand();
+        label = generator.labelData();
+    }
+    {
+        QMutexLocker locker(&mutex);
+        --generatingCount;
+        ++stats.generated;
+        stats.generationTime += job->timer.nsecsElapsed() / 1000;
+        job->timer.start();
+        job->label = label;
+        job->state = JobState::Generated;
+    }
+    schedule();
+}
+
+void LabelPipelinePrivate::print(const JobSP &job) const
+{
+    {
+        QMutexLocker locker(&mutex);
+        stats.outputWaitTime += job->timer.nsecsElapsed() / 1000;
+        job->timer.start();
+    }
+    if (job->promise.isFilled()) {
+        {
+            QMutexLocker locker(&mutex);
+            --printingCount;
+        }
+        schedule();
+        return;
+    }
+
+    CancelableFuture<bool> request = printer->printLabel(job->label, false, job->priority, job->copies);
+    {
+        QMutexLocker locker(&job->mutex);
+        job->current = request;
+        if (job->promise.isFilled())
+            request.cancel();
+    }
+    request.onSuccess([this, job](bool result) {
+        finishPrinting(job, true);
+        job->promise.success(result);
+    });
+    request.onFailure([this, job](const Failure &failure) {
+        finishPrinting(job, false);
+        job->promise.failure(failure);
+    });
+}
+
+void LabelPipelinePrivate::finishPrinting(const JobSP &job, bool succeeded) const
+{
+    {
+        QMutexLocker locker(&mutex);
+        --printingCount;
+        stats.printTime += job->timer.nsecsElapsed() / 1000;
+        if (succeeded)
+            ++stats.printed;
+        else
+            ++stats.failed;
+    }
+    schedule();
+}
+
+void LabelPipelinePrivate::remove(const JobSP &job) const
+{
+    QMutexLocker locker(&mutex);
+    // Labels being generated are dropped when generation finishes
+    if (job->state != JobState::Generating)
+        jobs.removeOne(job);
+}
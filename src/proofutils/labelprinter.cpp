@@ -30,6 +30,13 @@
 
 #include "proofnetwork/lprprinter/lprprinterapi.h"
 
+#include "proofutils/epllabelgenerator.h"
+#include "proofutils/printlane_p.h"
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QtMath>
+
 #ifndef Q_OS_ANDROID
 #    include "proofutils/lprprinter.h"
 #endif
@@ -39,10 +46,42 @@ class LabelPrinterPrivate : public ProofObjectPrivate
 {
     Q_DECLARE_PUBLIC(LabelPrinter)
 
+    struct TransportHealth
+    {
+        double latency = 0.0;
+        double errorRate = 0.0;
+        QElapsedTimer updatedAt;
+    };
+
+    CancelableFuture<bool> sendToService(const QByteArray &label, PrintPriority priority) const;
+    Future<bool> serviceIsReady() const;
+    CancelableFuture<bool> send(LabelPrinter::Transport transport, const QByteArray &label, bool ignorePrinterState,
+                                PrintPriority priority, int copies) const;
+    CancelableFuture<bool> printWithFailover(const QByteArray &label, bool ignorePrinterState, PrintPriority priority,
+                                             int copies) const;
+    LabelPrinter::Transport acquireTransport() const;
+    void releaseTransport() const;
+    // Negative elapsed means there is no latency sample
+    void updateHealth(LabelPrinter::Transport transport, qint64 elapsed, bool failed) const;
+    double score(LabelPrinter::Transport transport) const;
+    LabelPrinter::Transport preferredTransport() const;
+    bool failoverEnabled() const;
+
 #ifndef Q_OS_ANDROID
     Proof::Hardware::LprPrinter *hardwareLabelPrinter = nullptr;
 #endif
-    Proof::NetworkServices::LprPrinterApi *labelPrinterApi = nullptr;
+    QSharedPointer<Proof::NetworkServices::LprPrinterApi> labelPrinterApi;
+    PrintSpoolSP spool;
+    PrintCaptureSP capture;
+    PrintLaneSP lane;
+    PrintLaneSP serviceLane;
+    int laneObserverId = 0;
+
+    mutable QMutex healthMutex;
+    mutable TransportHealth health[2];
+    mutable int labelsInFlight = 0;
+    mutable LabelPrinter::Transport pinnedTransport = LabelPrinter::Transport::Hardware;
+    mutable bool pinnedTransportFailed = false;
 
     LabelPrinterParams params;
 };
@@ -51,58 +90,479 @@ class LabelPrinterPrivate : public ProofObjectPrivate
 
 using namespace Proof;
 
+static constexpr double HEALTH_SMOOTHING = 0.2;
+// Errors are forgotten over time, so failed transport gets labels again once the other one degrades or it recovers
+static constexpr double ERROR_RATE_HALF_LIFE = 10000.0;
+static constexpr double ERROR_PENALTY = 20.0;
+
 LabelPrinter::LabelPrinter(const LabelPrinterParams &params, QObject *parent)
     : ProofObject(*new LabelPrinterPrivate, parent)
 {
     Q_D(LabelPrinter);
     d->params = params;
+    if (!params.spoolFileName.isEmpty()) {
+        d->spool = PrintSpool::open(params.spoolFileName);
+        if (!d->spool)
+            qCWarning(proofUtilsLprPrinterInfoLog) << "Labels for" << params.printerTitle << "will not be spooled";
+    }
+    if (params.captureMode != PrintCapture::Mode::None) {
+        d->capture = PrintCapture::create(params.captureMode, params.capturePath, params.captureRingSize);
+        if (!d->capture)
+            qCWarning(proofUtilsLprPrinterInfoLog) << "Labels for" << params.printerTitle << "will not be captured";
+    }
 #ifndef Q_OS_ANDROID
     if (!params.forceServiceUsage && !params.printerName.isEmpty()) {
         d->hardwareLabelPrinter = new Proof::Hardware::LprPrinter(params.printerHost, params.printerName,
                                                                   params.strictHardwareCheck, this);
-        return;
+        d->hardwareLabelPrinter->setSpool(d->spool);
+        d->hardwareLabelPrinter->setCapture(d->capture);
+        d->hardwareLabelPrinter->setReadinessCacheTime(params.readinessCacheTime);
+        if (params.snmpPort > 0) {
+            d->hardwareLabelPrinter->setSnmpCommunity(params.snmpCommunity);
+            d->hardwareLabelPrinter->setStatusSource(Proof::Hardware::LprPrinter::StatusSource::Snmp, params.snmpPort);
+        }
+        d->lane = PrintLane::forPrinter(params.printerHost, params.printerName);
+        d->laneObserverId = d->lane->addObserver([this] { emit queueChanged(); });
+        if (!params.transportFailover || params.printerPort <= 0)
+            return;
     }
 #endif
 
+    // Few requests in flight per printer (one by default), so labels wait here where priorities and aging apply,
+    // not in print service queue
+    d->serviceLane = PrintLane::forPrinter(
+        QStringLiteral("service:%1:%2").arg(params.printerHost).arg(params.printerPort), params.printerName);
+    d->serviceLane->setCapacity(params.serviceLaneCapacity);
+    if (!d->lane) {
+        d->lane = d->serviceLane;
+        d->laneObserverId = d->lane->addObserver([this] { emit queueChanged(); });
+    }
+
     auto restClient = Proof::RestClientSP::create();
     restClient->setAuthType(Proof::RestAuthType::NoAuth);
     restClient->setScheme(QStringLiteral("http"));
     restClient->setHost(params.printerHost.isEmpty() ? QStringLiteral("127.0.0.1") : params.printerHost);
     restClient->setPort(params.printerPort);
-    d->labelPrinterApi = new Proof::NetworkServices::LprPrinterApi(restClient, this);
+    d->labelPrinterApi.reset(new Proof::NetworkServices::LprPrinterApi(restClient), &QObject::deleteLater);
 }
 
 LabelPrinter::~LabelPrinter()
-{}
+{
+    Q_D(LabelPrinter);
+    d->lane->removeObserver(d->laneObserverId);
+}
 
-Future<bool> LabelPrinter::printLabel(const QByteArray &label, bool ignorePrinterState) const
+CancelableFuture<bool> LabelPrinter::printLabel(const QByteArray &label, bool ignorePrinterState,
+                                                PrintPriority priority, int copies) const
 {
     Q_D_CONST(LabelPrinter);
+    if (d->failoverEnabled())
+        return d->printWithFailover(label, ignorePrinterState, priority, copies);
 #ifndef Q_OS_ANDROID
     if (d->hardwareLabelPrinter)
-        return d->hardwareLabelPrinter->printRawData(label, ignorePrinterState);
+        return d->hardwareLabelPrinter->printRawData(label, ignorePrinterState, priority, copies);
 #else
     Q_UNUSED(ignorePrinterState)
 #endif
-    return d->labelPrinterApi->printLabel(label, d->params.printerName);
+    QByteArray labelToPrint = EplLabelGenerator::labelWithCopies(label, copies);
+    if (d->spool) {
+        return d->spool->print(labelToPrint,
+                               [d, priority](const QByteArray &data) { return d->sendToService(data, priority); });
+    }
+    return d->sendToService(labelToPrint, priority);
+}
+
+Future<bool> LabelPrinter::spoolLabel(const QByteArray &label, bool ignorePrinterState, PrintPriority priority) const
+{
+    Q_D_CONST(LabelPrinter);
+#ifndef Q_OS_ANDROID
+    if (d->hardwareLabelPrinter)
+        return d->hardwareLabelPrinter->spoolRawData(label, ignorePrinterState, priority);
+#endif
+    if (!d->spool)
+        return printLabel(label, ignorePrinterState, priority);
+    return d->spool->spool(label, [d, priority](const QByteArray &data) { return d->sendToService(data, priority); });
+}
+
+Future<bool> LabelPrinter::replaySpool() const
+{
+    Q_D_CONST(LabelPrinter);
+#ifndef Q_OS_ANDROID
+    if (d->hardwareLabelPrinter)
+        return d->hardwareLabelPrinter->replaySpool();
+#endif
+    if (!d->spool)
+        return futures::successful(true);
+    return d->spool->replay([d](const QByteArray &data) { return d->sendToService(data, PrintPriority::Normal); });
 }
 
 Future<bool> LabelPrinter::printerIsReady() const
 {
     Q_D_CONST(LabelPrinter);
 #ifndef Q_OS_ANDROID
+    if (d->hardwareLabelPrinter && d->labelPrinterApi) {
+        return d->hardwareLabelPrinter->printerIsReady().recoverWith(
+            [d](const Failure &) { return d->serviceIsReady(); });
+    }
     if (d->hardwareLabelPrinter)
         return d->hardwareLabelPrinter->printerIsReady();
 #endif
-    return d->labelPrinterApi->fetchStatus(d->params.printerName).map([](const auto &status) -> bool {
+    return d->serviceIsReady();
+}
+
+Future<LabelPrinterWarmUpResult> LabelPrinter::warmUp() const
+{
+    Q_D_CONST(LabelPrinter);
+    auto timer = QSharedPointer<QElapsedTimer>::create();
+    timer->start();
+#ifndef Q_OS_ANDROID
+    // Capabilities are probed in parallel and only cached, slow IPP doesn't hold back readiness result
+    if (d->hardwareLabelPrinter)
+        PrinterCapabilityProbe::probe(d->params.printerHost, d->params.printerName);
+    Future<bool> ready = d->hardwareLabelPrinter ? d->hardwareLabelPrinter->warmUp() : printerIsReady();
+#else
+    Future<bool> ready = printerIsReady();
+#endif
+    QString printerTitle = d->params.printerTitle;
+    return ready
+        .map([printerTitle, timer](bool) {
+            LabelPrinterWarmUpResult result;
+            result.printerTitle = printerTitle;
+            result.ready = true;
+            result.elapsed = timer->elapsed();
+            return result;
+        })
+        .recover([printerTitle, timer](const Failure &failure) {
+            qCWarning(proofUtilsLprPrinterInfoLog) << "Warm up of" << printerTitle << "failed:" << failure.message;
+            LabelPrinterWarmUpResult result;
+            result.printerTitle = printerTitle;
+            result.errorCode = failure.errorCode;
+            result.message = failure.message;
+            result.elapsed = timer->elapsed();
+            return result;
+        });
+}
+
+Future<QVector<LabelPrinterWarmUpResult>> LabelPrinter::warmUpAll(const QVector<LabelPrinter *> &printers)
+{
+    QVector<Future<LabelPrinterWarmUpResult>> probes;
+    probes.reserve(printers.count());
+    for (const auto printer : printers)
+        probes << printer->warmUp();
+
+    Future<QVector<LabelPrinterWarmUpResult>> result = Future<QVector<LabelPrinterWarmUpResult>>::successful(
+        QVector<LabelPrinterWarmUpResult>());
+    for (const auto &probe : qAsConst(probes)) {
+        result = result.flatMap([probe](const QVector<LabelPrinterWarmUpResult> &results) {
+            return probe.map([results](const LabelPrinterWarmUpResult &probeResult) {
+                QVector<LabelPrinterWarmUpResult> newResults = results;
+                newResults << probeResult;
+                return newResults;
+            });
+        });
+    }
+    return result;
+}
+
+QString LabelPrinter::title() const
+{
+    Q_D_CONST(LabelPrinter);
+    return d->params.printerTitle;
+}
+
+PrintCaptureSP LabelPrinter::capture() const
+{
+    Q_D_CONST(LabelPrinter);
+    return d->capture;
+}
+
+Future<PrinterCapabilities> LabelPrinter::capabilities() const
+{
+    Q_D_CONST(LabelPrinter);
+#ifndef Q_OS_ANDROID
+    if (d->hardwareLabelPrinter)
+        return PrinterCapabilityProbe::probe(d->params.printerHost, d->params.printerName);
+#endif
+    return Future<PrinterCapabilities>::failed(
+        Failure(QStringLiteral("Capabilities of %1 can't be probed through print service").arg(d->params.printerTitle),
+                UTILS_MODULE_CODE, UtilsErrorCode::LabelPrinterError));
+}
+
+bool LabelPrinter::transportFailoverEnabled() const
+{
+    Q_D_CONST(LabelPrinter);
+    return d->failoverEnabled();
+}
+
+LabelPrinter::Transport LabelPrinter::preferredTransport() const
+{
+    Q_D_CONST(LabelPrinter);
+    return d->preferredTransport();
+}
+
+bool LabelPrinter::isTransportFailure(const Failure &failure)
+{
+    // Only failures that happen before label is handed over to spooler or print service are listed here,
+    // label can already be printed after any other failure, so sending it again may print it twice
+    switch (failure.moduleCode) {
+    case UTILS_MODULE_CODE:
+        switch (failure.errorCode) {
+        case UtilsErrorCode::LprCannotBeStarted:
+        case UtilsErrorCode::LpqCannotBeStarted:
+        case UtilsErrorCode::LpoptionsCannotBeStarted:
+        case UtilsErrorCode::PrinterInfoCannotBeQueried:
+        case UtilsErrorCode::PrinterInfoError:
+        case UtilsErrorCode::PrinterOptionsCannotBeQueried:
+        case UtilsErrorCode::PrinterNotReady:
+        case UtilsErrorCode::PrinterOffline:
+        case UtilsErrorCode::LabelPrinterError:
+        case UtilsErrorCode::PrinterConnectionError:
+            return true;
+        default:
+            return false;
+        }
+    // Unreachable print service
+    case NETWORK_MODULE_CODE:
+        return failure.errorCode == NetworkErrorCode::ServiceUnavailable;
+    // Printer not ready on service side
+    case NETWORK_LPR_PRINTER_MODULE_CODE:
+        return failure.errorCode == NetworkErrorCode::ServerError;
+    default:
+        return false;
+    }
+}
+
+int LabelPrinter::maxQueuedJobs() const
+{
+    Q_D_CONST(LabelPrinter);
+    return d->lane->maxJobs();
+}
+
+void LabelPrinter::setMaxQueuedJobs(int jobs)
+{
+    Q_D(LabelPrinter);
+    d->lane->setMaxJobs(jobs);
+}
+
+qint64 LabelPrinter::maxQueuedBytes() const
+{
+    Q_D_CONST(LabelPrinter);
+    return d->lane->maxBytes();
+}
+
+void LabelPrinter::setMaxQueuedBytes(qint64 bytes)
+{
+    Q_D(LabelPrinter);
+    d->lane->setMaxBytes(bytes);
+}
+
+PrintQueueOverflowPolicy LabelPrinter::overflowPolicy() const
+{
+    Q_D_CONST(LabelPrinter);
+    return d->lane->overflowPolicy();
+}
+
+void LabelPrinter::setOverflowPolicy(PrintQueueOverflowPolicy policy)
+{
+    Q_D(LabelPrinter);
+    d->lane->setOverflowPolicy(policy);
+}
+
+int LabelPrinter::queuedJobsCount() const
+{
+    Q_D_CONST(LabelPrinter);
+    return d->lane->queuedCount();
+}
+
+int LabelPrinter::runningJobsCount() const
+{
+    Q_D_CONST(LabelPrinter);
+    return d->lane->runningCount();
+}
+
+qint64 LabelPrinter::queuedBytes() const
+{
+    Q_D_CONST(LabelPrinter);
+    return d->lane->bytesCount();
+}
+
+int LabelPrinter::availableJobs() const
+{
+    Q_D_CONST(LabelPrinter);
+    return d->lane->availableJobs();
+}
+
+qint64 LabelPrinter::availableBytes() const
+{
+    Q_D_CONST(LabelPrinter);
+    return d->lane->availableBytes();
+}
+
+CancelableFuture<bool> LabelPrinterPrivate::sendToService(const QByteArray &label, PrintPriority priority) const
+{
+    // Service lane is shared and can outlive this printer, so job doesn't touch printer itself
+    auto job = [api = labelPrinterApi, capture = capture, printerName = params.printerName,
+                label](const Future<bool> &canceled) -> Future<bool> {
+        if (capture) {
+            if (capture->write(label))
+                return futures::successful(true);
+            return Future<bool>::failed(Failure(QStringLiteral("Printing aborted.\nCan't write to print capture."),
+                                                UTILS_MODULE_CODE, UtilsErrorCode::PrintCaptureError));
+        }
+        CancelableFuture<bool> request = api->printLabel(label, printerName);
+        canceled.onFailure([request](const Failure &) mutable { request.cancel(); });
+        return request;
+    };
+    return serviceLane->enqueue(job, priority, label.size());
+}
+
+Future<bool> LabelPrinterPrivate::serviceIsReady() const
+{
+    if (capture)
+        return futures::successful(true);
+    return labelPrinterApi->fetchStatus(params.printerName).map([](const auto &status) -> bool {
         if (status.isReady)
             return true;
         return WithFailure(status.reason, UTILS_MODULE_CODE, UtilsErrorCode::LabelPrinterError);
     });
 }
 
-QString LabelPrinter::title() const
+CancelableFuture<bool> LabelPrinterPrivate::send(LabelPrinter::Transport transport, const QByteArray &label,
+                                                 bool ignorePrinterState, PrintPriority priority, int copies) const
 {
-    Q_D_CONST(LabelPrinter);
-    return d->params.printerTitle;
+#ifndef Q_OS_ANDROID
+    if (transport == LabelPrinter::Transport::Hardware)
+        return hardwareLabelPrinter->printRawData(label, ignorePrinterState, priority, copies);
+#else
+    Q_UNUSED(transport)
+    Q_UNUSED(ignorePrinterState)
+#endif
+    return sendToService(EplLabelGenerator::labelWithCopies(label, copies), priority);
+}
+
+CancelableFuture<bool> LabelPrinterPrivate::printWithFailover(const QByteArray &label, bool ignorePrinterState,
+                                                              PrintPriority priority, int copies) const
+{
+    LabelPrinter::Transport first = acquireTransport();
+    LabelPrinter::Transport second = first == LabelPrinter::Transport::Hardware ? LabelPrinter::Transport::Service
+                                                                                : LabelPrinter::Transport::Hardware;
+    Promise<bool> promise;
+    auto current = QSharedPointer<CancelableFuture<bool>>::create(promise);
+    auto currentMutex = QSharedPointer<QMutex>::create();
+    promise.future().onFailure([current, currentMutex](const Failure &) {
+        QMutexLocker locker(currentMutex.data());
+        current->cancel();
+    });
+
+    auto attempt = [this, label, ignorePrinterState, priority, copies, current, currentMutex,
+                    promise](LabelPrinter::Transport transport) -> Future<bool> {
+        // Latency is sampled only from labels that don't wait behind others, so queueing is not counted
+        const PrintLaneSP &transportLane = transport == LabelPrinter::Transport::Hardware ? lane : serviceLane;
+        bool laneIsIdle = !transportLane->queuedCount() && !transportLane->runningCount();
+        auto timer = QSharedPointer<QElapsedTimer>::create();
+        timer->start();
+        CancelableFuture<bool> request = send(transport, label, ignorePrinterState, priority, copies);
+        {
+            QMutexLocker locker(currentMutex.data());
+            *current = request;
+        }
+        return request
+            .onSuccess([this, transport, timer, laneIsIdle](bool) {
+                updateHealth(transport, laneIsIdle ? timer->elapsed() : -1, false);
+            })
+            .onFailure([this, transport, promise](const Failure &failure) {
+                if (!promise.isFilled() && LabelPrinter::isTransportFailure(failure))
+                    updateHealth(transport, -1, true);
+            });
+    };
+
+    attempt(first)
+        .recoverWith([this, attempt, second, promise](const Failure &failure) -> Future<bool> {
+            if (promise.isFilled() || !LabelPrinter::isTransportFailure(failure))
+                return Future<bool>::failed(failure);
+            qCWarning(proofUtilsLprPrinterInfoLog) << "Label for" << params.printerTitle
+                                                   << "is sent through alternate transport:" << failure.message;
+            return attempt(second);
+        })
+        .onSuccess([this, promise](bool result) {
+            releaseTransport();
+            promise.success(result);
+        })
+        .onFailure([this, promise](const Failure &failure) {
+            releaseTransport();
+            promise.failure(failure);
+        });
+    return CancelableFuture<bool>(promise);
+}
+
+LabelPrinter::Transport LabelPrinterPrivate::acquireTransport() const
+{
+    LabelPrinter::Transport transport = preferredTransport();
+    QMutexLocker locker(&healthMutex);
+    // Labels in flight keep their transport, so labels are not reordered between two queues.
+    // Once pinned transport fails it is picked again, otherwise steady load would never leave it
+    if (labelsInFlight++ && !pinnedTransportFailed)
+        return pinnedTransport;
+    pinnedTransport = transport;
+    pinnedTransportFailed = false;
+    return transport;
+}
+
+void LabelPrinterPrivate::releaseTransport() const
+{
+    QMutexLocker locker(&healthMutex);
+    --labelsInFlight;
+}
+
+void LabelPrinterPrivate::updateHealth(LabelPrinter::Transport transport, qint64 elapsed, bool failed) const
+{
+    QMutexLocker locker(&healthMutex);
+    TransportHealth &transportHealth = health[static_cast<int>(transport)];
+    if (transportHealth.updatedAt.isValid()) {
+        transportHealth.errorRate *= qPow(0.5, transportHealth.updatedAt.elapsed() / ERROR_RATE_HALF_LIFE);
+        transportHealth.errorRate += HEALTH_SMOOTHING * ((failed ? 1.0 : 0.0) - transportHealth.errorRate);
+        if (elapsed >= 0)
+            transportHealth.latency += HEALTH_SMOOTHING * (elapsed - transportHealth.latency);
+    } else {
+        transportHealth.errorRate = failed ? 1.0 : 0.0;
+        transportHealth.latency = qMax(elapsed, qint64(0));
+    }
+    transportHealth.updatedAt.start();
+    if (failed && transport == pinnedTransport)
+        pinnedTransportFailed = true;
+}
+
+double LabelPrinterPrivate::score(LabelPrinter::Transport transport) const
+{
+    QMutexLocker locker(&healthMutex);
+    const TransportHealth &transportHealth = health[static_cast<int>(transport)];
+    if (!transportHealth.updatedAt.isValid())
+        return 1.0;
+    double errorRate = transportHealth.errorRate
+                       * qPow(0.5, transportHealth.updatedAt.elapsed() / ERROR_RATE_HALF_LIFE);
+    return (transportHealth.latency + 1.0) * (1.0 + ERROR_PENALTY * errorRate);
+}
+
+LabelPrinter::Transport LabelPrinterPrivate::preferredTransport() const
+{
+#ifndef Q_OS_ANDROID
+    if (!hardwareLabelPrinter)
+        return LabelPrinter::Transport::Service;
+    if (!labelPrinterApi)
+        return LabelPrinter::Transport::Hardware;
+    return score(LabelPrinter::Transport::Service) < score(LabelPrinter::Transport::Hardware)
+               ? LabelPrinter::Transport::Service
+               : LabelPrinter::Transport::Hardware;
+#else
+    return LabelPrinter::Transport::Service;
+#endif
+}
+
+bool LabelPrinterPrivate::failoverEnabled() const
+{
+#ifndef Q_OS_ANDROID
+    return hardwareLabelPrinter && labelPrinterApi;
+#else
+    return false;
+#endif
 }
@@ -0,0 +1,269 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include "proofutils/labelprinterpool.h"
+
+#include "proofcore/proofobject_p.h"
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QSet>
+
+#include <algorithm>
+
+static constexpr int DEFAULT_RECOVERY_INTERVAL = 5000;
+
+namespace Proof {
+class LabelPrinterPoolPrivate : public ProofObjectPrivate
+{
+    Q_DECLARE_PUBLIC(LabelPrinterPool)
+
+    struct PrinterSlot
+    {
+        LabelPrinter *printer = nullptr;
+        int inFlight = 0;
+        bool healthy = true;
+        QElapsedTimer failedAt;
+    };
+
+    struct Group
+    {
+        int printerIndex = -1;
+        int inFlight = 0;
+    };
+
+    struct Job
+    {
+        QByteArray label;
+        QString groupKey;
+        bool ignorePrinterState = false;
+        PrintPriority priority = PrintPriority::Normal;
+        int copies = 1;
+        Promise<bool> promise;
+        QSet<int> triedPrinters;
+        QMutex mutex;
+        CancelableFuture<bool> current{Promise<bool>()};
+    };
+    using JobSP = QSharedPointer<Job>;
+
+    void send(const JobSP &job, const Failure &lastFailure) const;
+    int acquirePrinter(const JobSP &job) const;
+    void releasePrinter(int index, const QString &groupKey, bool printerFailed, bool updateHealth = true) const;
+    bool isAvailable(const PrinterSlot &slot) const;
+
+    QVector<LabelPrinter *> printers;
+    std::function<void(int, bool)> healthCallback;
+    mutable QMutex mutex;
+    mutable QVector<PrinterSlot> printerSlots;
+    mutable QHash<QString, Group> groups;
+    int recoveryInterval = DEFAULT_RECOVERY_INTERVAL;
+};
+} // namespace Proof
+
+using namespace Proof;
+
+LabelPrinterPool::LabelPrinterPool(const QVector<LabelPrinterParams> &params, QObject *parent)
+    : ProofObject(*new LabelPrinterPoolPrivate, parent)
+{
+    Q_D(LabelPrinterPool);
+    for (const auto &printerParams : params) {
+        LabelPrinterPoolPrivate::PrinterSlot slot;
+        slot.printer = new LabelPrinter(printerParams, this);
+        d->printerSlots << slot;
+        d->printers << slot.printer;
+    }
+    d->healthCallback = [this](int index, bool healthy) { emit printerHealthChanged(index, healthy); };
+}
+
+LabelPrinterPool::~LabelPrinterPool()
+{}
+
+CancelableFuture<bool> LabelPrinterPool::printLabel(const QByteArray &label, const QString &groupKey,
+                                                    bool ignorePrinterState, PrintPriority priority, int copies) const
+{
+    Q_D_CONST(LabelPrinterPool);
+    auto job = LabelPrinterPoolPrivate::JobSP::create();
+    job->label = label;
+    job->groupKey = groupKey;
+    job->ignorePrinterState = ignorePrinterState;
+    job->priority = priority;
+    job->copies = copies;
+    Promise<bool> promise = job->promise;
+    promise.future().onFailure([job](const Failure &) {
+        QMutexLocker locker(&job->mutex);
+        job->current.cancel();
+    });
+    d->send(job, Failure(QStringLiteral("Printing aborted.\nThere are no printers in pool."), UTILS_MODULE_CODE,
+                         UtilsErrorCode::PrinterNotReady));
+    return CancelableFuture<bool>(promise);
+}
+
+Future<QVector<LabelPrinterWarmUpResult>> LabelPrinterPool::warmUp() const
+{
+    Q_D_CONST(LabelPrinterPool);
+    return LabelPrinter::warmUpAll(d->printers);
+}
+
+QVector<LabelPrinter *> LabelPrinterPool::printers() const
+{
+    Q_D_CONST(LabelPrinterPool);
+    return d->printers;
+}
+
+bool LabelPrinterPool::isPrinterHealthy(int index) const
+{
+    Q_D_CONST(LabelPrinterPool);
+    QMutexLocker locker(&d->mutex);
+    return index >= 0 && index < d->printerSlots.count() && d->printerSlots[index].healthy;
+}
+
+int LabelPrinterPool::healthyPrintersCount() const
+{
+    Q_D_CONST(LabelPrinterPool);
+    QMutexLocker locker(&d->mutex);
+    return static_cast<int>(std::count_if(d->printerSlots.cbegin(), d->printerSlots.cend(),
+                                          [](const auto &slot) { return slot.healthy; }));
+}
+
+int LabelPrinterPool::recoveryInterval() const
+{
+    Q_D_CONST(LabelPrinterPool);
+    QMutexLocker locker(&d->mutex);
+    return d->recoveryInterval;
+}
+
+void LabelPrinterPool::setRecoveryInterval(int msecs)
+{
+    Q_D(LabelPrinterPool);
+    QMutexLocker locker(&d->mutex);
+    d->recoveryInterval = qMax(0, msecs);
+}
+
+void LabelPrinterPoolPrivate::send(const JobSP &job, const Failure &lastFailure) const
+{
+    if (job->promise.isFilled())
+        return;
+    int index = acquirePrinter(job);
+    if (index < 0) {
+        job->promise.failure(lastFailure);
+        return;
+    }
+
+    CancelableFuture<bool> request = printerSlots[index].printer->printLabel(job->label, job->ignorePrinterState,
+                                                                      job->priority, job->copies);
+    {
+        QMutexLocker locker(&job->mutex);
+        job->current = request;
+        if (job->promise.isFilled())
+            request.cancel();
+    }
+    request.onSuccess([this, job, index](bool result) {
+        releasePrinter(index, job->groupKey, false);
+        job->promise.success(result);
+    });
+    request.onFailure([this, job, index](const Failure &failure) {
+        // Canceled job says nothing about printer health
+        if (job->promise.isFilled()) {
+            releasePrinter(index, job->groupKey, false, false);
+            return;
+        }
+        bool printerFailed = LabelPrinter::isTransportFailure(failure);
+        releasePrinter(index, job->groupKey, printerFailed);
+        if (!printerFailed) {
+            job->promise.failure(failure);
+            return;
+        }
+        qCWarning(proofUtilsLprPrinterInfoLog) << "Printer" << printerSlots[index].printer->title()
+                                               << "failed, label goes to next printer in pool:" << failure.message;
+        send(job, failure);
+    });
+}
+
+int LabelPrinterPoolPrivate::acquirePrinter(const JobSP &job) const
+{
+    QMutexLocker locker(&mutex);
+    auto group = job->groupKey.isEmpty() ? groups.end() : groups.find(job->groupKey);
+    int index = -1;
+    if (group != groups.end() && group->inFlight > 0 && !job->triedPrinters.contains(group->printerIndex)
+        && isAvailable(printerSlots[group->printerIndex])) {
+        index = group->printerIndex;
+    } else {
+        // Unavailable printers are tried only if there are no available ones left
+        int bestScore = 0;
+        bool bestIsAvailable = false;
+        for (int i = 0; i < printerSlots.count(); ++i) {
+            if (job->triedPrinters.contains(i))
+                continue;
+            bool available = isAvailable(printerSlots[i]);
+            const auto &printer = printerSlots[i].printer;
+            int score = qMax(printerSlots[i].inFlight, printer->queuedJobsCount() + printer->runningJobsCount());
+            if (index < 0 || (available && !bestIsAvailable)
+                || (available == bestIsAvailable && score < bestScore)) {
+                index = i;
+                bestScore = score;
+                bestIsAvailable = available;
+            }
+        }
+    }
+    if (index < 0)
+        return -1;
+
+    job->triedPrinters << index;
+    ++printerSlots[index].inFlight;
+    if (!job->groupKey.isEmpty()) {
+        Group &jobGroup = groups[job->groupKey];
+        jobGroup.printerIndex = index;
+        ++jobGroup.inFlight;
+    }
+    return index;
+}
+
+void LabelPrinterPoolPrivate::releasePrinter(int index, const QString &groupKey, bool printerFailed,
+                                             bool updateHealth) const
+{
+    bool healthChanged = false;
+    {
+        QMutexLocker locker(&mutex);
+        PrinterSlot &slot = printerSlots[index];
+        --slot.inFlight;
+        if (updateHealth) {
+            if (printerFailed)
+                slot.failedAt.start();
+            healthChanged = slot.healthy == printerFailed;
+            slot.healthy = !printerFailed;
+        }
+        if (!groupKey.isEmpty()) {
+            auto group = groups.find(groupKey);
+            if (group != groups.end() && --group->inFlight <= 0)
+                groups.erase(group);
+        }
+    }
+    if (healthChanged)
+        healthCallback(index, !printerFailed);
+}
+
+bool LabelPrinterPoolPrivate::isAvailable(const PrinterSlot &slot) const
+{
+    return slot.healthy || slot.failedAt.hasExpired(recoveryInterval);
+}
@@ -0,0 +1,183 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include "proofutils/labelprinterregistry.h"
+
+#include "proofcore/settings.h"
+#include "proofcore/settingsgroup.h"
+
+#include <QCoreApplication>
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+
+namespace Proof {
+class LabelPrinterRegistryPrivate
+{
+    Q_DECLARE_PUBLIC(LabelPrinterRegistry)
+
+    struct Entry
+    {
+        LabelPrinterParams params;
+        LabelPrinterSP printer;
+    };
+
+    LabelPrinterRegistry *q_ptr = nullptr;
+
+    mutable QMutex mutex;
+    QStringList names;
+    mutable QHash<QString, Entry> entries;
+    QString selectedPrinterName;
+};
+} // namespace Proof
+
+using namespace Proof;
+
+Q_GLOBAL_STATIC(LabelPrinterRegistry, registryInstance)
+
+LabelPrinterRegistry::LabelPrinterRegistry() : d_ptr(new LabelPrinterRegistryPrivate)
+{
+    d_ptr->q_ptr = this;
+}
+
+LabelPrinterRegistry::~LabelPrinterRegistry()
+{}
+
+LabelPrinterRegistry *LabelPrinterRegistry::instance()
+{
+    return registryInstance();
+}
+
+void LabelPrinterRegistry::loadSettings(Settings *settings)
+{
+    Q_D(LabelPrinterRegistry);
+    QStringList names = settings->mainGroup()
+                            ->value(QStringLiteral("label_printers"), "", Settings::NotFoundPolicy::DoNothing)
+                            .toString()
+                            .split(QStringLiteral("|"), QString::SkipEmptyParts);
+    QString selectedPrinterName = settings->mainGroup()
+                                      ->value(QStringLiteral("selected_printer"), "", Settings::NotFoundPolicy::DoNothing)
+                                      .toString();
+
+    QMutexLocker locker(&d->mutex);
+    d->selectedPrinterName = selectedPrinterName;
+    for (const QString &name : d->names) {
+        if (!names.contains(name))
+            d->entries.remove(name);
+    }
+    d->names.clear();
+    for (const QString &name : qAsConst(names)) {
+        if (!settings->group(name, Settings::NotFoundPolicy::DoNothing)) {
+            qCWarning(proofUtilsLprPrinterInfoLog) << "Label printer" << name << "has no settings group";
+            continue;
+        }
+        LabelPrinterParams params = paramsFromSettings(settings, name);
+        d->names << name;
+        auto entry = d->entries.find(name);
+        if (entry == d->entries.end())
+            d->entries[name].params = params;
+        else if (entry->params != params)
+            *entry = LabelPrinterRegistryPrivate::Entry{params, LabelPrinterSP()};
+    }
+}
+
+LabelPrinterParams LabelPrinterRegistry::paramsFromSettings(Settings *settings, const QString &name)
+{
+    LabelPrinterParams params;
+    auto group = settings->group(name, Settings::NotFoundPolicy::DoNothing);
+    if (!group)
+        return params;
+    auto value = [group](const QString &key, const QVariant &defaultValue) {
+        return group->value(key, defaultValue, Settings::NotFoundPolicy::DoNothing);
+    };
+    params.printerName = value(QStringLiteral("name"), name).toString();
+    params.printerTitle = value(QStringLiteral("title"), params.printerName).toString();
+    params.printerHost = value(QStringLiteral("host"), "").toString();
+    params.printerPort = value(QStringLiteral("port"), 8090).toInt();
+    params.strictHardwareCheck = value(QStringLiteral("binaries_check"), true).toBool();
+    params.forceServiceUsage = value(QStringLiteral("force_service_usage"), false).toBool();
+    params.transportFailover = value(QStringLiteral("transport_failover"), false).toBool();
+    return params;
+}
+
+void LabelPrinterRegistry::registerPrinter(const QString &name, const LabelPrinterParams &params)
+{
+    Q_D(LabelPrinterRegistry);
+    QMutexLocker locker(&d->mutex);
+    if (!d->names.contains(name))
+        d->names << name;
+    d->entries[name] = LabelPrinterRegistryPrivate::Entry{params, LabelPrinterSP()};
+}
+
+void LabelPrinterRegistry::clear()
+{
+    Q_D(LabelPrinterRegistry);
+    QMutexLocker locker(&d->mutex);
+    d->names.clear();
+    d->entries.clear();
+    d->selectedPrinterName.clear();
+}
+
+QStringList LabelPrinterRegistry::printerNames() const
+{
+    Q_D_CONST(LabelPrinterRegistry);
+    QMutexLocker locker(&d->mutex);
+    return d->names;
+}
+
+QString LabelPrinterRegistry::selectedPrinterName() const
+{
+    Q_D_CONST(LabelPrinterRegistry);
+    QMutexLocker locker(&d->mutex);
+    return d->selectedPrinterName;
+}
+
+bool LabelPrinterRegistry::contains(const QString &name) const
+{
+    Q_D_CONST(LabelPrinterRegistry);
+    QMutexLocker locker(&d->mutex);
+    return d->entries.contains(name);
+}
+
+LabelPrinterSP LabelPrinterRegistry::printer(const QString &name) const
+{
+    Q_D_CONST(LabelPrinterRegistry);
+    QMutexLocker locker(&d->mutex);
+    auto entry = d->entries.find(name);
+    if (entry == d->entries.end())
+        return LabelPrinterSP();
+    if (!entry->printer) {
+        auto printer = new LabelPrinter(entry->params);
+        // Printer outlives screen and thread that asked for it first
+        if (qApp && printer->thread() != qApp->thread())
+            printer->moveToThread(qApp->thread());
+        entry->printer = LabelPrinterSP(printer, &QObject::deleteLater);
+    }
+    return entry->printer;
+}
+
+LabelPrinterSP LabelPrinterRegistry::selectedPrinter() const
+{
+    return printer(selectedPrinterName());
+}
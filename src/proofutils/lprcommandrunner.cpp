@@ -0,0 +1,302 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include "proofutils/lprcommandrunner_p.h"
+
+#include <QCoreApplication>
+#include <QMutex>
+#include <QPointer>
+#include <QQueue>
+#include <QThread>
+#include <QTimer>
+
+static constexpr int DEFAULT_MAX_PARALLEL_PROCESSES = 8;
+static constexpr int DEFAULT_TIMEOUT = 30000;
+
+namespace Proof {
+class LprCommandRunnerPrivate
+{
+    Q_DECLARE_PUBLIC(LprCommandRunner)
+
+    struct Command
+    {
+        QString program;
+        QStringList arguments;
+        QByteArray input;
+        Promise<LprCommandResult> promise;
+        Future<bool> abortSignal;
+    };
+
+    void pump();
+    void start(const Command &command);
+    void startHandler(const Command &command, const LprCommandRunner::CommandHandler &handler);
+    void commandFinished();
+
+    LprCommandRunner *q_ptr = nullptr;
+
+    QThread *thread = nullptr;
+    QObject *context = nullptr;
+
+    mutable QMutex mutex;
+    QQueue<Command> queue;
+    int running = 0;
+    int maxParallelProcesses = DEFAULT_MAX_PARALLEL_PROCESSES;
+    int timeout = DEFAULT_TIMEOUT;
+    LprCommandRunner::CommandHandler commandHandler;
+};
+} // namespace Proof
+
+using namespace Proof;
+
+Q_GLOBAL_STATIC(LprCommandRunner, runnerInstance)
+
+LprCommandRunner::LprCommandRunner() : d_ptr(new LprCommandRunnerPrivate)
+{
+    Q_D(LprCommandRunner);
+    d->q_ptr = this;
+    d->thread = new QThread;
+    d->thread->setObjectName(QStringLiteral("LprCommandRunner"));
+    d->context = new QObject;
+    d->context->moveToThread(d->thread);
+    QObject::connect(d->thread, &QThread::finished, d->context, &QObject::deleteLater);
+    d->thread->start();
+}
+
+LprCommandRunner::~LprCommandRunner()
+{
+    Q_D(LprCommandRunner);
+    d->thread->quit();
+    d->thread->wait();
+    delete d->thread;
+}
+
+LprCommandRunner *LprCommandRunner::instance()
+{
+    return runnerInstance();
+}
+
+int LprCommandRunner::maxParallelProcesses() const
+{
+    Q_D_CONST(LprCommandRunner);
+    QMutexLocker locker(&d->mutex);
+    return d->maxParallelProcesses;
+}
+
+void LprCommandRunner::setMaxParallelProcesses(int count)
+{
+    Q_D(LprCommandRunner);
+    {
+        QMutexLocker locker(&d->mutex);
+        d->maxParallelProcesses = qMax(1, count);
+    }
+    d->pump();
+}
+
+int LprCommandRunner::timeout() const
+{
+    Q_D_CONST(LprCommandRunner);
+    QMutexLocker locker(&d->mutex);
+    return d->timeout;
+}
+
+void LprCommandRunner::setTimeout(int msecs)
+{
+    Q_D(LprCommandRunner);
+    QMutexLocker locker(&d->mutex);
+    d->timeout = msecs;
+}
+
+Future<LprCommandResult> LprCommandRunner::run(const QString &program, const QStringList &arguments,
+                                               const QByteArray &input)
+{
+    return run(program, arguments, input, Promise<bool>().future());
+}
+
+Future<LprCommandResult> LprCommandRunner::run(const QString &program, const QStringList &arguments,
+                                               const QByteArray &input, const Future<bool> &abortSignal)
+{
+    Q_D(LprCommandRunner);
+    Promise<LprCommandResult> promise;
+    {
+        QMutexLocker locker(&d->mutex);
+        d->queue.enqueue(LprCommandRunnerPrivate::Command{program, arguments, input, promise, abortSignal});
+    }
+    d->pump();
+    return promise.future();
+}
+
+void LprCommandRunner::setCommandHandler(const CommandHandler &handler)
+{
+    Q_D(LprCommandRunner);
+    QMutexLocker locker(&d->mutex);
+    d->commandHandler = handler;
+}
+
+void LprCommandRunner::runLater(int msecs, const std::function<void()> &callback)
+{
+    Q_D(LprCommandRunner);
+    QObject *context = d->context;
+    QMetaObject::invokeMethod(context, [context, msecs, callback] { QTimer::singleShot(msecs, context, callback); },
+                              Qt::QueuedConnection);
+}
+
+void LprCommandRunnerPrivate::pump()
+{
+    QVector<Command> toStart;
+    {
+        QMutexLocker locker(&mutex);
+        while (running < maxParallelProcesses && !queue.isEmpty()) {
+            toStart << queue.dequeue();
+            ++running;
+        }
+    }
+    for (const auto &command : qAsConst(toStart))
+        QMetaObject::invokeMethod(context, [this, command] { start(command); }, Qt::QueuedConnection);
+}
+
+void LprCommandRunnerPrivate::start(const Command &command)
+{
+    if (command.abortSignal.isFailed()) {
+        qCDebug(proofUtilsLprPrinterDataLog) << command.program << "is aborted before start";
+        LprCommandResult result;
+        result.aborted = true;
+        command.promise.success(result);
+        commandFinished();
+        return;
+    }
+
+    LprCommandRunner::CommandHandler handler;
+    {
+        QMutexLocker locker(&mutex);
+        handler = commandHandler;
+    }
+    if (handler) {
+        startHandler(command, handler);
+        return;
+    }
+
+    auto process = new QProcess(context);
+    auto timer = new QTimer(process);
+    timer->setSingleShot(true);
+    auto result = QSharedPointer<LprCommandResult>::create();
+    Promise<LprCommandResult> promise = command.promise;
+
+    auto finish = [this, process, timer, result, promise]() {
+        if (promise.isFilled())
+            return;
+        timer->stop();
+        result->standardOutput = process->readAllStandardOutput();
+        result->standardError = process->readAllStandardError();
+        promise.success(*result);
+        process->deleteLater();
+        commandFinished();
+    };
+
+    QByteArray input = command.input;
+    QObject::connect(process, &QProcess::started, process, [process, input]() {
+        if (!input.isEmpty())
+            process->write(input);
+        process->closeWriteChannel();
+    });
+    QObject::connect(process, &QProcess::errorOccurred, process, [result, finish](QProcess::ProcessError error) {
+        if (error != QProcess::FailedToStart)
+            return;
+        result->error = error;
+        finish();
+    });
+    QObject::connect(process, qOverload<int, QProcess::ExitStatus>(&QProcess::finished), process,
+                     [result, finish](int exitCode, QProcess::ExitStatus exitStatus) {
+                         result->exitCode = exitCode;
+                         if (exitStatus == QProcess::CrashExit && result->error == QProcess::UnknownError)
+                             result->error = QProcess::Crashed;
+                         finish();
+                     });
+    QObject::connect(timer, &QTimer::timeout, process, [process, result, command]() {
+        qCWarning(proofUtilsLprPrinterInfoLog) << command.program << "timed out, killing it";
+        result->error = QProcess::Timedout;
+        process->kill();
+    });
+
+    QObject *processContext = context;
+    QPointer<QProcess> guardedProcess = process;
+    QString program = command.program;
+    command.abortSignal.onFailure([processContext, guardedProcess, result, promise, program](const Failure &) {
+        QMetaObject::invokeMethod(processContext,
+                                  [guardedProcess, result, promise, program]() {
+                                      if (!guardedProcess || promise.isFilled())
+                                          return;
+                                      qCDebug(proofUtilsLprPrinterDataLog) << program << "aborted, killing it";
+                                      result->aborted = true;
+                                      guardedProcess->kill();
+                                  },
+                                  Qt::QueuedConnection);
+    });
+
+    int timeoutValue;
+    {
+        QMutexLocker locker(&mutex);
+        timeoutValue = timeout;
+    }
+    process->start(command.program, command.arguments);
+    if (timeoutValue > 0 && !promise.isFilled())
+        timer->start(timeoutValue);
+}
+
+void LprCommandRunnerPrivate::startHandler(const Command &command, const LprCommandRunner::CommandHandler &handler)
+{
+    // Both handler result and abort are delivered to runner thread, so promise is filled only once
+    Promise<LprCommandResult> promise = command.promise;
+    QObject *handlerContext = context;
+    auto finish = [this, handlerContext, promise](const LprCommandResult &result) {
+        QMetaObject::invokeMethod(handlerContext,
+                                  [this, promise, result]() {
+                                      if (promise.isFilled())
+                                          return;
+                                      promise.success(result);
+                                      commandFinished();
+                                  },
+                                  Qt::QueuedConnection);
+    };
+    command.abortSignal.onFailure([finish](const Failure &) {
+        LprCommandResult result;
+        result.aborted = true;
+        finish(result);
+    });
+    handler(command.program, command.arguments, command.input)
+        .onSuccess([finish](const LprCommandResult &result) { finish(result); })
+        .onFailure([finish](const Failure &) {
+            LprCommandResult result;
+            result.error = QProcess::FailedToStart;
+            finish(result);
+        });
+}
+
+void LprCommandRunnerPrivate::commandFinished()
+{
+    {
+        QMutexLocker locker(&mutex);
+        --running;
+    }
+    pump();
+}
@@ -28,29 +28,122 @@
 
 #include "proofcore/proofobject_p.h"
 
+#include "proofnetwork/lprprinter/ippapi.h"
+
+#include "proofutils/epllabelgenerator.h"
+#include "proofutils/lprcommandrunner_p.h"
+#include "proofutils/printjobtracker_p.h"
+#include "proofutils/printlane_p.h"
+#include "proofutils/printratelimiter_p.h"
+#include "proofutils/rawsocketsender_p.h"
+#include "proofutils/snmpstatuspoller_p.h"
+
+#include <QAtomicInt>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QEnableSharedFromThis>
 #include <QFile>
-#include <QProcess>
-#include <QThread>
+#include <QMutex>
+#include <QPointer>
+#include <QTemporaryFile>
+#include <QTimer>
 
 static const QString EMPTY_PRINTER_TEXT = QStringLiteral("Printing aborted.\n Empty printer.");
-static constexpr int32_t RESTRICTOR = Proof::UTILS_MODULE_CODE + 42;
+static constexpr int DEFAULT_COALESCING_WINDOW = 100;
+static constexpr int DEFAULT_COALESCING_MAX_BYTES = 512 * 1024;
+static constexpr int DEFAULT_READINESS_CACHE_TIME = 0;
+static constexpr int DEFAULT_IPP_PORT = 631;
+static constexpr int DEFAULT_SNMP_PORT = 161;
 
 namespace Proof {
 namespace Hardware {
-class LprPrinterPrivate : public ProofObjectPrivate
+// Part of printer that its lane jobs work with. Lanes are shared by all printer objects and outlive them,
+// so jobs keep it alive by shared pointer instead of pointing to printer private data
+class LprPrinterBackend : public QEnableSharedFromThis<LprPrinterBackend>
 {
-    Q_DECLARE_PUBLIC(LprPrinter)
-
-    Future<bool> printRawData(const QByteArray &data, bool ignorePrinterState) const;
-    Future<bool> printFile(const QString &fileName, unsigned int quantity, bool ignorePrinterState) const;
+public:
+    // Returns spooler job id if it is reported on submission, only jobs with title are submitted so
+    Future<QString> printRawData(const QByteArray &data, bool ignorePrinterState, const Future<bool> &canceled,
+                                 const QString &jobTitle = QString()) const;
+    CancelableFuture<bool> enqueueRawData(const QByteArray &data, bool ignorePrinterState,
+                                          PrintPriority priority) const;
+    CancelableFuture<bool> enqueueToLane(const QByteArray &data, bool ignorePrinterState,
+                                         PrintPriority priority) const;
+    Future<bool> printFile(const QString &fileName, unsigned int quantity, bool ignorePrinterState,
+                           const Future<bool> &canceled) const;
 
     Future<bool> printerIsReady() const;
+    Future<bool> checkPrinterState() const;
+    Future<bool> queryPrinterState() const;
     Future<bool> checkLpOptions() const;
+    Future<bool> checkIppStatus(const QSharedPointer<Proof::NetworkServices::IppApi> &ippApi) const;
+    Future<bool> checkSnmpStatus(int snmpPort, const QByteArray &snmpCommunity) const;
+    Future<QString> checkJobOutcome(const QString &jobId) const;
+
+    Future<bool> writeToCapture(const QByteArray &data) const;
+    QStringList lprArguments() const;
+    QStringList lpArguments() const;
+    QString lpqProgram() const;
+    QStringList lpqArguments() const;
+    Future<bool> runLpr(const QString &program, const QStringList &args, const QByteArray &input,
+                        const Future<bool> &canceled) const;
+    Future<LprCommandResult> runLprCommand(const QString &program, const QStringList &args, const QByteArray &input,
+                                           const Future<bool> &canceled) const;
+
+    CancelableFuture<bool> coalesceRawData(const QByteArray &data, bool ignorePrinterState,
+                                           PrintPriority priority) const;
+    void flushCoalesced() const;
+
+    struct StatusSourceSettings
+    {
+        QSharedPointer<Proof::NetworkServices::IppApi> ippApi;
+        int snmpPort = 0;
+        QByteArray snmpCommunity = QByteArrayLiteral("public");
+    };
+    StatusSourceSettings currentStatusSource() const;
+
+    struct CoalescedBatch
+    {
+        QVector<QByteArray> labels;
+        QVector<Promise<bool>> promises;
+        int bytes = 0;
+        bool ignorePrinterState = true;
+        PrintPriority priority = PrintPriority::Bulk;
+    };
 
     QString printerName;
     QString printerHost;
     bool strictPrinterCheck = false;
+    PrintLaneSP lane;
+    PrintRateLimiterSP rateLimiter;
+    PrintCaptureSP capture;
+    int rawPort = 0;
+    std::function<void(const QString &, qint64, qint64)> fileProgressCallback;
+    // Status source can be changed by printer while lane jobs check status, they work with snapshot of it
+    mutable QMutex statusSourceMutex;
+    StatusSourceSettings statusSource;
+
+    // Owned by printer, once it is destroyed labels are not held back anymore
+    QPointer<QTimer> coalescingTimer;
+    mutable QMutex coalescingMutex;
+    mutable CoalescedBatch coalescedBatch;
+    bool coalescingEnabled = false;
+    int coalescingMaxBytes = DEFAULT_COALESCING_MAX_BYTES;
+
+    mutable QMutex readinessMutex;
+    mutable QElapsedTimer readySince;
+    int readinessCacheTime = DEFAULT_READINESS_CACHE_TIME;
+};
+
+class LprPrinterPrivate : public ProofObjectPrivate
+{
+    Q_DECLARE_PUBLIC(LprPrinter)
+
+    QSharedPointer<LprPrinterBackend> backend = QSharedPointer<LprPrinterBackend>::create();
+    int laneObserverId = 0;
+    PrintJobTrackerSP tracker;
+    PrintSpoolSP spool;
+    QTimer *coalescingTimer = nullptr;
 };
 } // namespace Hardware
 } // namespace Proof
@@ -76,301 +169,947 @@ LprPrinter::LprPrinter(const QString &printerHost, const QString &printerName, b
     : ProofObject(*new LprPrinterPrivate, parent)
 {
     Q_D(LprPrinter);
-    d->printerName = printerName.trimmed();
-    d->printerHost = printerHost.trimmed();
-    d->strictPrinterCheck = strictPrinterCheck;
+    d->backend->printerName = printerName.trimmed();
+    d->backend->printerHost = printerHost.trimmed();
+    d->backend->strictPrinterCheck = strictPrinterCheck;
+    d->backend->lane = PrintLane::forPrinter(d->backend->printerHost, d->backend->printerName);
+    d->laneObserverId = d->backend->lane->addObserver([this] { emit queueChanged(); });
+    d->tracker = PrintJobTracker::forPrinter(d->backend->printerHost, d->backend->printerName);
+    d->tracker->setQueueCommand(d->backend->lpqProgram(), d->backend->lpqArguments());
+    d->backend->rateLimiter = PrintRateLimiterSP::create();
+    QPointer<LprPrinter> guardedThis = this;
+    d->backend->fileProgressCallback = [guardedThis](const QString &fileName, qint64 bytesSent, qint64 bytesTotal) {
+        if (guardedThis)
+            emit guardedThis->fileProgress(fileName, bytesSent, bytesTotal);
+    };
+    d->coalescingTimer = new QTimer(this);
+    d->coalescingTimer->setSingleShot(true);
+    d->coalescingTimer->setInterval(DEFAULT_COALESCING_WINDOW);
+    d->backend->coalescingTimer = d->coalescingTimer;
+    connect(d->coalescingTimer, &QTimer::timeout, this, [d] { d->backend->flushCoalesced(); });
     qCDebug(proofUtilsLprPrinterInfoLog) << "Label printer name:" << printerName << "at host" << printerHost;
     if (printerHost.isEmpty() && printerName.isEmpty())
         qCWarning(proofUtilsLprPrinterInfoLog) << QStringLiteral("Empty printer!");
-    asynqro::tasks::TasksDispatcher::instance()->addCustomTag(RESTRICTOR, 1);
 }
 
-Future<bool> LprPrinter::printRawData(const QByteArray &data, bool ignorePrinterState) const
+LprPrinter::~LprPrinter()
+{
+    Q_D(LprPrinter);
+    d->backend->lane->removeObserver(d->laneObserverId);
+    QMutexLocker locker(&d->backend->coalescingMutex);
+    for (const auto &promise : qAsConst(d->backend->coalescedBatch.promises)) {
+        promise.failure(Failure(QStringLiteral("Printing aborted.\nPrinter was destroyed."), UTILS_MODULE_CODE,
+                                UtilsErrorCode::LabelPrinterError));
+    }
+    d->backend->coalescedBatch = LprPrinterBackend::CoalescedBatch();
+}
+
+CancelableFuture<bool> LprPrinter::printRawData(const QByteArray &data, bool ignorePrinterState,
+                                                PrintPriority priority, int copies) const
 {
     Q_D_CONST(LprPrinter);
-    return d->printRawData(data, ignorePrinterState);
+    QByteArray dataToPrint = EplLabelGenerator::labelWithCopies(data, copies);
+    if (d->spool) {
+        auto send = [backend = d->backend, ignorePrinterState, priority](const QByteArray &label) {
+            return backend->enqueueRawData(label, ignorePrinterState, priority);
+        };
+        return d->spool->print(dataToPrint, send);
+    }
+    return d->backend->enqueueRawData(dataToPrint, ignorePrinterState, priority);
 }
 
-Future<bool> LprPrinter::printFile(const QString &fileName, unsigned int quantity, bool ignorePrinterState) const
+CancelableFuture<bool> LprPrinter::printFile(const QString &fileName, unsigned int quantity, bool ignorePrinterState,
+                                             PrintPriority priority) const
 {
     Q_D_CONST(LprPrinter);
-    return d->printFile(fileName, quantity, ignorePrinterState);
+    return d->backend->lane->enqueue(
+        [backend = d->backend, fileName, quantity, ignorePrinterState](const Future<bool> &canceled) {
+            return backend->printFile(fileName, quantity, ignorePrinterState, canceled);
+        },
+        priority);
+}
+
+CancelableFuture<QString> LprPrinter::printRawDataTracked(const QByteArray &data, bool ignorePrinterState,
+                                                         PrintPriority priority) const
+{
+    Q_D_CONST(LprPrinter);
+    QString jobTitle = PrintJobTracker::uniqueJobTitle();
+    auto jobId = QSharedPointer<QString>::create();
+    auto send = [backend = d->backend, ignorePrinterState, priority, jobTitle, jobId](const QByteArray &label) {
+        return backend->lane->enqueue(
+            [backend, label, ignorePrinterState, jobTitle, jobId](const Future<bool> &canceled) {
+                return backend->printRawData(label, ignorePrinterState, canceled, jobTitle)
+                    .map([jobId](const QString &submittedJobId) {
+                        *jobId = submittedJobId;
+                        return true;
+                    });
+            },
+            priority, label.size());
+    };
+    CancelableFuture<bool> accepted = d->spool ? d->spool->print(data, send) : send(data);
+
+    Promise<QString> promise;
+    PrintJobTrackerSP tracker = d->backend->capture ? PrintJobTrackerSP() : d->tracker;
+    accepted
+        .flatMap([backend = d->backend, tracker, jobTitle, jobId](bool) {
+            if (!tracker)
+                return Future<QString>::successful(jobTitle);
+            return tracker->track(jobTitle, *jobId).flatMap(
+                [backend](const QString &trackedJobId) { return backend->checkJobOutcome(trackedJobId); });
+        })
+        .onSuccess([promise](const QString &jobId) { promise.success(jobId); })
+        .onFailure([promise](const Failure &failure) { promise.failure(failure); });
+    promise.future().onFailure([accepted](const Failure &) mutable { accepted.cancel(); });
+    return CancelableFuture<QString>(promise);
 }
 
 Future<bool> LprPrinter::printerIsReady() const
 {
     Q_D_CONST(LprPrinter);
-    return d->printerIsReady();
+    return d->backend->checkPrinterState();
 }
 
-Future<bool> LprPrinterPrivate::printRawData(const QByteArray &data, bool ignorePrinterState) const
+Future<bool> LprPrinter::warmUp() const
 {
-    Future<bool> status = ignorePrinterState ? futures::successful(true) : printerIsReady();
-    return status.andThen([this, data] {
-        return tasks::run(tasks::TaskType::Custom, RESTRICTOR, [this, data]() -> bool {
-            QScopedPointer<QProcess> printProcess(new QProcess);
+    Q_D_CONST(LprPrinter);
+    qCDebug(proofUtilsLprPrinterInfoLog) << "Warming up" << d->backend->printerHost << d->backend->printerName;
+    return d->backend->checkPrinterState();
+}
 
-            QStringList args;
-            if (!printerHost.isEmpty()) {
-#ifdef Q_OS_WIN
-                args << "-S" << printerHost;
-#else
-                args << QStringLiteral("-H") << printerHost;
-#endif
-            }
-            if (!printerName.isEmpty())
-                args << QStringLiteral("-P") << printerName;
+int LprPrinter::readinessCacheTime() const
+{
+    Q_D_CONST(LprPrinter);
+    QMutexLocker locker(&d->backend->readinessMutex);
+    return d->backend->readinessCacheTime;
+}
 
-#ifdef Q_OS_WIN
-            QFile printFile;
-            printFile.setFileName(QStringLiteral("%1/proof_last_label_to_print").arg(QDir::tempPath()));
-            if (!printFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
-                qCWarning(proofUtilsLprPrinterInfoLog) << "Can't open temporary file";
-                return WithFailure(QStringLiteral("Printing aborted.\nCan't open temporary file."), UTILS_MODULE_CODE,
-                                   UtilsErrorCode::TemporaryFileError);
-            }
-            printFile.write(data);
-            printFile.close();
-            args << QStringLiteral("-o") << QStringLiteral("l") << printFile.fileName().replace("/", "\\");
-            printProcess->start(system32Path() + "\\lpr.exe", args);
-#else
-            printProcess->start(QStringLiteral("lpr"), args);
-#endif
-            qCDebug(proofUtilsLprPrinterDataLog) << "Lpr started as" << printProcess->program() << args;
-
-            printProcess->waitForStarted();
-            if (printProcess->error() == QProcess::UnknownError) {
-#ifndef Q_OS_WIN
-                printProcess->write(data);
-                while (printProcess->bytesToWrite())
-                    printProcess->waitForBytesWritten();
-                printProcess->closeWriteChannel();
-#endif
-                printProcess->waitForFinished();
-            } else {
-                printProcess->waitForFinished();
-                qCWarning(proofUtilsLprPrinterInfoLog) << "lpr can't be started";
-                return WithFailure(QStringLiteral("Printing aborted.\nCan't start lpr."), UTILS_MODULE_CODE,
-                                   UtilsErrorCode::LprCannotBeStarted);
-            }
+void LprPrinter::setReadinessCacheTime(int msecs)
+{
+    Q_D(LprPrinter);
+    QMutexLocker locker(&d->backend->readinessMutex);
+    d->backend->readinessCacheTime = qMax(0, msecs);
+}
 
-            if (printProcess->exitCode()) {
-                qCWarning(proofUtilsLprPrinterInfoLog)
-                    << "lpr finished with non-zero code, probably nothing was printed" << printProcess->exitCode()
-                    << printProcess->readAllStandardError().replace("\n", " ")
-                    << printProcess->readAllStandardOutput().replace("\n", " ");
-                return WithFailure(QStringLiteral("Printing probably not finished.\nProcess exited with code %1.")
-                                       .arg(printProcess->exitCode()),
-                                   UTILS_MODULE_CODE, UtilsErrorCode::LprProcessNonZeroExitCode);
-            }
-            qCDebug(proofUtilsLprPrinterInfoLog) << "Raw data printed";
-            return true;
-        });
+Future<bool> LprPrinter::spoolRawData(const QByteArray &data, bool ignorePrinterState, PrintPriority priority) const
+{
+    Q_D_CONST(LprPrinter);
+    if (!d->spool)
+        return printRawData(data, ignorePrinterState, priority);
+    return d->spool->spool(data, [backend = d->backend, ignorePrinterState, priority](const QByteArray &label) {
+        return backend->enqueueRawData(label, ignorePrinterState, priority);
+    });
+}
+
+Future<bool> LprPrinter::replaySpool() const
+{
+    Q_D_CONST(LprPrinter);
+    if (!d->spool)
+        return futures::successful(true);
+    return d->spool->replay([backend = d->backend](const QByteArray &label) {
+        return backend->enqueueRawData(label, false, PrintPriority::Normal);
     });
 }
 
-Future<bool> LprPrinterPrivate::printFile(const QString &fileName, unsigned int quantity, bool ignorePrinterState) const
+PrintSpoolSP LprPrinter::spool() const
+{
+    Q_D_CONST(LprPrinter);
+    return d->spool;
+}
+
+void LprPrinter::setSpool(const PrintSpoolSP &spool)
+{
+    Q_D(LprPrinter);
+    d->spool = spool;
+}
+
+PrintCaptureSP LprPrinter::capture() const
+{
+    Q_D_CONST(LprPrinter);
+    return d->backend->capture;
+}
+
+void LprPrinter::setCapture(const PrintCaptureSP &capture)
+{
+    Q_D(LprPrinter);
+    d->backend->capture = capture;
+}
+
+int LprPrinter::rawPort() const
+{
+    Q_D_CONST(LprPrinter);
+    return d->backend->rawPort;
+}
+
+void LprPrinter::setRawPort(int port)
 {
+    Q_D(LprPrinter);
+    d->backend->rawPort = qMax(0, port);
+}
+
+int LprPrinter::jobPollInterval() const
+{
+    Q_D_CONST(LprPrinter);
+    return d->tracker->pollInterval();
+}
+
+void LprPrinter::setJobPollInterval(int msecs)
+{
+    Q_D(LprPrinter);
+    d->tracker->setPollInterval(msecs);
+}
+
+LprPrinter::StatusSource LprPrinter::statusSource() const
+{
+    Q_D_CONST(LprPrinter);
+    auto settings = d->backend->currentStatusSource();
+    if (settings.snmpPort)
+        return StatusSource::Snmp;
+    return settings.ippApi ? StatusSource::Ipp : StatusSource::LprUtilities;
+}
+
+void LprPrinter::setStatusSource(StatusSource source, int port)
+{
+    Q_D(LprPrinter);
+    QSharedPointer<Proof::NetworkServices::IppApi> ippApi;
+    int snmpPort = 0;
+    if (source == StatusSource::Snmp) {
+        snmpPort = port > 0 ? port : DEFAULT_SNMP_PORT;
+    } else if (source == StatusSource::Ipp && d->backend->printerName.isEmpty()) {
+        qCWarning(proofUtilsLprPrinterInfoLog) << "IPP status can't be used for default printer, lpq will be used";
+    } else if (source == StatusSource::Ipp) {
+        auto restClient = Proof::RestClientSP::create();
+        restClient->setAuthType(Proof::RestAuthType::NoAuth);
+        restClient->setScheme(QStringLiteral("http"));
+        restClient->setHost(d->backend->printerHost.isEmpty() ? QStringLiteral("127.0.0.1")
+                                                              : d->backend->printerHost);
+        restClient->setPort(port > 0 ? port : DEFAULT_IPP_PORT);
+        ippApi.reset(new Proof::NetworkServices::IppApi(restClient), &QObject::deleteLater);
+    }
+    // Jobs that already took previous IPP client keep it alive till they are done
+    QMutexLocker locker(&d->backend->statusSourceMutex);
+    d->backend->statusSource.ippApi = ippApi;
+    d->backend->statusSource.snmpPort = snmpPort;
+}
+
+QByteArray LprPrinter::snmpCommunity() const
+{
+    Q_D_CONST(LprPrinter);
+    return d->backend->currentStatusSource().snmpCommunity;
+}
+
+void LprPrinter::setSnmpCommunity(const QByteArray &community)
+{
+    Q_D(LprPrinter);
+    QMutexLocker locker(&d->backend->statusSourceMutex);
+    d->backend->statusSource.snmpCommunity = community;
+}
+
+bool LprPrinter::coalescingEnabled() const
+{
+    Q_D_CONST(LprPrinter);
+    QMutexLocker locker(&d->backend->coalescingMutex);
+    return d->backend->coalescingEnabled;
+}
+
+void LprPrinter::setCoalescingEnabled(bool enabled)
+{
+    Q_D(LprPrinter);
+    {
+        QMutexLocker locker(&d->backend->coalescingMutex);
+        d->backend->coalescingEnabled = enabled;
+    }
+    if (!enabled)
+        d->backend->flushCoalesced();
+}
+
+int LprPrinter::coalescingWindow() const
+{
+    Q_D_CONST(LprPrinter);
+    return d->coalescingTimer->interval();
+}
+
+void LprPrinter::setCoalescingWindow(int msecs)
+{
+    Q_D(LprPrinter);
+    d->coalescingTimer->setInterval(qMax(0, msecs));
+}
+
+int LprPrinter::coalescingMaxBytes() const
+{
+    Q_D_CONST(LprPrinter);
+    QMutexLocker locker(&d->backend->coalescingMutex);
+    return d->backend->coalescingMaxBytes;
+}
+
+void LprPrinter::setCoalescingMaxBytes(int bytes)
+{
+    Q_D(LprPrinter);
+    QMutexLocker locker(&d->backend->coalescingMutex);
+    d->backend->coalescingMaxBytes = qMax(1, bytes);
+}
+
+double LprPrinter::printRate() const
+{
+    Q_D_CONST(LprPrinter);
+    return d->backend->rateLimiter->rate();
+}
+
+int LprPrinter::printRateBurst() const
+{
+    Q_D_CONST(LprPrinter);
+    return d->backend->rateLimiter->burst();
+}
+
+void LprPrinter::setPrintRate(double labelsPerSecond, int burst)
+{
+    Q_D(LprPrinter);
+    d->backend->rateLimiter->setRate(labelsPerSecond, burst);
+}
+
+void LprPrinter::setPrintRate(const EplLabelGenerator &generator, int burst)
+{
+    setPrintRate(generator.labelsPerSecond(), burst);
+}
+
+int LprPrinter::laneCapacity() const
+{
+    Q_D_CONST(LprPrinter);
+    return d->backend->lane->capacity();
+}
+
+void LprPrinter::setLaneCapacity(int capacity)
+{
+    Q_D(LprPrinter);
+    d->backend->lane->setCapacity(capacity);
+}
+
+int LprPrinter::priorityAgingInterval() const
+{
+    Q_D_CONST(LprPrinter);
+    return d->backend->lane->agingInterval();
+}
+
+void LprPrinter::setPriorityAgingInterval(int msecs)
+{
+    Q_D(LprPrinter);
+    d->backend->lane->setAgingInterval(msecs);
+}
+
+int LprPrinter::maxQueuedJobs() const
+{
+    Q_D_CONST(LprPrinter);
+    return d->backend->lane->maxJobs();
+}
+
+void LprPrinter::setMaxQueuedJobs(int jobs)
+{
+    Q_D(LprPrinter);
+    d->backend->lane->setMaxJobs(jobs);
+}
+
+qint64 LprPrinter::maxQueuedBytes() const
+{
+    Q_D_CONST(LprPrinter);
+    return d->backend->lane->maxBytes();
+}
+
+void LprPrinter::setMaxQueuedBytes(qint64 bytes)
+{
+    Q_D(LprPrinter);
+    d->backend->lane->setMaxBytes(bytes);
+}
+
+PrintQueueOverflowPolicy LprPrinter::overflowPolicy() const
+{
+    Q_D_CONST(LprPrinter);
+    return d->backend->lane->overflowPolicy();
+}
+
+void LprPrinter::setOverflowPolicy(PrintQueueOverflowPolicy policy)
+{
+    Q_D(LprPrinter);
+    d->backend->lane->setOverflowPolicy(policy);
+}
+
+qint64 LprPrinter::queuedBytes() const
+{
+    Q_D_CONST(LprPrinter);
+    return d->backend->lane->bytesCount();
+}
+
+int LprPrinter::availableJobs() const
+{
+    Q_D_CONST(LprPrinter);
+    return d->backend->lane->availableJobs();
+}
+
+qint64 LprPrinter::availableBytes() const
+{
+    Q_D_CONST(LprPrinter);
+    return d->backend->lane->availableBytes();
+}
+
+int LprPrinter::queuedJobsCount() const
+{
+    Q_D_CONST(LprPrinter);
+    return d->backend->lane->queuedCount();
+}
+
+int LprPrinter::runningJobsCount() const
+{
+    Q_D_CONST(LprPrinter);
+    return d->backend->lane->runningCount();
+}
+
+Future<QString> LprPrinterBackend::printRawData(const QByteArray &data, bool ignorePrinterState,
+                                               const Future<bool> &canceled, const QString &jobTitle) const
+{
+    auto self = sharedFromThis();
+    if (capture)
+        return writeToCapture(data).map([](bool) { return QString(); });
     Future<bool> status = ignorePrinterState ? futures::successful(true) : printerIsReady();
-    return status.andThen([this, fileName, quantity] {
-        return tasks::run(tasks::TaskType::Custom, RESTRICTOR, [this, fileName, quantity]() -> bool {
+    PrintRateLimiterSP limiter = rateLimiter;
+    status = status.andThen(
+        [limiter, data, canceled] { return limiter->acquire(PrintRateLimiter::labelsCount(data), canceled); });
+    return status.andThen([self, this, data, canceled, jobTitle]() -> Future<QString> {
 #ifdef Q_OS_WIN
-            unsigned int qty = quantity;
-            while (qty--) {
-#endif
-                QScopedPointer<QProcess> printProcess(new QProcess);
-                QStringList args;
-                if (!printerHost.isEmpty()) {
-#ifdef Q_OS_WIN
-                    args << "-S" << printerHost;
+        QStringList args = lprArguments();
+        if (!jobTitle.isEmpty())
+            args << QStringLiteral("-J") << jobTitle;
+        QTemporaryFile printFile(QStringLiteral("%1/proof_label_to_print_XXXXXX").arg(QDir::tempPath()));
+        printFile.setAutoRemove(false);
+        if (!printFile.open()) {
+            qCWarning(proofUtilsLprPrinterInfoLog) << "Can't open temporary file";
+            return WithFailure(QStringLiteral("Printing aborted.\nCan't open temporary file."), UTILS_MODULE_CODE,
+                               UtilsErrorCode::TemporaryFileError);
+        }
+        printFile.write(data);
+        printFile.close();
+        QString printFileName = printFile.fileName();
+        args << QStringLiteral("-o") << QStringLiteral("l") << QString(printFileName).replace("/", "\\");
+        return runLpr(system32Path() + "\\lpr.exe", args, QByteArray(), canceled)
+            .onSuccess([](bool) { qCDebug(proofUtilsLprPrinterInfoLog) << "Raw data printed"; })
+            .onFailure([printFileName](const Failure &) { QFile::remove(printFileName); })
+            .onSuccess([printFileName](bool) { QFile::remove(printFileName); })
+            .map([](bool) { return QString(); });
 #else
-                    args << QStringLiteral("-H") << printerHost;
+        if (jobTitle.isEmpty()) {
+            return runLpr(QStringLiteral("lpr"), lprArguments(), data, canceled).map([](bool) {
+                qCDebug(proofUtilsLprPrinterInfoLog) << "Raw data printed";
+                return QString();
+            });
+        }
+        // Unlike lpr, lp reports id of submitted job, so it is used for tracked jobs
+        QStringList args = lpArguments() << QStringLiteral("-t") << jobTitle;
+        return runLprCommand(QStringLiteral("lp"), args, data, canceled).map([](const LprCommandResult &result) {
+            QString jobId = PrintJobTracker::parseRequestId(QString::fromLocal8Bit(result.standardOutput));
+            qCDebug(proofUtilsLprPrinterInfoLog) << "Raw data printed as job" << jobId;
+            return jobId;
+        });
 #endif
-                }
-                if (!printerName.isEmpty())
-                    args << QStringLiteral("-P") << printerName;
+    });
+}
+
+CancelableFuture<bool> LprPrinterBackend::enqueueRawData(const QByteArray &data, bool ignorePrinterState,
+                                                         PrintPriority priority) const
+{
+    bool coalesce = false;
+    {
+        QMutexLocker locker(&coalescingMutex);
+        coalesce = coalescingEnabled;
+    }
+    // Interactive labels are never held back in coalescing window
+    if (coalesce && priority != PrintPriority::Interactive)
+        return coalesceRawData(data, ignorePrinterState, priority);
+    return enqueueToLane(data, ignorePrinterState, priority);
+}
+
+CancelableFuture<bool> LprPrinterBackend::enqueueToLane(const QByteArray &data, bool ignorePrinterState,
+                                                        PrintPriority priority) const
+{
+    auto self = sharedFromThis();
+    return lane->enqueue(
+        [self, this, data, ignorePrinterState](const Future<bool> &canceled) {
+            return printRawData(data, ignorePrinterState, canceled).map([](const QString &) { return true; });
+        },
+        priority, data.size());
+}
 
+CancelableFuture<bool> LprPrinterBackend::coalesceRawData(const QByteArray &data, bool ignorePrinterState,
+                                                          PrintPriority priority) const
+{
+    Promise<bool> promise;
+    bool overflows = false;
+    bool flushNow = false;
+    bool startTimer = false;
+    {
+        QMutexLocker locker(&coalescingMutex);
+        // Batch goes to lane as one job. Label that would make it exceed lane limits is not held back,
+        // so lane applies its overflow policy to it right away
+        overflows = !lane->canAdmit(coalescedBatch.bytes + data.size());
+        if (!overflows) {
+            startTimer = coalescedBatch.promises.isEmpty();
+            coalescedBatch.labels << data;
+            coalescedBatch.bytes += data.size();
+            coalescedBatch.promises << promise;
+            coalescedBatch.ignorePrinterState = coalescedBatch.ignorePrinterState && ignorePrinterState;
+            coalescedBatch.priority = qMin(coalescedBatch.priority, priority);
+            flushNow = coalescedBatch.bytes >= coalescingMaxBytes;
+        }
+    }
+    if (overflows) {
+        flushCoalesced();
+        return enqueueToLane(data, ignorePrinterState, priority);
+    }
+
+    QPointer<QTimer> timer = coalescingTimer;
+    if (flushNow || !timer) {
+        flushCoalesced();
+    } else if (startTimer) {
+        QMetaObject::invokeMethod(timer, [timer] { timer->start(); }, Qt::QueuedConnection);
+    }
+    return CancelableFuture<bool>(promise);
+}
+
+void LprPrinterBackend::flushCoalesced() const
+{
+    CoalescedBatch batch;
+    {
+        QMutexLocker locker(&coalescingMutex);
+        std::swap(batch, coalescedBatch);
+    }
+    // Labels canceled while waiting in coalescing window are not sent at all
+    QByteArray data;
+    data.reserve(batch.bytes);
+    QVector<Promise<bool>> promises;
+    for (int i = 0; i < batch.labels.count(); ++i) {
+        if (batch.promises[i].isFilled())
+            continue;
+        data.append(batch.labels[i]);
+        promises << batch.promises[i];
+    }
+    if (promises.isEmpty())
+        return;
+
+    qCDebug(proofUtilsLprPrinterDataLog) << "Submitting" << promises.count() << "coalesced labels (" << data.size()
+                                         << "bytes) to" << printerHost << printerName;
+    bool ignorePrinterState = batch.ignorePrinterState;
+    auto self = sharedFromThis();
+    auto job = [self, this, data, ignorePrinterState](const Future<bool> &canceled) {
+        return printRawData(data, ignorePrinterState, canceled).map([](const QString &) { return true; });
+    };
+    CancelableFuture<bool> merged = lane->enqueue(job, batch.priority, data.size());
+    merged
+        .onSuccess([promises](bool result) {
+            for (const auto &promise : promises)
+                promise.success(result);
+        })
+        .onFailure([promises](const Failure &failure) {
+            for (const auto &promise : promises)
+                promise.failure(failure);
+        });
+    // Merged job is canceled once all of its labels are canceled
+    auto activeLabels = QSharedPointer<QAtomicInt>::create(promises.count());
+    for (const auto &promise : qAsConst(promises)) {
+        promise.future().onFailure([activeLabels, merged](const Failure &) mutable {
+            if (!activeLabels->deref())
+                merged.cancel();
+        });
+    }
+}
+
+Future<bool> LprPrinterBackend::printFile(const QString &fileName, unsigned int quantity, bool ignorePrinterState,
+                                         const Future<bool> &canceled) const
+{
+    auto self = sharedFromThis();
+    if (capture) {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return Future<bool>::failed(Failure(QStringLiteral("Printing aborted.\nCan't open %1.").arg(fileName),
+                                                UTILS_MODULE_CODE, UtilsErrorCode::PrintFileCannotBeOpened));
+        }
+        return writeToCapture(file.readAll().repeated(static_cast<int>(quantity)));
+    }
+    Future<bool> status = ignorePrinterState ? futures::successful(true) : printerIsReady();
+    return status.andThen([self, this, fileName, quantity, canceled]() -> Future<bool> {
+        if (rawPort > 0 && !printerHost.isEmpty()) {
+            auto progress = fileProgressCallback;
+            return RawSocketSender::sendFile(printerHost, rawPort, fileName, quantity, canceled,
+                                             [progress, fileName](qint64 sent, qint64 total) {
+                                                 progress(fileName, sent, total);
+                                             })
+                .onSuccess([](bool) { qCDebug(proofUtilsLprPrinterInfoLog) << "File streamed to printer"; });
+        }
+        QStringList args = lprArguments();
 #ifdef Q_OS_WIN
-                args << QStringLiteral("-o") << QStringLiteral("l") << QString(fileName).replace("/", "\\");
-                printProcess->start(system32Path() + "\\lpr.exe", args);
+        args << QStringLiteral("-o") << QStringLiteral("l") << QString(fileName).replace("/", "\\");
+        Future<bool> result = futures::successful(true);
+        for (unsigned int i = 0; i < quantity; ++i)
+            result = result.andThen([self, this, args, canceled] {
+                return runLpr(system32Path() + "\\lpr.exe", args, QByteArray(), canceled);
+            });
 #else
-                args << QStringLiteral("-#") << QString::number(quantity) << fileName;
-                printProcess->start(QStringLiteral("lpr"), args);
+        args << QStringLiteral("-#") << QString::number(quantity) << fileName;
+        Future<bool> result = runLpr(QStringLiteral("lpr"), args, QByteArray(), canceled);
 #endif
+        return result.onSuccess([](bool) { qCDebug(proofUtilsLprPrinterInfoLog) << "File printed"; });
+    });
+}
 
-                qCDebug(proofUtilsLprPrinterDataLog) << "Lpr started as" << printProcess->program() << args;
-                printProcess->waitForStarted();
-                QProcess::ProcessError startError = printProcess->error();
-                printProcess->waitForFinished();
-                if (startError != QProcess::UnknownError) {
-                    qCWarning(proofUtilsLprPrinterInfoLog) << "lpr can't be started";
-                    return WithFailure(QStringLiteral("Printing aborted.\nCan't start lpr."), UTILS_MODULE_CODE,
-                                       UtilsErrorCode::LprCannotBeStarted);
-                }
-
-                if (printProcess->exitCode()) {
-                    qCWarning(proofUtilsLprPrinterInfoLog)
-                        << "lpr finished with non-zero code, probably nothing was printed" << printProcess->exitCode()
-                        << printProcess->readAllStandardError().replace("\n", " ")
-                        << printProcess->readAllStandardOutput().replace("\n", " ");
-                    return WithFailure(QStringLiteral("Printing probably not finished.\nProcess exited with code %1.")
-                                           .arg(printProcess->exitCode()),
-                                       UTILS_MODULE_CODE, UtilsErrorCode::LprProcessNonZeroExitCode);
-                }
-                qCDebug(proofUtilsLprPrinterInfoLog) << "File printed";
-#ifdef Q_OS_WIN
-            }
-#endif
-            return true;
+Future<bool> LprPrinterBackend::printerIsReady() const
+{
+    {
+        QMutexLocker locker(&readinessMutex);
+        if (readySince.isValid() && readySince.elapsed() < readinessCacheTime)
+            return futures::successful(true);
+    }
+    return checkPrinterState();
+}
+
+Future<bool> LprPrinterBackend::checkPrinterState() const
+{
+    auto self = sharedFromThis();
+    return queryPrinterState()
+        .onSuccess([self, this](bool) {
+            QMutexLocker locker(&readinessMutex);
+            readySince.start();
+        })
+        .onFailure([self, this](const Failure &) {
+            QMutexLocker locker(&readinessMutex);
+            readySince.invalidate();
         });
-    });
 }
 
-Future<bool> LprPrinterPrivate::printerIsReady() const
+Future<bool> LprPrinterBackend::queryPrinterState() const
 {
+    auto self = sharedFromThis();
+    if (capture)
+        return futures::successful(true);
+
     if (printerHost.isEmpty() && printerName.isEmpty()) {
         return Future<bool>::failed(Failure(EMPTY_PRINTER_TEXT, UTILS_MODULE_CODE, UtilsErrorCode::LpqCannotBeStarted));
     }
 
-    return tasks::run(tasks::TaskType::Custom, RESTRICTOR, [this]() -> Future<bool> {
-        QScopedPointer<QProcess> queueProcess(new QProcess);
-        QStringList args;
-        if (!printerHost.isEmpty()) {
-#ifdef Q_OS_WIN
-            args << "-S" << printerHost;
-#else
-            args << QStringLiteral("-h") << printerHost;
-#endif
-        }
-        if (!printerName.isEmpty())
-            args << QStringLiteral("-P") << printerName;
-#ifdef Q_OS_WIN
-        queueProcess->start(system32Path() + "\\lpq.exe", args);
-#else
-        queueProcess->start(QStringLiteral("lpq"), args);
-#endif
-        queueProcess->waitForStarted();
-        if (queueProcess->error() == QProcess::UnknownError) {
-            queueProcess->waitForReadyRead();
-            queueProcess->waitForFinished();
-            QString queueInfo = queueProcess->readAll().trimmed().toLower();
-            qCDebug(proofUtilsLprPrinterDataLog) << "Queue info for" << printerHost << printerName << ":" << queueInfo;
-            if (queueInfo.isEmpty()) {
-                QString errorOutput = queueProcess->readAllStandardError();
-                qCWarning(proofUtilsLprPrinterInfoLog) << "Queue info for" << printerHost << printerName
-                                                       << "is empty. Probably printer doesn't exist." << errorOutput;
-                return WithFailure(QStringLiteral(
-                                       "Can't query printer %1@%2 info.\nProbably this printer doesn't exist\n%3")
-                                       .arg(printerName.isEmpty() ? QStringLiteral("default") : printerName,
-                                            printerHost.isEmpty() ? QStringLiteral("localhost") : printerHost,
-                                            errorOutput),
-                                   UTILS_MODULE_CODE, UtilsErrorCode::PrinterInfoCannotBeQueried);
+    auto source = currentStatusSource();
+    if (source.snmpPort)
+        return checkSnmpStatus(source.snmpPort, source.snmpCommunity);
+    if (source.ippApi)
+        return checkIppStatus(source.ippApi);
+
+    Future<LprCommandResult> queueCommand = LprCommandRunner::instance()->run(lpqProgram(), lpqArguments());
+    return queueCommand.flatMap([self, this](const LprCommandResult &result) -> Future<bool> {
+        if (!result.isStarted()) {
+            qCWarning(proofUtilsLprPrinterInfoLog) << "lpq can't be started";
+            if (strictPrinterCheck) {
+                return WithFailure(QStringLiteral("Printing aborted.\nCan't start lpq."), UTILS_MODULE_CODE,
+                                   UtilsErrorCode::LpqCannotBeStarted);
             }
+            return checkLpOptions();
+        }
 
-            if (queueInfo.contains(QStringLiteral("%1 is not ready").arg(printerName.toLower()))) {
-                qCWarning(proofUtilsLprPrinterInfoLog) << printerHost << printerName << "is not ready";
+        QString queueInfo = QString(result.standardOutput).trimmed().toLower();
+        qCDebug(proofUtilsLprPrinterDataLog) << "Queue info for" << printerHost << printerName << ":" << queueInfo;
+        if (queueInfo.isEmpty()) {
+            QString errorOutput = result.standardError;
+            qCWarning(proofUtilsLprPrinterInfoLog) << "Queue info for" << printerHost << printerName
+                                                   << "is empty. Probably printer doesn't exist." << errorOutput;
+            return WithFailure(QStringLiteral(
+                                   "Can't query printer %1@%2 info.\nProbably this printer doesn't exist\n%3")
+                                   .arg(printerName.isEmpty() ? QStringLiteral("default") : printerName,
+                                        printerHost.isEmpty() ? QStringLiteral("localhost") : printerHost, errorOutput),
+                               UTILS_MODULE_CODE, UtilsErrorCode::PrinterInfoCannotBeQueried);
+        }
+
+        if (queueInfo.contains(QStringLiteral("%1 is not ready").arg(printerName.toLower()))) {
+            qCWarning(proofUtilsLprPrinterInfoLog) << printerHost << printerName << "is not ready";
+            return WithFailure(QString(QObject::tr("Printer \n%1@%2 is not ready."))
+                                   .arg(printerName.isEmpty() ? QStringLiteral("default") : printerName,
+                                        printerHost.isEmpty() ? QStringLiteral("localhost") : printerHost),
+                               UTILS_MODULE_CODE, UtilsErrorCode::PrinterNotReady, Failure::UserFriendlyHint);
+        }
+
+        if (queueInfo.startsWith(QLatin1String("windows lpd"))) {
+            if (queueInfo.contains(QLatin1String("error:"))
+                || (!printerName.isEmpty() && !queueInfo.contains(printerName.toLower()))) {
+                qCWarning(proofUtilsLprPrinterInfoLog)
+                    << "Something is wrong with" << printerHost << printerName << ". Info:"
+                    << queueInfo.replace(QLatin1String("\n"), QLatin1String(" "))
+                           .replace(QLatin1String("\r"), QString());
                 return WithFailure(QString(QObject::tr("Printer \n%1@%2 is not ready."))
                                        .arg(printerName.isEmpty() ? QStringLiteral("default") : printerName,
                                             printerHost.isEmpty() ? QStringLiteral("localhost") : printerHost),
                                    UTILS_MODULE_CODE, UtilsErrorCode::PrinterNotReady, Failure::UserFriendlyHint);
             }
-
-            if (queueInfo.startsWith(QLatin1String("windows lpd"))) {
-                if (queueInfo.contains(QLatin1String("error:"))
-                    || (!printerName.isEmpty() && !queueInfo.contains(printerName.toLower()))) {
-                    qCWarning(proofUtilsLprPrinterInfoLog)
-                        << "Something is wrong with" << printerHost << printerName << ". Info:"
-                        << queueInfo.replace(QLatin1String("\n"), QLatin1String(" "))
-                               .replace(QLatin1String("\r"), QString());
-                    return WithFailure(QString(QObject::tr("Printer \n%1@%2 is not ready."))
-                                           .arg(printerName.isEmpty() ? QStringLiteral("default") : printerName,
-                                                printerHost.isEmpty() ? QStringLiteral("localhost") : printerHost),
-                                       UTILS_MODULE_CODE, UtilsErrorCode::PrinterNotReady, Failure::UserFriendlyHint);
-                }
-                qCWarning(proofUtilsLprPrinterInfoLog)
-                    << printerHost << printerName << "is hosted at Windows and probably is ready. Info:"
-                    << queueInfo.replace(QLatin1String("\n"), QLatin1String(" ")).replace(QLatin1String("\r"), QString());
-            } else if (!queueInfo.contains(QStringLiteral("%1 is ready").arg(printerName.toLower()))) {
-                qCWarning(proofUtilsLprPrinterInfoLog)
-                    << "Queue info for" << printerHost << printerName
-                    << "contains unrecognized info:" << queueInfo.replace(QLatin1String("\n"), QLatin1String(" "));
-                return WithFailure(QStringLiteral("Printer error.\nQueue info for %1@%2:\n%3")
-                                       .arg(printerName.isEmpty() ? QStringLiteral("default") : printerName,
-                                            printerHost.isEmpty() ? QStringLiteral("localhost") : printerHost, queueInfo),
-                                   UTILS_MODULE_CODE, UtilsErrorCode::PrinterInfoError);
-            }
-        } else {
-            queueProcess->waitForFinished();
-            qCWarning(proofUtilsLprPrinterInfoLog) << "lpq can't be started";
-            if (strictPrinterCheck) {
-                return WithFailure(QStringLiteral("Printing aborted.\nCan't start lpq."), UTILS_MODULE_CODE,
-                                   UtilsErrorCode::LpqCannotBeStarted);
-            }
+            qCWarning(proofUtilsLprPrinterInfoLog)
+                << printerHost << printerName << "is hosted at Windows and probably is ready. Info:"
+                << queueInfo.replace(QLatin1String("\n"), QLatin1String(" ")).replace(QLatin1String("\r"), QString());
+        } else if (!queueInfo.contains(QStringLiteral("%1 is ready").arg(printerName.toLower()))) {
+            qCWarning(proofUtilsLprPrinterInfoLog)
+                << "Queue info for" << printerHost << printerName
+                << "contains unrecognized info:" << queueInfo.replace(QLatin1String("\n"), QLatin1String(" "));
+            return WithFailure(QStringLiteral("Printer error.\nQueue info for %1@%2:\n%3")
+                                   .arg(printerName.isEmpty() ? QStringLiteral("default") : printerName,
+                                        printerHost.isEmpty() ? QStringLiteral("localhost") : printerHost, queueInfo),
+                               UTILS_MODULE_CODE, UtilsErrorCode::PrinterInfoError);
         }
 
         return checkLpOptions();
     });
 }
 
-Future<bool> LprPrinterPrivate::checkLpOptions() const
+Future<bool> LprPrinterBackend::checkLpOptions() const
 {
-    return tasks::run(tasks::TaskType::Custom, RESTRICTOR, [this]() -> bool {
-        QScopedPointer<QProcess> optionsProcess(new QProcess);
-        QStringList args;
-        if (!printerHost.isEmpty())
-            args << QStringLiteral("-h") << printerHost;
-        if (!printerName.isEmpty())
-            args << QStringLiteral("-p") << printerName;
+    auto self = sharedFromThis();
+    QStringList args;
+    if (!printerHost.isEmpty())
+        args << QStringLiteral("-h") << printerHost;
+    if (!printerName.isEmpty())
+        args << QStringLiteral("-p") << printerName;
 #ifdef Q_OS_WIN
-        optionsProcess->start(system32Path() + "lpoptions.exe", args);
+    QString program = system32Path() + "lpoptions.exe";
 #else
-        optionsProcess->start(QStringLiteral("lpoptions"), args);
+    QString program = QStringLiteral("lpoptions");
 #endif
-        optionsProcess->waitForStarted();
-        if (optionsProcess->error() == QProcess::UnknownError) {
-            optionsProcess->waitForReadyRead();
-            optionsProcess->waitForFinished();
-            QString options = optionsProcess->readAll().trimmed();
-            qCDebug(proofUtilsLprPrinterDataLog) << "LP Options for" << printerHost << printerName << ":" << options;
-            if (options.isEmpty()) {
-                QString errorOutput = optionsProcess->readAllStandardError();
-                qCWarning(proofUtilsLprPrinterInfoLog) << "options for" << printerHost << printerName
-                                                       << "are empty. Probably printer doesn't exist." << errorOutput;
-                return WithFailure(QStringLiteral("Printing aborted.\nCan't query lpoptions for %1@%2.\nProbably this "
-                                                  "printer doesn't exist\n%3")
-                                       .arg(printerName.isEmpty() ? QStringLiteral("default") : printerName,
-                                            printerHost.isEmpty() ? QStringLiteral("localhost") : printerHost,
-                                            errorOutput),
-                                   UTILS_MODULE_CODE, UtilsErrorCode::PrinterOptionsCannotBeQueried);
-            }
-            QRegExp stateRe = QRegExp("printer-state=([^\\s]*)");
-            QRegExp stateReasonsRe = QRegExp("printer-state-reasons=([^\\s]*)");
-            QString state;
-            QString stateReasons;
-            if (stateRe.indexIn(options) != -1)
-                state = stateRe.cap(1);
-            if (stateReasonsRe.indexIn(options) != -1)
-                stateReasons = stateReasonsRe.cap(1);
-            if (stateReasons.toLower() == QLatin1String("none"))
-                stateReasons = QString();
-            if (state == QLatin1String("5") || (state == QLatin1String("3") && !stateReasons.isEmpty())) {
-                qCWarning(proofUtilsLprPrinterInfoLog) << "lpoptions for" << printerHost << printerName
-                                                       << "returned bad state of printer" << state << stateReasons;
-                return WithFailure(QStringLiteral("Printing aborted.\nCheck %1@%2 printer.\nProbably it is offline or "
-                                                  "is in wrong state.\n%3: %4")
-                                       .arg(printerName.isEmpty() ? QStringLiteral("default") : printerName,
-                                            printerHost.isEmpty() ? QStringLiteral("localhost") : printerHost, state,
-                                            stateReasons),
-                                   UTILS_MODULE_CODE, UtilsErrorCode::PrinterOffline);
-            }
-        } else {
-            optionsProcess->waitForFinished();
+
+    Future<LprCommandResult> optionsCommand = LprCommandRunner::instance()->run(program, args);
+    return optionsCommand.map([self, this](const LprCommandResult &result) -> bool {
+        if (!result.isStarted()) {
             qCWarning(proofUtilsLprPrinterInfoLog) << "lpoptions can't be started";
             if (strictPrinterCheck) {
                 return WithFailure(QStringLiteral("Printing aborted.\nCan't start lpoptions."), UTILS_MODULE_CODE,
                                    UtilsErrorCode::LpoptionsCannotBeStarted);
             }
+            return true;
+        }
+
+        QString options = QString(result.standardOutput).trimmed();
+        qCDebug(proofUtilsLprPrinterDataLog) << "LP Options for" << printerHost << printerName << ":" << options;
+        if (options.isEmpty()) {
+            QString errorOutput = result.standardError;
+            qCWarning(proofUtilsLprPrinterInfoLog) << "options for" << printerHost << printerName
+                                                   << "are empty. Probably printer doesn't exist." << errorOutput;
+            return WithFailure(QStringLiteral("Printing aborted.\nCan't query lpoptions for %1@%2.\nProbably this "
+                                              "printer doesn't exist\n%3")
+                                   .arg(printerName.isEmpty() ? QStringLiteral("default") : printerName,
+                                        printerHost.isEmpty() ? QStringLiteral("localhost") : printerHost, errorOutput),
+                               UTILS_MODULE_CODE, UtilsErrorCode::PrinterOptionsCannotBeQueried);
+        }
+        QRegExp stateRe = QRegExp("printer-state=([^\\s]*)");
+        QRegExp stateReasonsRe = QRegExp("printer-state-reasons=([^\\s]*)");
+        QString state;
+        QString stateReasons;
+        if (stateRe.indexIn(options) != -1)
+            state = stateRe.cap(1);
+        if (stateReasonsRe.indexIn(options) != -1)
+            stateReasons = stateReasonsRe.cap(1);
+        if (stateReasons.toLower() == QLatin1String("none"))
+            stateReasons = QString();
+        if (state == QLatin1String("5") || (state == QLatin1String("3") && !stateReasons.isEmpty())) {
+            qCWarning(proofUtilsLprPrinterInfoLog) << "lpoptions for" << printerHost << printerName
+                                                   << "returned bad state of printer" << state << stateReasons;
+            return WithFailure(QStringLiteral("Printing aborted.\nCheck %1@%2 printer.\nProbably it is offline or "
+                                              "is in wrong state.\n%3: %4")
+                                   .arg(printerName.isEmpty() ? QStringLiteral("default") : printerName,
+                                        printerHost.isEmpty() ? QStringLiteral("localhost") : printerHost, state,
+                                        stateReasons),
+                               UTILS_MODULE_CODE, UtilsErrorCode::PrinterOffline);
         }
         return true;
     });
 }
+
+LprPrinterBackend::StatusSourceSettings LprPrinterBackend::currentStatusSource() const
+{
+    QMutexLocker locker(&statusSourceMutex);
+    return statusSource;
+}
+
+Future<bool> LprPrinterBackend::checkIppStatus(const QSharedPointer<Proof::NetworkServices::IppApi> &ippApi) const
+{
+    using Proof::NetworkServices::IppPrinterStatus;
+    auto self = sharedFromThis();
+    Future<IppPrinterStatus> fetched = ippApi->fetchPrinterStatus(printerName);
+    Future<bool> status = fetched.map([self, this, ippApi](const IppPrinterStatus &status) -> bool {
+        qCDebug(proofUtilsLprPrinterDataLog) << "IPP status for" << printerHost << printerName << ":"
+                                             << static_cast<int>(status.state) << status.stateReasons
+                                             << "queued jobs:" << status.queuedJobCount;
+        if (status.isReady())
+            return true;
+        qCWarning(proofUtilsLprPrinterInfoLog) << "IPP for" << printerHost << printerName
+                                               << "returned bad state of printer" << static_cast<int>(status.state)
+                                               << status.stateReasons;
+        return WithFailure(QStringLiteral("Printing aborted.\nCheck %1@%2 printer.\nProbably it is offline or "
+                                          "is in wrong state.\n%3")
+                               .arg(printerName, printerHost.isEmpty() ? QStringLiteral("localhost") : printerHost,
+                                    status.reason()),
+                           UTILS_MODULE_CODE, UtilsErrorCode::PrinterOffline);
+    });
+    if (strictPrinterCheck)
+        return status;
+    return status.recoverWith([self, this](const Failure &failure) -> Future<bool> {
+        if (failure.moduleCode == UTILS_MODULE_CODE)
+            return Future<bool>::failed(failure);
+        qCWarning(proofUtilsLprPrinterInfoLog)
+            << "IPP status for" << printerHost << printerName << "can't be fetched:" << failure.message;
+        return futures::successful(true);
+    });
+}
+
+Future<bool> LprPrinterBackend::checkSnmpStatus(int snmpPort, const QByteArray &snmpCommunity) const
+{
+    auto self = sharedFromThis();
+    QString host = printerHost.isEmpty() ? QStringLiteral("127.0.0.1") : printerHost;
+    Future<SnmpPrinterStatus> fetched = SnmpStatusPoller::instance()->fetchStatus(host, snmpPort, snmpCommunity);
+    Future<bool> status = fetched.map([self, this, host](const SnmpPrinterStatus &status) -> bool {
+        qCDebug(proofUtilsLprPrinterDataLog) << "SNMP status for" << host << printerName << ":"
+                                             << static_cast<int>(status.deviceStatus)
+                                             << static_cast<int>(status.printerStatus) << status.errors();
+        if (status.isReady())
+            return true;
+        qCWarning(proofUtilsLprPrinterInfoLog) << "SNMP for" << host << printerName << "returned bad state of printer"
+                                               << status.reason();
+        return WithFailure(QStringLiteral("Printing aborted.\nCheck %1@%2 printer.\nProbably it is offline or "
+                                          "is in wrong state.\n%3")
+                               .arg(printerName.isEmpty() ? QStringLiteral("default") : printerName, host,
+                                    status.reason()),
+                           UTILS_MODULE_CODE, UtilsErrorCode::PrinterOffline);
+    });
+    if (strictPrinterCheck)
+        return status;
+    return status.recoverWith([self, this, host](const Failure &failure) -> Future<bool> {
+        if (failure.errorCode == UtilsErrorCode::PrinterOffline)
+            return Future<bool>::failed(failure);
+        qCWarning(proofUtilsLprPrinterInfoLog)
+            << "SNMP status for" << host << printerName << "can't be fetched:" << failure.message;
+        return futures::successful(true);
+    });
+}
+
+Future<QString> LprPrinterBackend::checkJobOutcome(const QString &jobId) const
+{
+    using Proof::NetworkServices::IppJobStatus;
+    // Spooler queue doesn't show how job left it, only IPP can tell printed job from canceled one
+    bool isNumber = false;
+    int ippJobId = jobId.toInt(&isNumber);
+    auto ippApi = currentStatusSource().ippApi;
+    if (!ippApi || !isNumber)
+        return Future<QString>::successful(jobId);
+    auto self = sharedFromThis();
+    Future<IppJobStatus> fetched = ippApi->fetchJobStatus(printerName, ippJobId);
+    Future<QString> outcome = fetched.map([self, this, ippApi, jobId](const IppJobStatus &status) -> QString {
+        if (status.state == IppJobStatus::State::Canceled) {
+            return WithFailure(QStringLiteral("Printing aborted.\nJob %1 was canceled.").arg(jobId), UTILS_MODULE_CODE,
+                               UtilsErrorCode::PrintJobCanceled);
+        }
+        if (status.state == IppJobStatus::State::Aborted) {
+            qCWarning(proofUtilsLprPrinterInfoLog) << "Print job" << jobId << "at" << printerHost << printerName
+                                                   << "was aborted" << status.stateReasons;
+            return WithFailure(QStringLiteral("Printing aborted.\nJob %1 was aborted by spooler.\n%2")
+                                   .arg(jobId, status.stateReasons.join(QStringLiteral(", "))),
+                               UTILS_MODULE_CODE, UtilsErrorCode::PrintJobAborted);
+        }
+        return jobId;
+    });
+    if (strictPrinterCheck)
+        return outcome;
+    return outcome.recoverWith([self, this, jobId](const Failure &failure) -> Future<QString> {
+        if (failure.moduleCode == UTILS_MODULE_CODE)
+            return Future<QString>::failed(failure);
+        qCWarning(proofUtilsLprPrinterInfoLog) << "IPP status of job" << jobId << "at" << printerHost << printerName
+                                               << "can't be fetched:" << failure.message;
+        return Future<QString>::successful(jobId);
+    });
+}
+
+Future<bool> LprPrinterBackend::writeToCapture(const QByteArray &data) const
+{
+    if (!capture->write(data)) {
+        return Future<bool>::failed(Failure(QStringLiteral("Printing aborted.\nCan't write to print capture."),
+                                            UTILS_MODULE_CODE, UtilsErrorCode::PrintCaptureError));
+    }
+    return futures::successful(true);
+}
+
+QStringList LprPrinterBackend::lprArguments() const
+{
+    QStringList args;
+    if (!printerHost.isEmpty()) {
+#ifdef Q_OS_WIN
+        args << "-S" << printerHost;
+#else
+        args << QStringLiteral("-H") << printerHost;
+#endif
+    }
+    if (!printerName.isEmpty())
+        args << QStringLiteral("-P") << printerName;
+    return args;
+}
+
+QStringList LprPrinterBackend::lpArguments() const
+{
+    QStringList args;
+    if (!printerHost.isEmpty())
+        args << QStringLiteral("-h") << printerHost;
+    if (!printerName.isEmpty())
+        args << QStringLiteral("-d") << printerName;
+    return args;
+}
+
+QString LprPrinterBackend::lpqProgram() const
+{
+#ifdef Q_OS_WIN
+    return system32Path() + "\\lpq.exe";
+#else
+    return QStringLiteral("lpq");
+#endif
+}
+
+QStringList LprPrinterBackend::lpqArguments() const
+{
+    QStringList args;
+    if (!printerHost.isEmpty()) {
+#ifdef Q_OS_WIN
+        args << "-S" << printerHost;
+#else
+        args << QStringLiteral("-h") << printerHost;
+#endif
+    }
+    if (!printerName.isEmpty())
+        args << QStringLiteral("-P") << printerName;
+    return args;
+}
+
+Future<bool> LprPrinterBackend::runLpr(const QString &program, const QStringList &args, const QByteArray &input,
+                                      const Future<bool> &canceled) const
+{
+    return runLprCommand(program, args, input, canceled).map([](const LprCommandResult &) { return true; });
+}
+
+Future<LprCommandResult> LprPrinterBackend::runLprCommand(const QString &program, const QStringList &args,
+                                                          const QByteArray &input, const Future<bool> &canceled) const
+{
+    qCDebug(proofUtilsLprPrinterDataLog) << "Lpr started as" << program << args;
+    Future<LprCommandResult> command = LprCommandRunner::instance()->run(program, args, input, canceled);
+    return command.map([](const LprCommandResult &result) -> LprCommandResult {
+        if (result.aborted) {
+            qCDebug(proofUtilsLprPrinterInfoLog) << "lpr aborted, print job was canceled";
+            return WithFailure(QStringLiteral("Printing aborted.\nJob was canceled."), UTILS_MODULE_CODE,
+                               UtilsErrorCode::PrintJobCanceled);
+        }
+        if (!result.isStarted()) {
+            qCWarning(proofUtilsLprPrinterInfoLog) << "lpr can't be started";
+            return WithFailure(QStringLiteral("Printing aborted.\nCan't start lpr."), UTILS_MODULE_CODE,
+                               UtilsErrorCode::LprCannotBeStarted);
+        }
+        if (!result.isSucceeded()) {
+            qCWarning(proofUtilsLprPrinterInfoLog)
+                << "lpr finished with non-zero code, probably nothing was printed" << result.exitCode << result.error
+                << QByteArray(result.standardError).replace("\n", " ")
+                << QByteArray(result.standardOutput).replace("\n", " ");
+            return WithFailure(QStringLiteral("Printing probably not finished.\nProcess exited with code %1.")
+                                   .arg(result.exitCode),
+                               UTILS_MODULE_CODE, UtilsErrorCode::LprProcessNonZeroExitCode);
+        }
+        return result;
+    });
+}
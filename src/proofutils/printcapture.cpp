@@ -0,0 +1,226 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include "proofutils/printcapture.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QQueue>
+
+namespace Proof {
+class PrintCapturePrivate
+{
+    Q_DECLARE_PUBLIC(PrintCapture)
+
+    bool open();
+    bool writeToFile(const QString &fileName, const QByteArray &data, QIODevice::OpenMode openMode);
+
+    PrintCapture *q_ptr = nullptr;
+    PrintCapture::Mode mode = PrintCapture::Mode::Discard;
+    QString path;
+    int ringSize = 1024;
+
+    mutable QMutex mutex;
+    QElapsedTimer clock;
+    QQueue<PrintCapture::Record> records;
+    quint64 jobsCount = 0;
+    qint64 bytesCount = 0;
+    qint64 firstSubmitNsecs = -1;
+    qint64 lastSubmitNsecs = -1;
+};
+} // namespace Proof
+
+using namespace Proof;
+
+PrintCapture::PrintCapture(Mode mode, const QString &path, int ringSize) : d_ptr(new PrintCapturePrivate)
+{
+    Q_D(PrintCapture);
+    d->q_ptr = this;
+    d->mode = mode;
+    d->path = path;
+    d->ringSize = qMax(1, ringSize);
+    d->clock.start();
+}
+
+PrintCapture::~PrintCapture()
+{}
+
+QSharedPointer<PrintCapture> PrintCapture::create(Mode mode, const QString &path, int ringSize)
+{
+    if (mode == Mode::None)
+        return QSharedPointer<PrintCapture>();
+    QSharedPointer<PrintCapture> capture(new PrintCapture(mode, path, ringSize));
+    if (!capture->d_func()->open())
+        return QSharedPointer<PrintCapture>();
+    return capture;
+}
+
+PrintCapture::Mode PrintCapture::modeFromString(const QString &mode)
+{
+    static const QHash<QString, Mode> modes = {{QStringLiteral("file"), Mode::File},
+                                               {QStringLiteral("directory"), Mode::Directory},
+                                               {QStringLiteral("memory"), Mode::Memory},
+                                               {QStringLiteral("discard"), Mode::Discard}};
+    return modes.value(mode.trimmed().toLower(), Mode::None);
+}
+
+PrintCapture::Mode PrintCapture::mode() const
+{
+    Q_D_CONST(PrintCapture);
+    return d->mode;
+}
+
+QString PrintCapture::path() const
+{
+    Q_D_CONST(PrintCapture);
+    return d->path;
+}
+
+int PrintCapture::ringSize() const
+{
+    Q_D_CONST(PrintCapture);
+    return d->ringSize;
+}
+
+bool PrintCapture::write(const QByteArray &data)
+{
+    Q_D(PrintCapture);
+    QMutexLocker locker(&d->mutex);
+    Record record;
+    record.sequence = ++d->jobsCount;
+    record.size = data.size();
+
+    bool result = true;
+    switch (d->mode) {
+    case Mode::File:
+        result = d->writeToFile(d->path, data, QIODevice::Append);
+        break;
+    case Mode::Directory:
+        result = d->writeToFile(QStringLiteral("%1/%2.prn").arg(d->path).arg(record.sequence, 10, 10, QLatin1Char('0')),
+                                data, QIODevice::Truncate);
+        break;
+    case Mode::Memory:
+        record.data = data;
+        break;
+    default:
+        break;
+    }
+
+    record.submittedAtNsecs = d->clock.nsecsElapsed();
+    if (d->firstSubmitNsecs < 0)
+        d->firstSubmitNsecs = record.submittedAtNsecs;
+    d->lastSubmitNsecs = record.submittedAtNsecs;
+    d->bytesCount += record.size;
+    d->records.enqueue(record);
+    while (d->records.count() > d->ringSize)
+        d->records.dequeue();
+    return result;
+}
+
+QVector<PrintCapture::Record> PrintCapture::records() const
+{
+    Q_D_CONST(PrintCapture);
+    QMutexLocker locker(&d->mutex);
+    return d->records.toVector();
+}
+
+quint64 PrintCapture::jobsCount() const
+{
+    Q_D_CONST(PrintCapture);
+    QMutexLocker locker(&d->mutex);
+    return d->jobsCount;
+}
+
+qint64 PrintCapture::bytesCount() const
+{
+    Q_D_CONST(PrintCapture);
+    QMutexLocker locker(&d->mutex);
+    return d->bytesCount;
+}
+
+double PrintCapture::jobsPerSecond() const
+{
+    Q_D_CONST(PrintCapture);
+    QMutexLocker locker(&d->mutex);
+    qint64 duration = d->lastSubmitNsecs - d->firstSubmitNsecs;
+    if (d->jobsCount < 2 || duration <= 0)
+        return 0.0;
+    return (d->jobsCount - 1) * 1e9 / duration;
+}
+
+double PrintCapture::bytesPerSecond() const
+{
+    Q_D_CONST(PrintCapture);
+    QMutexLocker locker(&d->mutex);
+    qint64 duration = d->lastSubmitNsecs - d->firstSubmitNsecs;
+    if (d->jobsCount < 2 || duration <= 0)
+        return 0.0;
+    return d->bytesCount * 1e9 / duration;
+}
+
+void PrintCapture::reset()
+{
+    Q_D(PrintCapture);
+    QMutexLocker locker(&d->mutex);
+    d->records.clear();
+    d->jobsCount = 0;
+    d->bytesCount = 0;
+    d->firstSubmitNsecs = -1;
+    d->lastSubmitNsecs = -1;
+}
+
+bool PrintCapturePrivate::open()
+{
+    switch (mode) {
+    case PrintCapture::Mode::File: {
+        QFile file(path);
+        if (path.isEmpty() || !file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qCWarning(proofUtilsLprPrinterInfoLog) << "Print capture file" << path << "can't be opened";
+            return false;
+        }
+        return true;
+    }
+    case PrintCapture::Mode::Directory:
+        if (path.isEmpty() || !QDir().mkpath(path)) {
+            qCWarning(proofUtilsLprPrinterInfoLog) << "Print capture directory" << path << "can't be created";
+            return false;
+        }
+        return true;
+    default:
+        return true;
+    }
+}
+
+bool PrintCapturePrivate::writeToFile(const QString &fileName, const QByteArray &data, QIODevice::OpenMode openMode)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | openMode) || file.write(data) != data.size()) {
+        qCWarning(proofUtilsLprPrinterInfoLog) << "Print capture can't write to" << fileName;
+        return false;
+    }
+    return true;
+}
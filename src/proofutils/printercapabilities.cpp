@@ -0,0 +1,126 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include "proofutils/printercapabilities.h"
+
+#include "proofnetwork/lprprinter/ippapi.h"
+
+#include <QHash>
+#include <QMutex>
+
+#include <algorithm>
+
+namespace {
+// EPL models that render QR codes with b command
+const QStringList NATIVE_QR_MODELS = {QStringLiteral("GC420"), QStringLiteral("GK420"), QStringLiteral("GK888"),
+                                      QStringLiteral("GX420"), QStringLiteral("GX430"), QStringLiteral("ZD220"),
+                                      QStringLiteral("ZD230"), QStringLiteral("ZD410"), QStringLiteral("ZD420"),
+                                      QStringLiteral("ZD500"), QStringLiteral("ZD620")};
+
+struct ProbeCache
+{
+    QMutex mutex;
+    QHash<QString, Future<Proof::PrinterCapabilities>> probes;
+};
+
+QString cacheKey(const QString &printerHost, const QString &printerName)
+{
+    return QStringLiteral("%1/%2").arg(printerHost, printerName);
+}
+} // namespace
+
+Q_GLOBAL_STATIC(ProbeCache, probeCache)
+
+using namespace Proof;
+
+PrinterCapabilities PrinterCapabilities::fromIpp(const NetworkServices::IppPrinterCapabilities &ippCapabilities)
+{
+    PrinterCapabilities result;
+    result.makeAndModel = ippCapabilities.makeAndModel;
+    result.dpi = ippCapabilities.resolution;
+    if (result.dpi) {
+        result.printWidth = ippCapabilities.mediaWidth * result.dpi / 2540;
+        result.labelLength = ippCapabilities.mediaLength * result.dpi / 2540;
+    }
+    result.documentFormats = ippCapabilities.documentFormats;
+    result.rawSupported = result.documentFormats.contains(QStringLiteral("application/vnd.cups-raw"))
+                          || result.documentFormats.contains(QStringLiteral("application/octet-stream"));
+    result.nativeQrCode = std::any_of(NATIVE_QR_MODELS.cbegin(), NATIVE_QR_MODELS.cend(),
+                                      [&result](const QString &model) {
+                                          return result.makeAndModel.contains(model, Qt::CaseInsensitive);
+                                      });
+    return result;
+}
+
+EplLabelProfile PrinterCapabilities::labelProfile() const
+{
+    EplLabelProfile profile;
+    int defaultDpi = profile.dpi;
+    if (dpi)
+        profile.dpi = dpi < 300 ? 203 : 300;
+    profile.width = printWidth ? printWidth : profile.width * profile.dpi / defaultDpi;
+    profile.height = labelLength ? labelLength : profile.height * profile.dpi / defaultDpi;
+    profile.gapLength = profile.gapLength * profile.dpi / defaultDpi;
+    profile.nativeQrCode = nativeQrCode;
+    return profile;
+}
+
+Future<PrinterCapabilities> PrinterCapabilityProbe::probe(const QString &printerHost, const QString &printerName,
+                                                          int ippPort)
+{
+    QString key = cacheKey(printerHost, printerName);
+    QMutexLocker locker(&probeCache->mutex);
+    auto cached = probeCache->probes.constFind(key);
+    if (cached != probeCache->probes.cend() && !cached->isFailed())
+        return *cached;
+
+    auto restClient = Proof::RestClientSP::create();
+    restClient->setAuthType(Proof::RestAuthType::NoAuth);
+    restClient->setScheme(QStringLiteral("http"));
+    restClient->setHost(printerHost.isEmpty() ? QStringLiteral("127.0.0.1") : printerHost);
+    restClient->setPort(ippPort);
+    QSharedPointer<NetworkServices::IppApi> ippApi(new NetworkServices::IppApi(restClient), &QObject::deleteLater);
+    Future<PrinterCapabilities> result =
+        ippApi->fetchPrinterCapabilities(printerName)
+            .map([ippApi](const NetworkServices::IppPrinterCapabilities &ippCapabilities) {
+                PrinterCapabilities capabilities = PrinterCapabilities::fromIpp(ippCapabilities);
+                qCDebug(proofUtilsLprPrinterInfoLog)
+                    << "Printer" << capabilities.makeAndModel << "dpi:" << capabilities.dpi
+                    << "label:" << capabilities.printWidth << "x" << capabilities.labelLength
+                    << "native QR:" << capabilities.nativeQrCode;
+                return capabilities;
+            })
+            .onFailure([printerHost, printerName](const Failure &failure) {
+                qCWarning(proofUtilsLprPrinterInfoLog)
+                    << "Capabilities of" << printerHost << printerName << "can't be probed:" << failure.message;
+            });
+    probeCache->probes[key] = result;
+    return result;
+}
+
+void PrinterCapabilityProbe::invalidate(const QString &printerHost, const QString &printerName)
+{
+    QMutexLocker locker(&probeCache->mutex);
+    probeCache->probes.remove(cacheKey(printerHost, printerName));
+}
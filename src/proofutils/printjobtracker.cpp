@@ -0,0 +1,249 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include "proofutils/printjobtracker_p.h"
+
+#include "proofutils/lprcommandrunner_p.h"
+
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QRegExp>
+#include <QRegularExpression>
+#include <QVector>
+#include <QWeakPointer>
+
+static constexpr int MAX_FAILED_POLLS = 5;
+
+using namespace Proof;
+
+namespace {
+struct TrackersRegistry
+{
+    QMutex mutex;
+    QHash<QString, QWeakPointer<PrintJobTracker>> trackers;
+};
+
+bool isNumber(const QString &token)
+{
+    bool ok = false;
+    token.toULongLong(&ok);
+    return ok;
+}
+} // namespace
+
+Q_GLOBAL_STATIC(TrackersRegistry, trackersRegistry)
+
+PrintJobTracker::PrintJobTracker(const QString &key) : m_key(key)
+{}
+
+PrintJobTracker::~PrintJobTracker()
+{
+    auto registry = trackersRegistry();
+    if (!registry)
+        return;
+    QMutexLocker locker(&registry->mutex);
+    auto it = registry->trackers.find(m_key);
+    if (it != registry->trackers.end() && it.value().isNull())
+        registry->trackers.erase(it);
+}
+
+QSharedPointer<PrintJobTracker> PrintJobTracker::forPrinter(const QString &printerHost, const QString &printerName)
+{
+    QString key = QStringLiteral("%1@%2").arg(printerName.trimmed().toLower(), printerHost.trimmed().toLower());
+    auto registry = trackersRegistry();
+    QMutexLocker locker(&registry->mutex);
+    QSharedPointer<PrintJobTracker> tracker = registry->trackers.value(key).toStrongRef();
+    if (!tracker) {
+        tracker = QSharedPointer<PrintJobTracker>(new PrintJobTracker(key));
+        registry->trackers[key] = tracker;
+    }
+    return tracker;
+}
+
+QString PrintJobTracker::uniqueJobTitle()
+{
+    static QAtomicInt counter;
+    // lpq truncates long titles, so title is kept short
+    return QStringLiteral("proof-%1-%2").arg(QCoreApplication::applicationPid()).arg(counter.fetchAndAddRelaxed(1) + 1);
+}
+
+QHash<QString, QString> PrintJobTracker::parseQueue(const QString &queueInfo, const QStringList &titles)
+{
+    QHash<QString, QString> result;
+    const auto lines = queueInfo.split(QLatin1Char('\n'), QString::SkipEmptyParts);
+    for (const auto &line : lines) {
+        const QStringList tokens = line.split(QRegExp(QStringLiteral("\\s+")), QString::SkipEmptyParts);
+        for (const auto &title : titles) {
+            int titleIndex = tokens.indexOf(title);
+            if (titleIndex < 0)
+                continue;
+            QString jobId;
+            // CUPS lpq: Rank Owner Job File(s) Total Size; Windows lpq has job id after its name
+            if (titleIndex >= 3 && isNumber(tokens[2])) {
+                jobId = tokens[2];
+            } else {
+                for (int i = titleIndex + 1; i < tokens.count() && jobId.isEmpty(); ++i) {
+                    if (isNumber(tokens[i]))
+                        jobId = tokens[i];
+                }
+            }
+            result[title] = jobId;
+        }
+    }
+    return result;
+}
+
+QString PrintJobTracker::parseRequestId(const QString &submissionOutput)
+{
+    static const QRegularExpression requestIdRegExp(QStringLiteral("request id is \\S*-(\\d+)"));
+    QRegularExpressionMatch match = requestIdRegExp.match(submissionOutput);
+    return match.hasMatch() ? match.captured(1) : QString();
+}
+
+QString PrintJobTracker::key() const
+{
+    return m_key;
+}
+
+void PrintJobTracker::setQueueCommand(const QString &program, const QStringList &arguments)
+{
+    QMutexLocker locker(&m_mutex);
+    m_program = program;
+    m_arguments = arguments;
+}
+
+int PrintJobTracker::pollInterval() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_pollInterval;
+}
+
+void PrintJobTracker::setPollInterval(int msecs)
+{
+    QMutexLocker locker(&m_mutex);
+    m_pollInterval = qMax(10, msecs);
+}
+
+int PrintJobTracker::trackedCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_jobs.count();
+}
+
+Future<QString> PrintJobTracker::track(const QString &jobTitle, const QString &jobId)
+{
+    Promise<QString> promise;
+    bool startPolling = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_program.isEmpty()) {
+            return Future<QString>::failed(Failure(QStringLiteral("Print queue of %1 can't be tracked").arg(m_key),
+                                                   UTILS_MODULE_CODE, UtilsErrorCode::PrinterInfoCannotBeQueried));
+        }
+        m_jobs[jobTitle] = TrackedJob{promise, jobId};
+        startPolling = !m_polling;
+        m_polling = true;
+    }
+    qCDebug(proofUtilsLprPrinterDataLog) << "Tracking print job" << jobTitle << "with id" << jobId << "at" << m_key;
+    if (startPolling)
+        schedulePoll();
+    return promise.future();
+}
+
+void PrintJobTracker::schedulePoll()
+{
+    auto self = sharedFromThis();
+    LprCommandRunner::instance()->runLater(pollInterval(), [self] { self->poll(); });
+}
+
+void PrintJobTracker::poll()
+{
+    QString program;
+    QStringList arguments;
+    {
+        QMutexLocker locker(&m_mutex);
+        program = m_program;
+        arguments = m_arguments;
+    }
+    auto self = sharedFromThis();
+    LprCommandRunner::instance()->run(program, arguments).onSuccess([self](const LprCommandResult &result) {
+        QString queueInfo = QString::fromLocal8Bit(result.standardOutput);
+        self->pollFinished(result.isSucceeded() && !queueInfo.trimmed().isEmpty(), queueInfo);
+    });
+}
+
+void PrintJobTracker::pollFinished(bool succeeded, const QString &queueInfo)
+{
+    QVector<TrackedJob> printed;
+    QVector<TrackedJob> lost;
+    QVector<TrackedJob> failed;
+    bool pollAgain = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!succeeded) {
+            qCWarning(proofUtilsLprPrinterInfoLog) << "Print queue of" << m_key << "can't be polled";
+            if (++m_failedPolls >= MAX_FAILED_POLLS) {
+                failed = m_jobs.values().toVector();
+                m_jobs.clear();
+            }
+        } else {
+            m_failedPolls = 0;
+            QHash<QString, QString> queued = parseQueue(queueInfo, m_jobs.keys());
+            for (auto it = m_jobs.begin(); it != m_jobs.end();) {
+                if (queued.contains(it.key())) {
+                    if (!queued[it.key()].isEmpty())
+                        it->jobId = queued[it.key()];
+                    ++it;
+                } else if (it->jobId.isEmpty()) {
+                    qCWarning(proofUtilsLprPrinterInfoLog)
+                        << "Print job" << it.key() << "left queue of" << m_key << "before its id was known";
+                    lost << it.value();
+                    it = m_jobs.erase(it);
+                } else {
+                    qCDebug(proofUtilsLprPrinterDataLog)
+                        << "Print job" << it.key() << "with id" << it->jobId << "left queue of" << m_key;
+                    printed << it.value();
+                    it = m_jobs.erase(it);
+                }
+            }
+        }
+        m_polling = !m_jobs.isEmpty();
+        pollAgain = m_polling;
+        if (!m_polling)
+            m_failedPolls = 0;
+    }
+
+    for (const auto &job : qAsConst(printed))
+        job.promise.success(job.jobId);
+    for (const auto &job : qAsConst(lost)) {
+        job.promise.failure(Failure(QStringLiteral("Print job left queue of %1 before it was recognized").arg(m_key),
+                                    UTILS_MODULE_CODE, UtilsErrorCode::PrintJobStateUnknown));
+    }
+    for (const auto &job : qAsConst(failed)) {
+        job.promise.failure(Failure(QStringLiteral("Print queue of %1 can't be queried").arg(m_key), UTILS_MODULE_CODE,
+                                    UtilsErrorCode::PrinterInfoCannotBeQueried));
+    }
+    if (pollAgain)
+        schedulePoll();
+}
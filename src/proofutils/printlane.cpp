@@ -0,0 +1,423 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include "proofutils/printlane_p.h"
+
+#include <QHash>
+#include <QWeakPointer>
+
+using namespace Proof;
+
+namespace {
+struct LanesRegistry
+{
+    QMutex mutex;
+    QHash<QString, QWeakPointer<PrintLane>> lanes;
+};
+} // namespace
+
+Q_GLOBAL_STATIC(LanesRegistry, lanesRegistry)
+
+PrintLane::PrintLane(const QString &key) : m_key(key)
+{
+    m_clock.start();
+}
+
+PrintLane::~PrintLane()
+{
+    auto registry = lanesRegistry();
+    if (!registry)
+        return;
+    QMutexLocker locker(&registry->mutex);
+    auto it = registry->lanes.find(m_key);
+    if (it != registry->lanes.end() && it.value().isNull())
+        registry->lanes.erase(it);
+}
+
+QSharedPointer<PrintLane> PrintLane::forPrinter(const QString &printerHost, const QString &printerName)
+{
+    QString key = QStringLiteral("%1@%2").arg(printerName.trimmed().toLower(), printerHost.trimmed().toLower());
+    auto registry = lanesRegistry();
+    QMutexLocker locker(&registry->mutex);
+    QSharedPointer<PrintLane> lane = registry->lanes.value(key).toStrongRef();
+    if (!lane) {
+        lane = QSharedPointer<PrintLane>(new PrintLane(key));
+        registry->lanes[key] = lane;
+    }
+    return lane;
+}
+
+QString PrintLane::key() const
+{
+    return m_key;
+}
+
+int PrintLane::capacity() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_capacity;
+}
+
+void PrintLane::setCapacity(int capacity)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_capacity == qMax(1, capacity))
+            return;
+        m_capacity = qMax(1, capacity);
+    }
+    qCDebug(proofUtilsLprPrinterDataLog) << "Print lane" << m_key << "capacity set to" << qMax(1, capacity);
+    pump();
+}
+
+int PrintLane::agingInterval() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_agingInterval;
+}
+
+void PrintLane::setAgingInterval(int msecs)
+{
+    QMutexLocker locker(&m_mutex);
+    m_agingInterval = qMax(0, msecs);
+}
+
+int PrintLane::maxJobs() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxJobs;
+}
+
+void PrintLane::setMaxJobs(int jobs)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_maxJobs = qMax(0, jobs);
+        admitBlocked();
+    }
+    notifyObservers();
+    pump();
+}
+
+qint64 PrintLane::maxBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxBytes;
+}
+
+void PrintLane::setMaxBytes(qint64 bytes)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_maxBytes = qMax(qint64(0), bytes);
+        admitBlocked();
+    }
+    notifyObservers();
+    pump();
+}
+
+PrintQueueOverflowPolicy PrintLane::overflowPolicy() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_overflowPolicy;
+}
+
+void PrintLane::setOverflowPolicy(PrintQueueOverflowPolicy policy)
+{
+    QMutexLocker locker(&m_mutex);
+    m_overflowPolicy = policy;
+}
+
+int PrintLane::queuedCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    int result = 0;
+    for (const auto &queue : m_queues)
+        result += queue.count();
+    return result;
+}
+
+int PrintLane::queuedCount(PrintPriority priority) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_queues[static_cast<size_t>(priority)].count();
+}
+
+int PrintLane::runningCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_running;
+}
+
+int PrintLane::blockedCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_blocked.count();
+}
+
+qint64 PrintLane::bytesCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_bytes;
+}
+
+int PrintLane::availableJobs() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxJobs > 0 ? qMax(0, m_maxJobs - m_jobs) : -1;
+}
+
+qint64 PrintLane::availableBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxBytes > 0 ? qMax(qint64(0), m_maxBytes - m_bytes) : -1;
+}
+
+bool PrintLane::canAdmit(qint64 bytes) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_blocked.isEmpty() && fits(bytes);
+}
+
+int PrintLane::addObserver(const Observer &observer)
+{
+    QMutexLocker locker(&m_observersMutex);
+    m_observers[++m_lastObserverId] = observer;
+    return m_lastObserverId;
+}
+
+void PrintLane::removeObserver(int id)
+{
+    QMutexLocker locker(&m_observersMutex);
+    m_observers.remove(id);
+}
+
+CancelableFuture<bool> PrintLane::enqueue(const Job &job, PrintPriority priority, qint64 bytes)
+{
+    return enqueue([job](const Future<bool> &) { return job(); }, priority, bytes);
+}
+
+CancelableFuture<bool> PrintLane::enqueue(const CancelableJob &job, PrintPriority priority, qint64 bytes)
+{
+    Promise<bool> promise;
+    QueuedJob queued{job, promise, m_clock.elapsed(), qMax(qint64(0), bytes)};
+    QVector<QueuedJob> droppedJobs;
+    {
+        QMutexLocker locker(&m_mutex);
+        queued.order = ++m_lastOrder;
+        bool hasRoom = m_blocked.isEmpty() && fits(queued.bytes);
+        if (!hasRoom && m_overflowPolicy == PrintQueueOverflowPolicy::DropOldest) {
+            bool dropped = true;
+            while (dropped && !fits(queued.bytes))
+                dropped = dropOldest(droppedJobs);
+            hasRoom = fits(queued.bytes);
+        }
+
+        if (hasRoom) {
+            admit(queued, priority);
+        } else if (m_overflowPolicy == PrintQueueOverflowPolicy::Block) {
+            m_blocked.enqueue(qMakePair(queued, priority));
+            qCDebug(proofUtilsLprPrinterDataLog) << "Print lane" << m_key << "is full, job is blocked, jobs:" << m_jobs
+                                                 << "bytes:" << m_bytes << "blocked:" << m_blocked.count();
+        } else {
+            qCWarning(proofUtilsLprPrinterInfoLog) << "Print lane" << m_key << "is full, job rejected, jobs:" << m_jobs
+                                                   << "bytes:" << m_bytes;
+            promise.failure(Failure(QStringLiteral("Printing aborted.\nPrint queue is full."), UTILS_MODULE_CODE,
+                                    UtilsErrorCode::PrintQueueFull));
+            return CancelableFuture<bool>(promise);
+        }
+    }
+
+    for (const auto &droppedJob : qAsConst(droppedJobs)) {
+        droppedJob.promise.failure(Failure(QStringLiteral("Printing aborted.\nJob was dropped from full print queue."),
+                                           UTILS_MODULE_CODE, UtilsErrorCode::PrintJobDropped));
+    }
+    auto self = sharedFromThis();
+    quint64 order = queued.order;
+    promise.future().onFailure([self, order](const Failure &) { self->dropCanceled(order); });
+    notifyObservers();
+    pump();
+    return CancelableFuture<bool>(promise);
+}
+
+bool PrintLane::fits(qint64 bytes) const
+{
+    if (m_maxJobs > 0 && m_jobs >= m_maxJobs)
+        return false;
+    // Job that is bigger than the limit itself is still accepted into empty lane
+    return m_maxBytes <= 0 || !m_jobs || m_bytes + bytes <= m_maxBytes;
+}
+
+void PrintLane::admit(const QueuedJob &job, PrintPriority priority)
+{
+    auto &queue = m_queues[static_cast<size_t>(priority)];
+    queue.enqueue(job);
+    ++m_jobs;
+    m_bytes += job.bytes;
+    qCDebug(proofUtilsLprPrinterDataLog) << "Print lane" << m_key << "job queued with priority"
+                                         << static_cast<int>(priority) << "running:" << m_running
+                                         << "queued in class:" << queue.count() << "capacity:" << m_capacity;
+}
+
+void PrintLane::admitBlocked()
+{
+    while (!m_blocked.isEmpty() && fits(m_blocked.head().first.bytes)) {
+        auto blocked = m_blocked.dequeue();
+        admit(blocked.first, blocked.second);
+    }
+}
+
+bool PrintLane::dropOldest(QVector<QueuedJob> &dropped)
+{
+    int oldest = -1;
+    for (int i = 0; i < static_cast<int>(m_queues.size()); ++i) {
+        const auto &queue = m_queues[static_cast<size_t>(i)];
+        if (!queue.isEmpty()
+            && (oldest < 0 || queue.head().order < m_queues[static_cast<size_t>(oldest)].head().order)) {
+            oldest = i;
+        }
+    }
+    if (oldest < 0)
+        return false;
+    QueuedJob job = m_queues[static_cast<size_t>(oldest)].dequeue();
+    --m_jobs;
+    m_bytes -= job.bytes;
+    dropped << job;
+    qCWarning(proofUtilsLprPrinterInfoLog) << "Print lane" << m_key << "is full, oldest job dropped";
+    return true;
+}
+
+int PrintLane::nextQueueIndex() const
+{
+    int result = -1;
+    qint64 bestRank = 0;
+    qint64 now = m_clock.elapsed();
+    for (int i = 0; i < static_cast<int>(m_queues.size()); ++i) {
+        const auto &queue = m_queues[static_cast<size_t>(i)];
+        if (queue.isEmpty())
+            continue;
+        const auto &head = queue.head();
+        qint64 rank = i - (m_agingInterval > 0 ? (now - head.enqueuedAt) / m_agingInterval : 0);
+        if (result < 0 || rank < bestRank
+            || (rank == bestRank && head.order < m_queues[static_cast<size_t>(result)].head().order)) {
+            result = i;
+            bestRank = rank;
+        }
+    }
+    return result;
+}
+
+void PrintLane::dropCanceled(quint64 order)
+{
+    bool found = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (auto &queue : m_queues) {
+            for (auto it = queue.begin(); it != queue.end(); ++it) {
+                if (it->order != order)
+                    continue;
+                --m_jobs;
+                m_bytes -= it->bytes;
+                queue.erase(it);
+                found = true;
+                break;
+            }
+        }
+        for (auto it = m_blocked.begin(); !found && it != m_blocked.end(); ++it) {
+            if (it->first.order != order)
+                continue;
+            m_blocked.erase(it);
+            found = true;
+            break;
+        }
+        if (found)
+            admitBlocked();
+    }
+    if (!found)
+        return;
+    qCDebug(proofUtilsLprPrinterDataLog) << "Print lane" << m_key << "canceled job removed from queue";
+    notifyObservers();
+    pump();
+}
+
+void PrintLane::pump()
+{
+    QVector<QueuedJob> toStart;
+    {
+        QMutexLocker locker(&m_mutex);
+        while (m_running < m_capacity) {
+            int index = nextQueueIndex();
+            if (index < 0)
+                break;
+            QueuedJob queued = m_queues[static_cast<size_t>(index)].dequeue();
+            // Job was canceled, but it is not yet removed from queue by dropCanceled
+            if (queued.promise.isFilled()) {
+                --m_jobs;
+                m_bytes -= queued.bytes;
+                continue;
+            }
+            toStart << queued;
+            ++m_running;
+        }
+    }
+    if (toStart.isEmpty())
+        return;
+    notifyObservers();
+
+    auto self = sharedFromThis();
+    for (const auto &queued : qAsConst(toStart)) {
+        Promise<bool> promise = queued.promise;
+        qint64 bytes = queued.bytes;
+        queued.job(promise.future())
+            .onSuccess([self, promise, bytes](bool result) {
+                promise.success(result);
+                self->jobFinished(bytes);
+            })
+            .onFailure([self, promise, bytes](const Failure &failure) {
+                promise.failure(failure);
+                self->jobFinished(bytes);
+            });
+    }
+}
+
+void PrintLane::jobFinished(qint64 bytes)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        --m_running;
+        --m_jobs;
+        m_bytes -= bytes;
+        admitBlocked();
+    }
+    notifyObservers();
+    pump();
+}
+
+void PrintLane::notifyObservers()
+{
+    QMutexLocker locker(&m_observersMutex);
+    const auto observers = m_observers;
+    for (const auto &observer : observers)
+        observer();
+}
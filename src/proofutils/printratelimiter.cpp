@@ -0,0 +1,118 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include "proofutils/printratelimiter_p.h"
+
+#include "proofutils/epllabelgenerator.h"
+#include "proofutils/lprcommandrunner_p.h"
+
+#include <cmath>
+
+using namespace Proof;
+
+PrintRateLimiter::PrintRateLimiter(double labelsPerSecond, int burst)
+{
+    m_clock.start();
+    setRate(labelsPerSecond, burst);
+}
+
+int PrintRateLimiter::labelsCount(const QByteArray &data)
+{
+    return EplLabelGenerator::printedLabelsCount(data);
+}
+
+double PrintRateLimiter::rate() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_rate;
+}
+
+int PrintRateLimiter::burst() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_burst;
+}
+
+void PrintRateLimiter::setRate(double labelsPerSecond, int burst)
+{
+    QMutexLocker locker(&m_mutex);
+    m_rate = qMax(0.0, labelsPerSecond);
+    m_burst = qMax(1, burst);
+    m_tokens = m_burst;
+    m_refilledAt = m_clock.elapsed();
+}
+
+bool PrintRateLimiter::isEnabled() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_rate > 0.0;
+}
+
+qint64 PrintRateLimiter::reserve(int labels)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_rate <= 0.0)
+        return 0;
+    refill();
+    double needed = qMin(labels, m_burst);
+    qint64 delay = m_tokens >= needed ? 0 : static_cast<qint64>(std::ceil((needed - m_tokens) * 1000.0 / m_rate));
+    m_tokens -= labels;
+    return delay;
+}
+
+void PrintRateLimiter::release(int labels)
+{
+    QMutexLocker locker(&m_mutex);
+    refill();
+    m_tokens = qMin(static_cast<double>(m_burst), m_tokens + labels);
+}
+
+Future<bool> PrintRateLimiter::acquire(int labels, const Future<bool> &canceled)
+{
+    qint64 delay = reserve(labels);
+    if (!delay)
+        return futures::successful(true);
+
+    qCDebug(proofUtilsLprPrinterDataLog) << "Job with" << labels << "labels is paced for" << delay << "msecs";
+    Promise<bool> promise;
+    auto self = sharedFromThis();
+    auto callback = [self, promise, labels, canceled] {
+        if (canceled.isFailed()) {
+            self->release(labels);
+            promise.failure(Failure(QStringLiteral("Printing aborted.\nJob was canceled."), UTILS_MODULE_CODE,
+                                    UtilsErrorCode::PrintJobCanceled));
+        } else {
+            promise.success(true);
+        }
+    };
+    LprCommandRunner::instance()->runLater(static_cast<int>(qMin(delay, static_cast<qint64>(INT_MAX))), callback);
+    return promise.future();
+}
+
+void PrintRateLimiter::refill()
+{
+    qint64 now = m_clock.elapsed();
+    m_tokens = qMin(static_cast<double>(m_burst), m_tokens + (now - m_refilledAt) * m_rate / 1000.0);
+    m_refilledAt = now;
+}
@@ -0,0 +1,537 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include "proofutils/printspool.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QPair>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QSet>
+#include <QThreadPool>
+#include <QWeakPointer>
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#    include <io.h>
+#    include <windows.h>
+#else
+#    include <sys/mman.h>
+#endif
+
+static const QByteArray FILE_MAGIC = QByteArrayLiteral("PRFSPOOL");
+static constexpr quint32 FILE_VERSION = 1;
+static constexpr qint64 FILE_HEADER_SIZE = 16;
+static constexpr quint32 RECORD_MAGIC = 0x44524352;
+static constexpr qint64 FILE_SIZE_STEP = 64 * 1024;
+static constexpr qint64 COMPACTION_THRESHOLD = 1024 * 1024;
+
+namespace {
+enum RecordState : quint32
+{
+    PendingRecord = 1,
+    DoneRecord = 2
+};
+
+struct RecordHeader
+{
+    quint32 magic;
+    quint32 state;
+    quint64 sequence;
+    quint32 size;
+    quint32 checksum;
+};
+static_assert(sizeof(RecordHeader) == 24, "Spool record header must be packed into 24 bytes");
+
+qint64 recordSize(qint64 dataSize)
+{
+    return static_cast<qint64>(sizeof(RecordHeader)) + ((dataSize + 7) & ~qint64(7));
+}
+
+quint32 crc32(quint32 crc, const char *data, size_t size)
+{
+    static const std::array<quint32, 256> table = [] {
+        std::array<quint32, 256> result{};
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 value = i;
+            for (int bit = 0; bit < 8; ++bit)
+                value = (value & 1) ? (value >> 1) ^ 0xEDB88320u : value >> 1;
+            result[i] = value;
+        }
+        return result;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+        crc = table[(crc ^ static_cast<uchar>(data[i])) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// Sequence and size are covered too, so header that reached disk without its payload is rejected
+quint32 recordChecksum(const char *data, quint32 size, quint64 sequence)
+{
+    quint32 result = crc32(0, reinterpret_cast<const char *>(&sequence), sizeof(sequence));
+    result = crc32(result, reinterpret_cast<const char *>(&size), sizeof(size));
+    return crc32(result, data, size);
+}
+
+class SyncRunnable : public QRunnable
+{
+public:
+    explicit SyncRunnable(const Proof::PrintSpoolSP &spool) : m_spool(spool) {}
+    void run() override { m_spool->sync(); }
+
+private:
+    Proof::PrintSpoolSP m_spool;
+};
+
+struct SpoolsRegistry
+{
+    QMutex mutex;
+    QHash<QString, QWeakPointer<Proof::PrintSpool>> spools;
+};
+} // namespace
+
+Q_GLOBAL_STATIC(SpoolsRegistry, spoolsRegistry)
+
+namespace Proof {
+class PrintSpoolPrivate
+{
+    Q_DECLARE_PUBLIC(PrintSpool)
+
+    bool openFile();
+    void scan();
+    bool remap(qint64 size);
+    bool ensureCapacity(qint64 size);
+    bool flushToDisk();
+    void compact();
+    RecordHeader headerAt(qint64 offset) const;
+    bool beginSending(quint64 sequence);
+    void endSending(quint64 sequence);
+
+    PrintSpool *q_ptr = nullptr;
+
+    QString key;
+    mutable QMutex mutex;
+    QFile file;
+    uchar *map = nullptr;
+    qint64 mapSize = 0;
+    qint64 writeOffset = FILE_HEADER_SIZE;
+    qint64 doneBytes = 0;
+    quint64 lastSequence = 0;
+    QMap<quint64, qint64> pending;
+    QSet<quint64> inFlight;
+    QVector<QPair<quint64, Promise<quint64>>> unsynced;
+    bool syncScheduled = false;
+};
+} // namespace Proof
+
+using namespace Proof;
+
+PrintSpool::PrintSpool(const QString &fileName) : d_ptr(new PrintSpoolPrivate)
+{
+    Q_D(PrintSpool);
+    d->q_ptr = this;
+    d->file.setFileName(fileName);
+}
+
+PrintSpool::~PrintSpool()
+{
+    Q_D(PrintSpool);
+    sync();
+    {
+        QMutexLocker locker(&d->mutex);
+        if (d->map)
+            d->file.unmap(d->map);
+        d->map = nullptr;
+    }
+    // Key is set only for registered spools, failed one is destroyed with registry locked in open()
+    auto registry = spoolsRegistry();
+    if (!registry || d->key.isEmpty())
+        return;
+    QMutexLocker locker(&registry->mutex);
+    auto it = registry->spools.find(d->key);
+    if (it != registry->spools.end() && it.value().isNull())
+        registry->spools.erase(it);
+}
+
+QSharedPointer<PrintSpool> PrintSpool::open(const QString &fileName)
+{
+    QFileInfo info(fileName);
+    QDir().mkpath(info.absolutePath());
+    QString key = QDir(info.absolutePath()).canonicalPath() + QLatin1Char('/') + info.fileName();
+    auto registry = spoolsRegistry();
+    QMutexLocker locker(&registry->mutex);
+    QSharedPointer<PrintSpool> spool = registry->spools.value(key).toStrongRef();
+    if (spool)
+        return spool;
+
+    spool = QSharedPointer<PrintSpool>(new PrintSpool(fileName));
+    if (!spool->d_func()->openFile())
+        return QSharedPointer<PrintSpool>();
+    spool->d_func()->key = key;
+    registry->spools[key] = spool;
+    qCDebug(proofUtilsLprPrinterInfoLog) << "Print spool" << fileName << "opened with" << spool->pendingCount()
+                                         << "pending entries";
+    return spool;
+}
+
+QString PrintSpool::fileName() const
+{
+    Q_D_CONST(PrintSpool);
+    return d->file.fileName();
+}
+
+int PrintSpool::pendingCount() const
+{
+    Q_D_CONST(PrintSpool);
+    QMutexLocker locker(&d->mutex);
+    return d->pending.count();
+}
+
+QVector<PrintSpool::Entry> PrintSpool::pendingEntries() const
+{
+    Q_D_CONST(PrintSpool);
+    QMutexLocker locker(&d->mutex);
+    QVector<Entry> result;
+    result.reserve(d->pending.count());
+    for (auto it = d->pending.cbegin(); it != d->pending.cend(); ++it) {
+        RecordHeader header = d->headerAt(it.value());
+        const char *data = reinterpret_cast<const char *>(d->map + it.value() + sizeof(RecordHeader));
+        result << Entry{header.sequence, QByteArray(data, static_cast<int>(header.size))};
+    }
+    return result;
+}
+
+Future<quint64> PrintSpool::append(const QByteArray &data)
+{
+    Q_D(PrintSpool);
+    Promise<quint64> promise;
+    bool scheduleSync = false;
+    {
+        QMutexLocker locker(&d->mutex);
+        qint64 size = recordSize(data.size());
+        if (!d->map || !d->ensureCapacity(size)) {
+            return Future<quint64>::failed(Failure(QStringLiteral("Label can't be stored in print spool"),
+                                                   UTILS_MODULE_CODE, UtilsErrorCode::PrintSpoolError));
+        }
+        RecordHeader header;
+        header.magic = RECORD_MAGIC;
+        header.state = PendingRecord;
+        header.sequence = ++d->lastSequence;
+        header.size = static_cast<quint32>(data.size());
+        header.checksum = recordChecksum(data.constData(), header.size, header.sequence);
+        // Dirty pages of mapping can reach disk in any order, record torn by power loss before sync
+        // is detected only by checksum of sequence, size and payload, scan stops at it
+        memcpy(d->map + d->writeOffset + sizeof(RecordHeader), data.constData(), static_cast<size_t>(data.size()));
+        memcpy(d->map + d->writeOffset, &header, sizeof(RecordHeader));
+        d->pending[header.sequence] = d->writeOffset;
+        d->writeOffset += size;
+        d->unsynced << qMakePair(header.sequence, promise);
+        scheduleSync = !d->syncScheduled;
+        d->syncScheduled = true;
+    }
+    if (scheduleSync)
+        QThreadPool::globalInstance()->start(new SyncRunnable(sharedFromThis()));
+    return promise.future();
+}
+
+void PrintSpool::markDone(quint64 sequence)
+{
+    Q_D(PrintSpool);
+    QMutexLocker locker(&d->mutex);
+    d->inFlight.remove(sequence);
+    auto it = d->pending.find(sequence);
+    if (it == d->pending.end() || !d->map)
+        return;
+    qint64 offset = it.value();
+    d->pending.erase(it);
+    // Not synced, after power loss entry can be pending again and is printed twice (at-least-once)
+    quint32 state = DoneRecord;
+    memcpy(d->map + offset + offsetof(RecordHeader, state), &state, sizeof(state));
+    d->doneBytes += recordSize(d->headerAt(offset).size);
+
+    if (d->pending.isEmpty() && d->unsynced.isEmpty()) {
+        memset(d->map + FILE_HEADER_SIZE, 0, static_cast<size_t>(d->writeOffset - FILE_HEADER_SIZE));
+        d->writeOffset = FILE_HEADER_SIZE;
+        d->doneBytes = 0;
+    } else if (d->doneBytes >= COMPACTION_THRESHOLD && d->doneBytes * 2 >= d->writeOffset) {
+        d->compact();
+    }
+}
+
+bool PrintSpool::sync()
+{
+    Q_D(PrintSpool);
+    QVector<QPair<quint64, Promise<quint64>>> toFill;
+    bool result = false;
+    {
+        QMutexLocker locker(&d->mutex);
+        d->syncScheduled = false;
+        std::swap(toFill, d->unsynced);
+        result = d->map && d->flushToDisk();
+    }
+    if (!result)
+        qCWarning(proofUtilsLprPrinterInfoLog) << "Print spool" << fileName() << "can't be flushed to disk";
+    for (const auto &entry : qAsConst(toFill)) {
+        if (result) {
+            entry.second.success(entry.first);
+        } else {
+            entry.second.failure(Failure(QStringLiteral("Print spool can't be flushed to disk"), UTILS_MODULE_CODE,
+                                         UtilsErrorCode::PrintSpoolError));
+        }
+    }
+    return result;
+}
+
+CancelableFuture<bool> PrintSpool::print(const QByteArray &data, const CancelableSender &sender)
+{
+    auto self = sharedFromThis();
+    Promise<bool> promise;
+    Future<bool> canceled = promise.future();
+    append(data)
+        .recoverWith([](const Failure &failure) {
+            qCWarning(proofUtilsLprPrinterInfoLog) << "Label is printed without spooling:" << failure.message;
+            return Future<quint64>::successful(0);
+        })
+        .flatMap([self, data, sender, canceled](quint64 sequence) -> Future<bool> {
+            if (sequence)
+                self->d_func()->beginSending(sequence);
+            CancelableFuture<bool> result = sender(data);
+            canceled.onFailure([result](const Failure &) mutable { result.cancel(); });
+            if (sequence) {
+                result.onSuccess([self, sequence](bool) { self->markDone(sequence); })
+                    .onFailure([self, sequence](const Failure &) { self->markDone(sequence); });
+            }
+            return result;
+        })
+        .onSuccess([promise](bool result) { promise.success(result); })
+        .onFailure([promise](const Failure &failure) { promise.failure(failure); });
+    return CancelableFuture<bool>(promise);
+}
+
+Future<bool> PrintSpool::spool(const QByteArray &data, const Sender &sender)
+{
+    auto self = sharedFromThis();
+    return append(data).map([self, data, sender](quint64 sequence) {
+        self->d_func()->beginSending(sequence);
+        sender(data)
+            .onSuccess([self, sequence](bool result) {
+                if (result) {
+                    self->markDone(sequence);
+                } else {
+                    self->d_func()->endSending(sequence);
+                    qCWarning(proofUtilsLprPrinterInfoLog) << "Spooled label" << sequence << "was not printed";
+                }
+            })
+            .onFailure([self, sequence](const Failure &failure) {
+                self->d_func()->endSending(sequence);
+                qCWarning(proofUtilsLprPrinterInfoLog)
+                    << "Spooled label" << sequence << "was not printed and is kept in spool:" << failure.message;
+            });
+        return true;
+    });
+}
+
+Future<bool> PrintSpool::replay(const Sender &sender)
+{
+    auto self = sharedFromThis();
+    Future<bool> result = futures::successful(true);
+    const QVector<Entry> entries = pendingEntries();
+    if (!entries.isEmpty()) {
+        qCDebug(proofUtilsLprPrinterInfoLog) << "Replaying" << entries.count() << "labels from print spool"
+                                             << fileName();
+    }
+    for (const auto &entry : entries) {
+        result = result.flatMap([self, sender, entry](bool) -> Future<bool> {
+            quint64 sequence = entry.sequence;
+            // Sent by print() or spool() right now or already done since snapshot
+            if (!self->d_func()->beginSending(sequence))
+                return futures::successful(true);
+            return sender(entry.data)
+                .map([self, sequence](bool printed) {
+                    if (printed)
+                        self->markDone(sequence);
+                    else
+                        self->d_func()->endSending(sequence);
+                    return printed;
+                })
+                .onFailure([self, sequence](const Failure &) { self->d_func()->endSending(sequence); });
+        });
+    }
+    return result;
+}
+
+bool PrintSpoolPrivate::openFile()
+{
+    if (!file.open(QIODevice::ReadWrite)) {
+        qCWarning(proofUtilsLprPrinterInfoLog) << "Print spool" << file.fileName()
+                                               << "can't be opened:" << file.errorString();
+        return false;
+    }
+
+    if (file.size() < FILE_HEADER_SIZE) {
+        if (!remap(FILE_SIZE_STEP))
+            return false;
+        quint32 version = FILE_VERSION;
+        memcpy(map, FILE_MAGIC.constData(), static_cast<size_t>(FILE_MAGIC.size()));
+        memcpy(map + FILE_MAGIC.size(), &version, sizeof(version));
+        return flushToDisk();
+    }
+
+    if (!remap(file.size()))
+        return false;
+    quint32 version = 0;
+    memcpy(&version, map + FILE_MAGIC.size(), sizeof(version));
+    if (memcmp(map, FILE_MAGIC.constData(), static_cast<size_t>(FILE_MAGIC.size())) || version != FILE_VERSION) {
+        qCWarning(proofUtilsLprPrinterInfoLog) << "Print spool" << file.fileName() << "has unknown format";
+        file.unmap(map);
+        map = nullptr;
+        return false;
+    }
+    scan();
+    return true;
+}
+
+void PrintSpoolPrivate::scan()
+{
+    pending.clear();
+    doneBytes = 0;
+    qint64 offset = FILE_HEADER_SIZE;
+    while (offset + static_cast<qint64>(sizeof(RecordHeader)) <= mapSize) {
+        RecordHeader header = headerAt(offset);
+        if (header.magic != RECORD_MAGIC || (header.state != PendingRecord && header.state != DoneRecord)
+            || recordSize(header.size) > mapSize - offset) {
+            break;
+        }
+        const char *data = reinterpret_cast<const char *>(map + offset + sizeof(RecordHeader));
+        if (recordChecksum(data, header.size, header.sequence) != header.checksum)
+            break;
+        lastSequence = qMax(lastSequence, header.sequence);
+        if (header.state == PendingRecord)
+            pending[header.sequence] = offset;
+        else
+            doneBytes += recordSize(header.size);
+        offset += recordSize(header.size);
+    }
+    writeOffset = offset;
+}
+
+bool PrintSpoolPrivate::remap(qint64 size)
+{
+    if (map) {
+        file.unmap(map);
+        map = nullptr;
+    }
+    size = ((size + FILE_SIZE_STEP - 1) / FILE_SIZE_STEP) * FILE_SIZE_STEP;
+    if (file.size() != size && !file.resize(size)) {
+        qCWarning(proofUtilsLprPrinterInfoLog) << "Print spool" << file.fileName()
+                                               << "can't be resized:" << file.errorString();
+        return false;
+    }
+    map = file.map(0, size);
+    mapSize = map ? size : 0;
+    if (!map) {
+        qCWarning(proofUtilsLprPrinterInfoLog) << "Print spool" << file.fileName()
+                                               << "can't be mapped:" << file.errorString();
+    }
+    return map;
+}
+
+bool PrintSpoolPrivate::ensureCapacity(qint64 size)
+{
+    if (writeOffset + size <= mapSize)
+        return true;
+    return flushToDisk() && remap(qMax(mapSize * 2, writeOffset + size));
+}
+
+bool PrintSpoolPrivate::flushToDisk()
+{
+#ifdef Q_OS_WIN
+    return FlushViewOfFile(map, static_cast<SIZE_T>(mapSize))
+           && FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(file.handle())));
+#else
+    return !msync(map, static_cast<size_t>(mapSize), MS_SYNC);
+#endif
+}
+
+void PrintSpoolPrivate::compact()
+{
+    QSaveFile compacted(file.fileName());
+    if (!compacted.open(QIODevice::WriteOnly)) {
+        qCWarning(proofUtilsLprPrinterInfoLog) << "Print spool" << file.fileName() << "can't be compacted";
+        return;
+    }
+    QByteArray fileHeader(FILE_HEADER_SIZE, '\0');
+    quint32 version = FILE_VERSION;
+    fileHeader.replace(0, FILE_MAGIC.size(), FILE_MAGIC);
+    memcpy(fileHeader.data() + FILE_MAGIC.size(), &version, sizeof(version));
+    compacted.write(fileHeader);
+    for (qint64 offset : qAsConst(pending)) {
+        const char *record = reinterpret_cast<const char *>(map + offset);
+        compacted.write(record, recordSize(headerAt(offset).size));
+    }
+
+    flushToDisk();
+    file.unmap(map);
+    map = nullptr;
+    file.close();
+    bool committed = compacted.commit();
+    if (!committed)
+        qCWarning(proofUtilsLprPrinterInfoLog) << "Print spool" << file.fileName() << "compaction failed";
+    if (file.open(QIODevice::ReadWrite) && remap(file.size())) {
+        scan();
+        qCDebug(proofUtilsLprPrinterDataLog) << "Print spool" << file.fileName() << "compacted to" << pending.count()
+                                             << "pending entries";
+    }
+}
+
+bool PrintSpoolPrivate::beginSending(quint64 sequence)
+{
+    QMutexLocker locker(&mutex);
+    if (!pending.contains(sequence) || inFlight.contains(sequence))
+        return false;
+    inFlight.insert(sequence);
+    return true;
+}
+
+void PrintSpoolPrivate::endSending(quint64 sequence)
+{
+    QMutexLocker locker(&mutex);
+    inFlight.remove(sequence);
+}
+
+RecordHeader PrintSpoolPrivate::headerAt(qint64 offset) const
+{
+    RecordHeader header;
+    memcpy(&header, map + offset, sizeof(RecordHeader));
+    return header;
+}
@@ -117,6 +117,12 @@ QByteArray QrCodeGenerator::generateEplBinaryData(const QString &string, int wid
     return result;
 }
 
+int QrCodeGenerator::modulesCount(const QString &string, QrCodeGenerator::Mode mode,
+                                  QrCodeGenerator::ErrorCorrection errorCorrection)
+{
+    return ::generateRawQrCode(string, mode, errorCorrection).width;
+}
+
 uint QrCodeGenerator::qHash(QrCodeGenerator::Mode arg, uint seed)
 {
     return ::qHash(static_cast<int>(arg), seed);
@@ -0,0 +1,237 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include "proofutils/rawsocketsender_p.h"
+
+#include <QFile>
+#include <QRunnable>
+#include <QThreadPool>
+
+#ifdef Q_OS_LINUX
+#    include <netdb.h>
+#    include <pthread.h>
+#    include <sys/sendfile.h>
+#    include <sys/socket.h>
+#    include <sys/time.h>
+#    include <unistd.h>
+
+#    include <cerrno>
+#    include <csignal>
+#    include <cstring>
+#else
+#    include <QTcpSocket>
+#endif
+
+static constexpr int MAX_PARALLEL_SENDS = 4;
+static constexpr qint64 CHUNK_SIZE = 1024 * 1024;
+
+using namespace Proof;
+
+namespace {
+struct SendTask
+{
+    QString host;
+    int port;
+    QString fileName;
+    unsigned int copies;
+    Future<bool> canceled;
+    RawSocketSender::ProgressCallback progress;
+    int timeout;
+    Promise<bool> promise;
+};
+
+class SendRunnable : public QRunnable
+{
+public:
+    explicit SendRunnable(const SendTask &task) : m_task(task) {}
+    void run() override;
+
+private:
+    void fail(const QString &message, long errorCode = UtilsErrorCode::PrinterConnectionError);
+    bool isCanceled();
+    void reportProgress(qint64 sent, qint64 total);
+
+    SendTask m_task;
+};
+
+Q_GLOBAL_STATIC(QThreadPool, sendersPool)
+
+void SendRunnable::fail(const QString &message, long errorCode)
+{
+    qCWarning(proofUtilsLprPrinterInfoLog) << "Sending" << m_task.fileName << "to" << m_task.host << m_task.port
+                                           << "failed:" << message;
+    m_task.promise.failure(Failure(message, UTILS_MODULE_CODE, errorCode));
+}
+
+bool SendRunnable::isCanceled()
+{
+    if (!m_task.canceled.isFailed())
+        return false;
+    fail(QStringLiteral("Printing aborted.\nJob was canceled."), UtilsErrorCode::PrintJobCanceled);
+    return true;
+}
+
+void SendRunnable::reportProgress(qint64 sent, qint64 total)
+{
+    if (m_task.progress)
+        m_task.progress(sent, total);
+}
+
+#ifdef Q_OS_LINUX
+void SendRunnable::run()
+{
+    // sendfile can't suppress SIGPIPE per call, so it is blocked in sender threads
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    QFile file(m_task.fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        fail(QStringLiteral("Printing aborted.\nCan't open %1.").arg(m_task.fileName),
+             UtilsErrorCode::PrintFileCannotBeOpened);
+        return;
+    }
+    const qint64 fileSize = file.size();
+    const qint64 total = fileSize * m_task.copies;
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *addresses = nullptr;
+    if (getaddrinfo(qPrintable(m_task.host), qPrintable(QString::number(m_task.port)), &hints, &addresses)) {
+        fail(QStringLiteral("Printing aborted.\nCan't resolve %1.").arg(m_task.host));
+        return;
+    }
+
+    timeval timeout;
+    timeout.tv_sec = m_task.timeout / 1000;
+    timeout.tv_usec = (m_task.timeout % 1000) * 1000;
+    int socketFd = -1;
+    for (addrinfo *address = addresses; address && socketFd == -1; address = address->ai_next) {
+        socketFd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (socketFd == -1)
+            continue;
+        // Send timeout is applied to connect as well
+        setsockopt(socketFd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        if (::connect(socketFd, address->ai_addr, address->ai_addrlen) == -1) {
+            close(socketFd);
+            socketFd = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+    if (socketFd == -1) {
+        fail(QStringLiteral("Printing aborted.\nCan't connect to %1:%2.").arg(m_task.host).arg(m_task.port));
+        return;
+    }
+
+    qint64 sent = 0;
+    for (unsigned int copy = 0; copy < m_task.copies; ++copy) {
+        off_t offset = 0;
+        while (offset < fileSize) {
+            if (isCanceled()) {
+                close(socketFd);
+                return;
+            }
+            auto chunk = static_cast<size_t>(qMin(CHUNK_SIZE, fileSize - offset));
+            ssize_t result = sendfile(socketFd, file.handle(), &offset, chunk);
+            if (result == -1 && errno == EINTR)
+                continue;
+            if (result <= 0) {
+                fail(QStringLiteral("Printing aborted.\nConnection to %1:%2 failed: %3")
+                         .arg(m_task.host)
+                         .arg(m_task.port)
+                         .arg(QString::fromLocal8Bit(strerror(errno))),
+                     UtilsErrorCode::PrinterConnectionLost);
+                close(socketFd);
+                return;
+            }
+            sent += result;
+            reportProgress(sent, total);
+        }
+    }
+    shutdown(socketFd, SHUT_WR);
+    close(socketFd);
+    m_task.promise.success(true);
+}
+#else
+void SendRunnable::run()
+{
+    QFile file(m_task.fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        fail(QStringLiteral("Printing aborted.\nCan't open %1.").arg(m_task.fileName),
+             UtilsErrorCode::PrintFileCannotBeOpened);
+        return;
+    }
+    const qint64 total = file.size() * m_task.copies;
+
+    QTcpSocket socket;
+    socket.connectToHost(m_task.host, static_cast<quint16>(m_task.port));
+    if (!socket.waitForConnected(m_task.timeout)) {
+        fail(QStringLiteral("Printing aborted.\nCan't connect to %1:%2.").arg(m_task.host).arg(m_task.port));
+        return;
+    }
+
+    QByteArray buffer;
+    qint64 sent = 0;
+    for (unsigned int copy = 0; copy < m_task.copies; ++copy) {
+        file.seek(0);
+        while (!file.atEnd()) {
+            if (isCanceled())
+                return;
+            buffer = file.read(CHUNK_SIZE);
+            socket.write(buffer);
+            while (socket.bytesToWrite()) {
+                if (!socket.waitForBytesWritten(m_task.timeout)) {
+                    fail(QStringLiteral("Printing aborted.\nConnection to %1:%2 failed: %3")
+                             .arg(m_task.host)
+                             .arg(m_task.port)
+                             .arg(socket.errorString()),
+                         UtilsErrorCode::PrinterConnectionLost);
+                    return;
+                }
+            }
+            sent += buffer.size();
+            reportProgress(sent, total);
+        }
+    }
+    socket.disconnectFromHost();
+    if (socket.state() != QAbstractSocket::UnconnectedState)
+        socket.waitForDisconnected(m_task.timeout);
+    m_task.promise.success(true);
+}
+#endif
+} // namespace
+
+Future<bool> RawSocketSender::sendFile(const QString &host, int port, const QString &fileName, unsigned int copies,
+                                       const Future<bool> &canceled, const ProgressCallback &progress, int timeout)
+{
+    Promise<bool> promise;
+    qCDebug(proofUtilsLprPrinterDataLog) << "Streaming" << fileName << copies << "times to" << host << port;
+    sendersPool()->setMaxThreadCount(MAX_PARALLEL_SENDS);
+    sendersPool()->start(new SendRunnable(SendTask{host, port, fileName, qMax(1u, copies), canceled, progress,
+                                                   timeout, promise}));
+    return promise.future();
+}
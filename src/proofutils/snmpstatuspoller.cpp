@@ -0,0 +1,573 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include "proofutils/snmpstatuspoller_p.h"
+
+#include <QHash>
+#include <QHostAddress>
+#include <QHostInfo>
+#include <QMutex>
+#include <QRandomGenerator>
+#include <QThread>
+#include <QTimer>
+#include <QUdpSocket>
+
+#include <algorithm>
+
+static constexpr int SNMP_VERSION_2C = 1;
+static constexpr int DEFAULT_TIMEOUT = 1000;
+static constexpr int DEFAULT_RETRIES = 1;
+
+namespace {
+enum BerTag
+{
+    Integer = 0x02,
+    OctetString = 0x04,
+    Null = 0x05,
+    ObjectIdentifier = 0x06,
+    Sequence = 0x30,
+    Counter32 = 0x41,
+    Gauge32 = 0x42,
+    TimeTicks = 0x43,
+    Counter64 = 0x46
+};
+
+QByteArray encodeLength(int length)
+{
+    QByteArray result;
+    if (length < 0x80) {
+        result.append(static_cast<char>(length));
+        return result;
+    }
+    while (length) {
+        result.prepend(static_cast<char>(length & 0xff));
+        length >>= 8;
+    }
+    result.prepend(static_cast<char>(0x80 | result.size()));
+    return result;
+}
+
+QByteArray encodeTlv(int tag, const QByteArray &content)
+{
+    return static_cast<char>(tag) + encodeLength(content.size()) + content;
+}
+
+QByteArray encodeInteger(qint64 value)
+{
+    QByteArray result;
+    do {
+        result.prepend(static_cast<char>(value & 0xff));
+        value >>= 8;
+    } while (value != 0 && value != -1);
+    // Sign bit of the first byte must match the value sign
+    bool negative = value == -1;
+    if (negative != static_cast<bool>(result[0] & 0x80))
+        result.prepend(static_cast<char>(negative ? 0xff : 0x00));
+    return encodeTlv(Integer, result);
+}
+
+QByteArray encodeOid(const QString &oid)
+{
+    const QStringList arcs = oid.split(QLatin1Char('.'), QString::SkipEmptyParts);
+    QByteArray result;
+    if (arcs.count() < 2)
+        return encodeTlv(ObjectIdentifier, result);
+    QVector<quint64> values = {arcs[0].toULongLong() * 40 + arcs[1].toULongLong()};
+    for (int i = 2; i < arcs.count(); ++i)
+        values << arcs[i].toULongLong();
+    for (quint64 value : qAsConst(values)) {
+        QByteArray encoded(1, static_cast<char>(value & 0x7f));
+        value >>= 7;
+        while (value) {
+            encoded.prepend(static_cast<char>(0x80 | (value & 0x7f)));
+            value >>= 7;
+        }
+        result.append(encoded);
+    }
+    return encodeTlv(ObjectIdentifier, result);
+}
+
+QByteArray encodeValue(const QVariant &value)
+{
+    if (!value.isValid())
+        return encodeTlv(Null, QByteArray());
+    if (value.type() == QVariant::ByteArray || value.type() == QVariant::String)
+        return encodeTlv(OctetString, value.toByteArray());
+    return encodeInteger(value.toLongLong());
+}
+
+class BerReader
+{
+public:
+    explicit BerReader(const QByteArray &data) : m_data(data) {}
+
+    bool atEnd() const { return m_pos >= m_data.size(); }
+
+    bool read(int *tag, QByteArray *content)
+    {
+        if (m_pos + 2 > m_data.size())
+            return false;
+        *tag = static_cast<quint8>(m_data[m_pos++]);
+        int length = static_cast<quint8>(m_data[m_pos++]);
+        if (length & 0x80) {
+            int lengthBytes = length & 0x7f;
+            if (lengthBytes < 1 || lengthBytes > 3 || m_pos + lengthBytes > m_data.size())
+                return false;
+            length = 0;
+            for (int i = 0; i < lengthBytes; ++i)
+                length = (length << 8) | static_cast<quint8>(m_data[m_pos++]);
+        }
+        if (m_pos + length > m_data.size())
+            return false;
+        *content = m_data.mid(m_pos, length);
+        m_pos += length;
+        return true;
+    }
+
+    bool read(int expectedTag, QByteArray *content)
+    {
+        int tag = 0;
+        return read(&tag, content) && tag == expectedTag;
+    }
+
+    bool readInteger(qint64 *value)
+    {
+        QByteArray content;
+        if (!read(Integer, &content) || content.isEmpty() || content.size() > 8)
+            return false;
+        *value = decodeInteger(content, true);
+        return true;
+    }
+
+    static qint64 decodeInteger(const QByteArray &content, bool isSigned)
+    {
+        qint64 result = (isSigned && !content.isEmpty() && (content[0] & 0x80)) ? -1 : 0;
+        for (char byte : content)
+            result = static_cast<qint64>((static_cast<quint64>(result) << 8) | static_cast<quint8>(byte));
+        return result;
+    }
+
+    static QString decodeOid(const QByteArray &content)
+    {
+        QStringList arcs;
+        quint64 value = 0;
+        for (char byte : content) {
+            value = (value << 7) | (static_cast<quint8>(byte) & 0x7f);
+            if (byte & 0x80)
+                continue;
+            if (arcs.isEmpty()) {
+                quint64 first = qMin(value / 40, quint64(2));
+                arcs << QString::number(first) << QString::number(value - first * 40);
+            } else {
+                arcs << QString::number(value);
+            }
+            value = 0;
+        }
+        return arcs.join(QLatin1Char('.'));
+    }
+
+private:
+    QByteArray m_data;
+    int m_pos = 0;
+};
+} // namespace
+
+namespace Proof {
+class SnmpStatusPollerPrivate
+{
+    Q_DECLARE_PUBLIC(SnmpStatusPoller)
+
+    struct Request
+    {
+        QString key;
+        QString host;
+        int port = 0;
+        QByteArray community;
+        QVector<Promise<SnmpPrinterStatus>> promises;
+        QByteArray datagram;
+        QHostAddress address;
+        int attemptsLeft = 0;
+        QTimer *timer = nullptr;
+    };
+
+    void startRequest(const QString &host, int port, const QByteArray &community,
+                      const Promise<SnmpPrinterStatus> &promise);
+    void send(qint32 requestId);
+    void readDatagrams();
+    void attemptTimedOut(qint32 requestId);
+    void finishRequest(qint32 requestId, const SnmpMessage &response);
+    void failRequest(qint32 requestId, const QString &message);
+
+    SnmpStatusPoller *q_ptr = nullptr;
+
+    QThread *thread = nullptr;
+    QObject *context = nullptr;
+
+    mutable QMutex mutex;
+    int timeout = DEFAULT_TIMEOUT;
+    int retries = DEFAULT_RETRIES;
+
+    // Used only from poller thread
+    QUdpSocket *socket = nullptr;
+    QHash<qint32, Request> requests;
+    QHash<QString, qint32> requestsByKey;
+    QHash<QString, QHostAddress> addresses;
+    qint32 lastRequestId = 0;
+};
+} // namespace Proof
+
+using namespace Proof;
+
+const QString SnmpPrinterStatus::HR_DEVICE_STATUS_OID = QStringLiteral("1.3.6.1.2.1.25.3.2.1.5.1");
+const QString SnmpPrinterStatus::HR_PRINTER_STATUS_OID = QStringLiteral("1.3.6.1.2.1.25.3.5.1.1.1");
+const QString SnmpPrinterStatus::HR_PRINTER_DETECTED_ERROR_STATE_OID = QStringLiteral("1.3.6.1.2.1.25.3.5.1.2.1");
+
+QByteArray SnmpMessage::encode() const
+{
+    QByteArray varBindsContent;
+    for (const auto &varBind : varBinds)
+        varBindsContent.append(encodeTlv(Sequence, encodeOid(varBind.oid) + encodeValue(varBind.value)));
+    QByteArray pdu = encodeInteger(requestId) + encodeInteger(errorStatus) + encodeInteger(errorIndex)
+                     + encodeTlv(Sequence, varBindsContent);
+    return encodeTlv(Sequence, encodeInteger(SNMP_VERSION_2C) + encodeTlv(OctetString, community)
+                                   + encodeTlv(pduType, pdu));
+}
+
+bool SnmpMessage::decode(const QByteArray &datagram, SnmpMessage *message)
+{
+    QByteArray content;
+    if (!BerReader(datagram).read(Sequence, &content))
+        return false;
+    BerReader messageReader(content);
+    qint64 version = 0;
+    if (!messageReader.readInteger(&version) || version != SNMP_VERSION_2C)
+        return false;
+    if (!messageReader.read(OctetString, &message->community))
+        return false;
+    QByteArray pdu;
+    if (!messageReader.read(&message->pduType, &pdu) || (message->pduType & 0xe0) != 0xa0)
+        return false;
+
+    BerReader pduReader(pdu);
+    qint64 requestId = 0;
+    qint64 errorStatus = 0;
+    qint64 errorIndex = 0;
+    QByteArray varBindsContent;
+    if (!pduReader.readInteger(&requestId) || !pduReader.readInteger(&errorStatus)
+        || !pduReader.readInteger(&errorIndex) || !pduReader.read(Sequence, &varBindsContent)) {
+        return false;
+    }
+    message->requestId = static_cast<qint32>(requestId);
+    message->errorStatus = static_cast<int>(errorStatus);
+    message->errorIndex = static_cast<int>(errorIndex);
+    message->varBinds.clear();
+
+    BerReader varBindsReader(varBindsContent);
+    while (!varBindsReader.atEnd()) {
+        QByteArray varBindContent;
+        if (!varBindsReader.read(Sequence, &varBindContent))
+            return false;
+        BerReader varBindReader(varBindContent);
+        QByteArray oid;
+        int valueTag = 0;
+        QByteArray value;
+        if (!varBindReader.read(ObjectIdentifier, &oid) || !varBindReader.read(&valueTag, &value))
+            return false;
+        SnmpVarBind varBind;
+        varBind.oid = BerReader::decodeOid(oid);
+        switch (valueTag) {
+        case Integer:
+            varBind.value = BerReader::decodeInteger(value, true);
+            break;
+        case Counter32:
+        case Gauge32:
+        case TimeTicks:
+        case Counter64:
+            varBind.value = BerReader::decodeInteger(value, false);
+            break;
+        case OctetString:
+            varBind.value = value;
+            break;
+        default:
+            // NULL, noSuchObject, noSuchInstance, endOfMibView and types we don't need
+            break;
+        }
+        message->varBinds << varBind;
+    }
+    return true;
+}
+
+SnmpPrinterStatus SnmpPrinterStatus::fromVarBinds(const QVector<SnmpVarBind> &varBinds)
+{
+    SnmpPrinterStatus result;
+    for (const auto &varBind : varBinds) {
+        if (!varBind.value.isValid())
+            continue;
+        if (varBind.oid == HR_DEVICE_STATUS_OID)
+            result.deviceStatus = static_cast<DeviceStatus>(varBind.value.toInt());
+        else if (varBind.oid == HR_PRINTER_STATUS_OID)
+            result.printerStatus = static_cast<PrinterStatus>(varBind.value.toInt());
+        else if (varBind.oid == HR_PRINTER_DETECTED_ERROR_STATE_OID)
+            result.detectedErrorState = varBind.value.toByteArray();
+    }
+    return result;
+}
+
+QStringList SnmpPrinterStatus::errors() const
+{
+    // Bits are numbered from the most significant bit of the first byte
+    static const QStringList names = {
+        QStringLiteral("lowPaper"),         QStringLiteral("noPaper"),           QStringLiteral("lowToner"),
+        QStringLiteral("noToner"),          QStringLiteral("doorOpen"),          QStringLiteral("jammed"),
+        QStringLiteral("offline"),          QStringLiteral("serviceRequested"),  QStringLiteral("inputTrayMissing"),
+        QStringLiteral("outputTrayMissing"), QStringLiteral("markerSupplyMissing"), QStringLiteral("outputNearFull"),
+        QStringLiteral("outputFull"),       QStringLiteral("inputTrayEmpty"),    QStringLiteral("overduePreventMaint")};
+    QStringList result;
+    for (int bit = 0; bit < names.count() && bit / 8 < detectedErrorState.size(); ++bit) {
+        if (static_cast<quint8>(detectedErrorState[bit / 8]) & (0x80 >> (bit % 8)))
+            result << names[bit];
+    }
+    return result;
+}
+
+bool SnmpPrinterStatus::isReady() const
+{
+    static const QStringList warnings = {QStringLiteral("lowPaper"), QStringLiteral("lowToner"),
+                                         QStringLiteral("outputNearFull"), QStringLiteral("overduePreventMaint")};
+    if (deviceStatus == DeviceStatus::Down || deviceStatus == DeviceStatus::Testing)
+        return false;
+    if (printerStatus == PrinterStatus::Other)
+        return false;
+    const QStringList detected = errors();
+    return std::all_of(detected.cbegin(), detected.cend(),
+                       [](const QString &error) { return warnings.contains(error); });
+}
+
+QString SnmpPrinterStatus::reason() const
+{
+    QStringList result = errors();
+    if (deviceStatus == DeviceStatus::Down)
+        result.prepend(QStringLiteral("device down"));
+    else if (deviceStatus == DeviceStatus::Testing)
+        result.prepend(QStringLiteral("device testing"));
+    if (printerStatus == PrinterStatus::Other && result.isEmpty())
+        result << QStringLiteral("printer status other");
+    return result.join(QStringLiteral(", "));
+}
+
+Q_GLOBAL_STATIC(SnmpStatusPoller, pollerInstance)
+
+SnmpStatusPoller::SnmpStatusPoller() : d_ptr(new SnmpStatusPollerPrivate)
+{
+    Q_D(SnmpStatusPoller);
+    d->q_ptr = this;
+    d->lastRequestId = static_cast<qint32>(QRandomGenerator::global()->bounded(0x10000000));
+    d->thread = new QThread;
+    d->thread->setObjectName(QStringLiteral("SnmpStatusPoller"));
+    d->context = new QObject;
+    d->context->moveToThread(d->thread);
+    QObject::connect(d->thread, &QThread::finished, d->context, &QObject::deleteLater);
+    d->thread->start();
+}
+
+SnmpStatusPoller::~SnmpStatusPoller()
+{
+    Q_D(SnmpStatusPoller);
+    d->thread->quit();
+    d->thread->wait();
+    delete d->thread;
+}
+
+SnmpStatusPoller *SnmpStatusPoller::instance()
+{
+    return pollerInstance();
+}
+
+int SnmpStatusPoller::timeout() const
+{
+    Q_D_CONST(SnmpStatusPoller);
+    QMutexLocker locker(&d->mutex);
+    return d->timeout;
+}
+
+void SnmpStatusPoller::setTimeout(int msecs)
+{
+    Q_D(SnmpStatusPoller);
+    QMutexLocker locker(&d->mutex);
+    d->timeout = qMax(1, msecs);
+}
+
+int SnmpStatusPoller::retries() const
+{
+    Q_D_CONST(SnmpStatusPoller);
+    QMutexLocker locker(&d->mutex);
+    return d->retries;
+}
+
+void SnmpStatusPoller::setRetries(int retries)
+{
+    Q_D(SnmpStatusPoller);
+    QMutexLocker locker(&d->mutex);
+    d->retries = qMax(0, retries);
+}
+
+Future<SnmpPrinterStatus> SnmpStatusPoller::fetchStatus(const QString &host, int port, const QByteArray &community)
+{
+    Q_D(SnmpStatusPoller);
+    Promise<SnmpPrinterStatus> promise;
+    QMetaObject::invokeMethod(d->context, [d, host, port, community, promise] {
+        d->startRequest(host, port, community, promise);
+    }, Qt::QueuedConnection);
+    return promise.future();
+}
+
+void SnmpStatusPollerPrivate::startRequest(const QString &host, int port, const QByteArray &community,
+                                           const Promise<SnmpPrinterStatus> &promise)
+{
+    QString key = QStringLiteral("%1:%2:%3").arg(host).arg(port).arg(QString::fromLatin1(community));
+    if (requestsByKey.contains(key)) {
+        requests[requestsByKey[key]].promises << promise;
+        return;
+    }
+
+    if (!socket) {
+        socket = new QUdpSocket(context);
+        if (!socket->bind(QHostAddress::Any, 0))
+            qCWarning(proofUtilsLprPrinterInfoLog) << "SNMP socket can't be bound:" << socket->errorString();
+        QObject::connect(socket, &QUdpSocket::readyRead, context, [this] { readDatagrams(); });
+    }
+
+    lastRequestId = (lastRequestId % 0x7ffffffe) + 1;
+    qint32 requestId = lastRequestId;
+    SnmpMessage message;
+    message.community = community;
+    message.requestId = requestId;
+    message.varBinds = {SnmpVarBind{SnmpPrinterStatus::HR_DEVICE_STATUS_OID, QVariant()},
+                        SnmpVarBind{SnmpPrinterStatus::HR_PRINTER_STATUS_OID, QVariant()},
+                        SnmpVarBind{SnmpPrinterStatus::HR_PRINTER_DETECTED_ERROR_STATE_OID, QVariant()}};
+
+    Request request;
+    request.key = key;
+    request.host = host;
+    request.port = port;
+    request.community = community;
+    request.promises << promise;
+    request.datagram = message.encode();
+    {
+        QMutexLocker locker(&mutex);
+        request.attemptsLeft = retries + 1;
+    }
+    request.timer = new QTimer(context);
+    request.timer->setSingleShot(true);
+    QObject::connect(request.timer, &QTimer::timeout, context, [this, requestId] { attemptTimedOut(requestId); });
+    requests[requestId] = request;
+    requestsByKey[key] = requestId;
+
+    QHostAddress address(host);
+    if (!address.isNull())
+        addresses[host] = address;
+    if (addresses.contains(host)) {
+        send(requestId);
+        return;
+    }
+    QHostInfo::lookupHost(host, context, [this, host, requestId](const QHostInfo &info) {
+        if (!requests.contains(requestId))
+            return;
+        if (info.error() != QHostInfo::NoError || info.addresses().isEmpty()) {
+            failRequest(requestId, QStringLiteral("Can't resolve %1").arg(host));
+            return;
+        }
+        addresses[host] = info.addresses().constFirst();
+        send(requestId);
+    });
+}
+
+void SnmpStatusPollerPrivate::send(qint32 requestId)
+{
+    Request &request = requests[requestId];
+    --request.attemptsLeft;
+    socket->writeDatagram(request.datagram, addresses[request.host], static_cast<quint16>(request.port));
+    QMutexLocker locker(&mutex);
+    request.timer->start(timeout);
+}
+
+void SnmpStatusPollerPrivate::readDatagrams()
+{
+    while (socket->hasPendingDatagrams()) {
+        QByteArray datagram(static_cast<int>(qMax(qint64(0), socket->pendingDatagramSize())), Qt::Uninitialized);
+        socket->readDatagram(datagram.data(), datagram.size());
+        SnmpMessage response;
+        if (!SnmpMessage::decode(datagram, &response) || response.pduType != SnmpMessage::GetResponse) {
+            qCDebug(proofUtilsLprPrinterDataLog) << "Unrecognized SNMP datagram received";
+            continue;
+        }
+        if (!requests.contains(response.requestId)
+            || requests[response.requestId].community != response.community) {
+            continue;
+        }
+        finishRequest(response.requestId, response);
+    }
+}
+
+void SnmpStatusPollerPrivate::attemptTimedOut(qint32 requestId)
+{
+    if (!requests.contains(requestId))
+        return;
+    const Request &request = requests[requestId];
+    if (request.attemptsLeft > 0) {
+        qCDebug(proofUtilsLprPrinterDataLog) << "SNMP request to" << request.host << "timed out, retrying";
+        send(requestId);
+        return;
+    }
+    failRequest(requestId, QStringLiteral("SNMP agent at %1:%2 doesn't respond").arg(request.host).arg(request.port));
+}
+
+void SnmpStatusPollerPrivate::finishRequest(qint32 requestId, const SnmpMessage &response)
+{
+    Request request = requests.take(requestId);
+    requestsByKey.remove(request.key);
+    request.timer->deleteLater();
+    if (response.errorStatus) {
+        QString message = QStringLiteral("SNMP agent at %1:%2 returned error %3")
+                              .arg(request.host)
+                              .arg(request.port)
+                              .arg(response.errorStatus);
+        for (const auto &promise : qAsConst(request.promises))
+            promise.failure(Failure(message, UTILS_MODULE_CODE, UtilsErrorCode::PrinterInfoError));
+        return;
+    }
+    SnmpPrinterStatus status = SnmpPrinterStatus::fromVarBinds(response.varBinds);
+    for (const auto &promise : qAsConst(request.promises))
+        promise.success(status);
+}
+
+void SnmpStatusPollerPrivate::failRequest(qint32 requestId, const QString &message)
+{
+    Request request = requests.take(requestId);
+    requestsByKey.remove(request.key);
+    request.timer->deleteLater();
+    qCWarning(proofUtilsLprPrinterInfoLog) << message;
+    for (const auto &promise : qAsConst(request.promises))
+        promise.failure(Failure(message, UTILS_MODULE_CODE, UtilsErrorCode::PrinterInfoCannotBeQueried));
+}
@@ -0,0 +1,280 @@
+// clazy:skip
+
+#include "proofnetwork/lprprinter/ippapi.h"
+
+#include "gtest/proof/test_global.h"
+
+#include <QDataStream>
+
+using namespace Proof::NetworkServices;
+using testing::Test;
+
+// Builds Get-Printer-Attributes replies the same way CUPS does
+class FakeIppReply
+{
+public:
+    explicit FakeIppReply(quint16 statusCode = 0x0000)
+    {
+        stream.setByteOrder(QDataStream::BigEndian);
+        stream << quint8(1) << quint8(1) << statusCode << quint32(1);
+        stream << quint8(0x01);
+        addAttribute(0x47, "attributes-charset", "utf-8");
+        addAttribute(0x48, "attributes-natural-language", "en");
+        stream << quint8(0x04);
+    }
+
+    FakeIppReply &addAttribute(quint8 tag, const QByteArray &name, const QByteArray &value)
+    {
+        stream << tag << quint16(name.size());
+        stream.writeRawData(name.constData(), name.size());
+        stream << quint16(value.size());
+        stream.writeRawData(value.constData(), value.size());
+        return *this;
+    }
+
+    FakeIppReply &addInt(quint8 tag, const QByteArray &name, quint32 value)
+    {
+        QByteArray raw;
+        QDataStream valueStream(&raw, QIODevice::WriteOnly);
+        valueStream.setByteOrder(QDataStream::BigEndian);
+        valueStream << value;
+        return addAttribute(tag, name, raw);
+    }
+
+    QByteArray data()
+    {
+        stream << quint8(0x03);
+        return reply;
+    }
+
+private:
+    QByteArray reply;
+    QDataStream stream{&reply, QIODevice::WriteOnly};
+};
+
+class IppApiTest : public Test
+{
+public:
+    IppApiTest() {}
+
+protected:
+    void SetUp() override
+    {
+        auto restClient = Proof::RestClientSP::create();
+        restClient->setAuthType(Proof::RestAuthType::NoAuth);
+        restClient->setHost("127.0.0.1");
+        restClient->setPort(9091); //Default port for FakeServer
+        restClient->setScheme("http");
+        restClient->setClientName("Proof-test");
+        ippApi = new IppApi(restClient);
+
+        serverRunner = new FakeServerRunner();
+        serverRunner->runServer();
+    }
+
+    void TearDown() override
+    {
+        delete serverRunner;
+        delete ippApi;
+    }
+
+protected:
+    IppApi *ippApi;
+    FakeServerRunner *serverRunner;
+};
+
+TEST_F(IppApiTest, fetchIdlePrinterStatus)
+{
+    ASSERT_TRUE(serverRunner->serverIsRunning());
+    serverRunner->setServerAnswer(FakeIppReply()
+                                      .addInt(0x23, "printer-state", 3)
+                                      .addAttribute(0x44, "printer-state-reasons", "none")
+                                      .addInt(0x21, "queued-job-count", 2)
+                                      .addAttribute(0x22, "printer-is-accepting-jobs", QByteArray(1, 1))
+                                      .data());
+
+    auto result = ippApi->fetchPrinterStatus("printer42");
+    result.wait();
+    ASSERT_TRUE(result.isSucceeded());
+
+    EXPECT_EQ(FakeServer::Method::Post, serverRunner->lastQueryMethod());
+    EXPECT_EQ(QUrl("/printers/printer42"), serverRunner->lastQueryUrl());
+    QByteArray body = serverRunner->lastQueryBody();
+    ASSERT_GT(body.size(), 9);
+    EXPECT_EQ(0x0B, body[3]);
+    EXPECT_TRUE(body.contains("ipp://127.0.0.1:9091/printers/printer42"));
+    EXPECT_TRUE(body.contains("printer-state-reasons"));
+    EXPECT_TRUE(body.contains("queued-job-count"));
+
+    IppPrinterStatus status = result.result();
+    EXPECT_EQ(IppPrinterStatus::State::Idle, status.state);
+    EXPECT_EQ(QStringList{"none"}, status.stateReasons);
+    EXPECT_EQ(2, status.queuedJobCount);
+    EXPECT_TRUE(status.isAcceptingJobs);
+    EXPECT_TRUE(status.isReady());
+    EXPECT_TRUE(status.reason().isEmpty());
+}
+
+TEST_F(IppApiTest, fetchStoppedPrinterStatus)
+{
+    ASSERT_TRUE(serverRunner->serverIsRunning());
+    serverRunner->setServerAnswer(FakeIppReply()
+                                      .addInt(0x23, "printer-state", 5)
+                                      .addAttribute(0x44, "printer-state-reasons", "media-empty-error")
+                                      .addAttribute(0x44, "", "cups-missing-filter-report")
+                                      .addInt(0x21, "queued-job-count", 0)
+                                      .data());
+
+    auto result = ippApi->fetchPrinterStatus("printer42");
+    result.wait();
+    ASSERT_TRUE(result.isSucceeded());
+    IppPrinterStatus status = result.result();
+    EXPECT_EQ(IppPrinterStatus::State::Stopped, status.state);
+    EXPECT_EQ(QStringList({"media-empty-error", "cups-missing-filter-report"}), status.stateReasons);
+    EXPECT_FALSE(status.isReady());
+}
+
+TEST_F(IppApiTest, fetchIdlePrinterWithErrorReason)
+{
+    ASSERT_TRUE(serverRunner->serverIsRunning());
+    serverRunner->setServerAnswer(FakeIppReply()
+                                      .addInt(0x23, "printer-state", 3)
+                                      .addAttribute(0x44, "printer-state-reasons", "offline-report")
+                                      .addAttribute(0x44, "", "paused")
+                                      .data());
+
+    auto result = ippApi->fetchPrinterStatus("printer42");
+    result.wait();
+    ASSERT_TRUE(result.isSucceeded());
+    IppPrinterStatus status = result.result();
+    EXPECT_FALSE(status.isReady());
+    EXPECT_EQ("offline-report, paused", status.reason());
+}
+
+TEST_F(IppApiTest, fetchIdlePrinterWithReportReason)
+{
+    ASSERT_TRUE(serverRunner->serverIsRunning());
+    serverRunner->setServerAnswer(FakeIppReply()
+                                      .addInt(0x23, "printer-state", 3)
+                                      .addAttribute(0x44, "printer-state-reasons", "cups-missing-filter-report")
+                                      .addAttribute(0x44, "", "toner-low-warning")
+                                      .data());
+
+    auto result = ippApi->fetchPrinterStatus("printer42");
+    result.wait();
+    ASSERT_TRUE(result.isSucceeded());
+    IppPrinterStatus status = result.result();
+    EXPECT_TRUE(status.isReady());
+    EXPECT_TRUE(status.reason().isEmpty());
+}
+
+TEST_F(IppApiTest, fetchOfflinePrinter)
+{
+    ASSERT_TRUE(serverRunner->serverIsRunning());
+    serverRunner->setServerAnswer(FakeIppReply()
+                                      .addInt(0x23, "printer-state", 3)
+                                      .addAttribute(0x44, "printer-state-reasons", "offline-report")
+                                      .data());
+
+    auto result = ippApi->fetchPrinterStatus("printer42");
+    result.wait();
+    ASSERT_TRUE(result.isSucceeded());
+    IppPrinterStatus status = result.result();
+    EXPECT_FALSE(status.isReady());
+    EXPECT_EQ("offline-report", status.reason());
+}
+
+TEST_F(IppApiTest, fetchPrinterCapabilities)
+{
+    ASSERT_TRUE(serverRunner->serverIsRunning());
+    QByteArray resolution = QByteArray::fromHex("000000cb000000cb03");
+    serverRunner->setServerAnswer(FakeIppReply()
+                                      .addAttribute(0x41, "printer-make-and-model", "Zebra GK420d")
+                                      .addAttribute(0x32, "printer-resolution-default", resolution)
+                                      .addAttribute(0x44, "media-default", "oe_4x6-label_4x6in")
+                                      .addAttribute(0x49, "document-format-supported", "application/octet-stream")
+                                      .addAttribute(0x49, "", "application/vnd.cups-raw")
+                                      .data());
+
+    auto result = ippApi->fetchPrinterCapabilities("printer42");
+    result.wait();
+    ASSERT_TRUE(result.isSucceeded());
+    QByteArray body = serverRunner->lastQueryBody();
+    EXPECT_TRUE(body.contains("printer-resolution-default"));
+    EXPECT_TRUE(body.contains("media-default"));
+
+    IppPrinterCapabilities capabilities = result.result();
+    EXPECT_EQ("Zebra GK420d", capabilities.makeAndModel);
+    EXPECT_EQ(203, capabilities.resolution);
+    EXPECT_EQ("oe_4x6-label_4x6in", capabilities.mediaName);
+    EXPECT_EQ(10160, capabilities.mediaWidth);
+    EXPECT_EQ(15240, capabilities.mediaLength);
+    EXPECT_EQ(QStringList({"application/octet-stream", "application/vnd.cups-raw"}), capabilities.documentFormats);
+}
+
+TEST_F(IppApiTest, fetchPrinterCapabilitiesInDotsPerCm)
+{
+    ASSERT_TRUE(serverRunner->serverIsRunning());
+    serverRunner->setServerAnswer(FakeIppReply()
+                                      .addAttribute(0x32, "printer-resolution-default",
+                                                    QByteArray::fromHex("000000780000007804"))
+                                      .addAttribute(0x44, "media-default", "custom_104x159mm_104x159mm")
+                                      .data());
+
+    auto result = ippApi->fetchPrinterCapabilities("printer42");
+    result.wait();
+    ASSERT_TRUE(result.isSucceeded());
+    IppPrinterCapabilities capabilities = result.result();
+    EXPECT_EQ(305, capabilities.resolution);
+    EXPECT_EQ(10400, capabilities.mediaWidth);
+    EXPECT_EQ(15900, capabilities.mediaLength);
+    EXPECT_TRUE(capabilities.makeAndModel.isEmpty());
+}
+
+TEST_F(IppApiTest, fetchJobStatus)
+{
+    ASSERT_TRUE(serverRunner->serverIsRunning());
+    serverRunner->setServerAnswer(FakeIppReply()
+                                      .addInt(0x23, "job-state", 7)
+                                      .addAttribute(0x44, "job-state-reasons", "job-canceled-by-user")
+                                      .data());
+
+    auto result = ippApi->fetchJobStatus("printer42", 1001);
+    result.wait();
+    ASSERT_TRUE(result.isSucceeded());
+
+    EXPECT_EQ(QUrl("/printers/printer42"), serverRunner->lastQueryUrl());
+    QByteArray body = serverRunner->lastQueryBody();
+    ASSERT_GT(body.size(), 9);
+    EXPECT_EQ(0x09, body[3]);
+    EXPECT_TRUE(body.contains(QByteArray("job-id") + QByteArray::fromHex("0004000003e9")));
+    EXPECT_TRUE(body.contains("job-state-reasons"));
+
+    IppJobStatus status = result.result();
+    EXPECT_EQ(IppJobStatus::State::Canceled, status.state);
+    EXPECT_EQ(QStringList{"job-canceled-by-user"}, status.stateReasons);
+    EXPECT_TRUE(status.isFinished());
+}
+
+TEST_F(IppApiTest, fetchUnknownPrinterStatus)
+{
+    ASSERT_TRUE(serverRunner->serverIsRunning());
+    serverRunner->setServerAnswer(FakeIppReply(0x0406).data());
+
+    auto result = ippApi->fetchPrinterStatus("printer42");
+    result.wait();
+    ASSERT_TRUE(result.isFailed());
+    EXPECT_EQ(Proof::NETWORK_LPR_PRINTER_MODULE_CODE, result.failureReason().moduleCode);
+    EXPECT_EQ(Proof::NetworkErrorCode::ServerError, result.failureReason().errorCode);
+}
+
+TEST_F(IppApiTest, fetchMalformedStatus)
+{
+    ASSERT_TRUE(serverRunner->serverIsRunning());
+    serverRunner->setServerAnswer("{}");
+
+    auto result = ippApi->fetchPrinterStatus("printer42");
+    result.wait();
+    ASSERT_TRUE(result.isFailed());
+    EXPECT_EQ(Proof::NetworkErrorCode::InvalidReply, result.failureReason().errorCode);
+}
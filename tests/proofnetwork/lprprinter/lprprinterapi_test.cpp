@@ -5,6 +5,7 @@
 #include "gtest/proof/test_global.h"
 
 #include <QFile>
+#include <QTemporaryFile>
 
 using namespace Proof::NetworkServices;
 using testing::Test;
@@ -153,6 +154,206 @@ TEST_F(LprPrinterApiTest, failedPrintLabel)
     EXPECT_EQ("Some error occurred", result.failureReason().message);
 }
 
+TEST_F(LprPrinterApiTest, printLabelAsBinary)
+{
+    ASSERT_TRUE(serverRunner->serverIsRunning());
+
+    QByteArray json = dataFromFile(":/data/status.json").trimmed();
+    ASSERT_FALSE(json.isEmpty());
+    serverRunner->setServerAnswer(json);
+
+    QByteArray label("some\0binary\xff", 12);
+    lprPrinterApi->setLabelUploadMode(LprPrinterApi::LabelUploadMode::Binary);
+    auto result = lprPrinterApi->printLabel(label, "printer42");
+    result.wait();
+
+    EXPECT_EQ(FakeServer::Method::Post, serverRunner->lastQueryMethod());
+    EXPECT_EQ(QUrl("/lpr/print-raw-binary?printer=printer42"), serverRunner->lastQueryUrl());
+    EXPECT_EQ(label, serverRunner->lastQueryBody());
+
+    ASSERT_TRUE(result.isSucceeded());
+    EXPECT_TRUE(result.result());
+}
+
+TEST_F(LprPrinterApiTest, failedPrintLabelAsBinary)
+{
+    ASSERT_TRUE(serverRunner->serverIsRunning());
+
+    QByteArray json = dataFromFile(":/data/failed_status.json").trimmed();
+    ASSERT_FALSE(json.isEmpty());
+    serverRunner->setServerAnswer(json);
+
+    lprPrinterApi->setLabelUploadMode(LprPrinterApi::LabelUploadMode::Binary);
+    auto result = lprPrinterApi->printLabel("something");
+    result.wait();
+    EXPECT_EQ(QUrl("/lpr/print-raw-binary"), serverRunner->lastQueryUrl());
+    EXPECT_EQ("something", serverRunner->lastQueryBody());
+
+    ASSERT_TRUE(result.isFailed());
+    EXPECT_EQ("Some error occurred", result.failureReason().message);
+}
+
+TEST_F(LprPrinterApiTest, printLabelBinaryFallback)
+{
+    ASSERT_TRUE(serverRunner->serverIsRunning());
+
+    QByteArray json = dataFromFile(":/data/status.json").trimmed();
+    ASSERT_FALSE(json.isEmpty());
+    serverRunner->setServerAnswer(json);
+    serverRunner->setResultCode(404, "Not Found");
+
+    EXPECT_EQ(LprPrinterApi::LabelUploadMode::Json, lprPrinterApi->labelUploadMode());
+    lprPrinterApi->setLabelUploadMode(LprPrinterApi::LabelUploadMode::Auto);
+    auto result = lprPrinterApi->printLabel("something");
+    result.wait();
+    // Both binary endpoint and JSON fallback are not found
+    EXPECT_EQ(QUrl("/lpr/print-raw"), serverRunner->lastQueryUrl());
+    ASSERT_TRUE(result.isFailed());
+
+    serverRunner->setResultCode(200, "OK");
+    result = lprPrinterApi->printLabel("something");
+    result.wait();
+    EXPECT_EQ(QUrl("/lpr/print-raw"), serverRunner->lastQueryUrl());
+    auto bodyObject = QJsonDocument::fromJson(serverRunner->lastQueryBody()).object();
+    EXPECT_EQ(QByteArray("something").toBase64().constData(), bodyObject["data"].toString().toLatin1());
+    ASSERT_TRUE(result.isSucceeded());
+    EXPECT_TRUE(result.result());
+}
+
+TEST_F(LprPrinterApiTest, printLabels)
+{
+    ASSERT_TRUE(serverRunner->serverIsRunning());
+    serverRunner->setServerAnswer(
+        R"([{"is_ready": true}, {"is_ready": false, "reason": "Paper jam"}, {"is_ready": true}])");
+
+    auto result = lprPrinterApi->printLabels({"first", "second", "third"}, "printer42");
+    result.wait();
+
+    EXPECT_EQ(FakeServer::Method::Post, serverRunner->lastQueryMethod());
+    EXPECT_EQ(QUrl("/lpr/print-raw-batch?printer=printer42"), serverRunner->lastQueryUrl());
+    EXPECT_EQ(QByteArray("\0\0\0\x05"
+                         "first"
+                         "\0\0\0\x06"
+                         "second"
+                         "\0\0\0\x05"
+                         "third",
+                         27),
+              serverRunner->lastQueryBody());
+
+    ASSERT_TRUE(result.isSucceeded());
+    auto results = result.result();
+    ASSERT_EQ(3, results.count());
+    EXPECT_TRUE(results[0].isPrinted);
+    EXPECT_FALSE(results[1].isPrinted);
+    EXPECT_EQ("Paper jam", results[1].reason);
+    EXPECT_TRUE(results[2].isPrinted);
+}
+
+TEST_F(LprPrinterApiTest, printLabelsInBatches)
+{
+    ASSERT_TRUE(serverRunner->serverIsRunning());
+    serverRunner->setServerAnswer(R"([{"is_ready": true}, {"is_ready": true}])");
+
+    lprPrinterApi->setBatchSize(2);
+    EXPECT_EQ(2, lprPrinterApi->batchSize());
+    auto result = lprPrinterApi->printLabels({"1", "2", "3", "4"});
+    result.wait();
+
+    EXPECT_EQ(QUrl("/lpr/print-raw-batch"), serverRunner->lastQueryUrl());
+    EXPECT_EQ(QByteArray("\0\0\0\x01"
+                         "3"
+                         "\0\0\0\x01"
+                         "4",
+                         10),
+              serverRunner->lastQueryBody());
+    ASSERT_TRUE(result.isSucceeded());
+    auto results = result.result();
+    ASSERT_EQ(4, results.count());
+    for (const auto &labelResult : results)
+        EXPECT_TRUE(labelResult.isPrinted);
+}
+
+TEST_F(LprPrinterApiTest, printLabelsInvalidReply)
+{
+    ASSERT_TRUE(serverRunner->serverIsRunning());
+    serverRunner->setServerAnswer(R"([{"is_ready": true}])");
+
+    lprPrinterApi->setBatchSize(2);
+    auto result = lprPrinterApi->printLabels({"1", "2", "3"});
+    result.wait();
+
+    // First batch gets one result for two labels, second batch is not sent
+    EXPECT_EQ(QByteArray("\0\0\0\x01"
+                         "1"
+                         "\0\0\0\x01"
+                         "2",
+                         10),
+              serverRunner->lastQueryBody());
+    ASSERT_TRUE(result.isSucceeded());
+    auto results = result.result();
+    ASSERT_EQ(3, results.count());
+    for (const auto &labelResult : results)
+        EXPECT_FALSE(labelResult.isPrinted);
+}
+
+TEST_F(LprPrinterApiTest, printCompressedLabel)
+{
+    ASSERT_TRUE(serverRunner->serverIsRunning());
+    serverRunner->setServerAnswer(R"({"is_ready": true, "encodings": ["deflate"]})");
+
+    QByteArray label = QByteArray("GW10,10,100,100,").append(QByteArray(10000, '\xff'));
+    auto supported = lprPrinterApi->fetchCompressionSupport();
+    supported.wait();
+    EXPECT_EQ(QUrl("/lpr/capabilities"), serverRunner->lastQueryUrl());
+    ASSERT_TRUE(supported.isSucceeded());
+    EXPECT_TRUE(supported.result());
+    ASSERT_TRUE(lprPrinterApi->compressionIsSupported());
+
+    lprPrinterApi->setLabelUploadMode(LprPrinterApi::LabelUploadMode::Binary);
+    lprPrinterApi->setCompressionThreshold(100);
+    lprPrinterApi->setCompressionEnabled(true);
+    EXPECT_TRUE(lprPrinterApi->compressionEnabled());
+    EXPECT_EQ(100, lprPrinterApi->compressionThreshold());
+
+    auto result = lprPrinterApi->printLabel(label, "printer42");
+    result.wait();
+    EXPECT_EQ(QUrl("/lpr/print-raw-binary?printer=printer42"), serverRunner->lastQueryUrl());
+    auto body = serverRunner->lastQueryBody();
+    EXPECT_LT(body.size(), label.size());
+    EXPECT_EQ(qCompress(label).mid(4), body);
+    ASSERT_TRUE(result.isSucceeded());
+
+    // Small labels are not worth compressing
+    result = lprPrinterApi->printLabel("small label", "printer42");
+    result.wait();
+    EXPECT_EQ(QUrl("/lpr/print-raw-binary?printer=printer42"), serverRunner->lastQueryUrl());
+    EXPECT_EQ("small label", serverRunner->lastQueryBody());
+    ASSERT_TRUE(result.isSucceeded());
+}
+
+TEST_F(LprPrinterApiTest, compressionIsNotSupported)
+{
+    ASSERT_TRUE(serverRunner->serverIsRunning());
+    serverRunner->setServerAnswer(R"({"is_ready": true})");
+
+    QByteArray label(1000, 'a');
+    auto supported = lprPrinterApi->fetchCompressionSupport();
+    supported.wait();
+    ASSERT_TRUE(supported.isSucceeded());
+    EXPECT_FALSE(supported.result());
+    EXPECT_FALSE(lprPrinterApi->compressionIsSupported());
+
+    lprPrinterApi->setLabelUploadMode(LprPrinterApi::LabelUploadMode::Binary);
+    lprPrinterApi->setCompressionThreshold(100);
+    lprPrinterApi->setCompressionEnabled(true);
+
+    auto result = lprPrinterApi->printLabel(label);
+    result.wait();
+    EXPECT_EQ(QUrl("/lpr/print-raw-binary"), serverRunner->lastQueryUrl());
+    EXPECT_EQ(label, serverRunner->lastQueryBody());
+    ASSERT_TRUE(result.isSucceeded());
+}
+
 TEST_F(LprPrinterApiTest, printFileAtDefaultPrinter)
 {
     ASSERT_TRUE(serverRunner->serverIsRunning());
@@ -218,6 +419,33 @@ TEST_F(LprPrinterApiTest, failedPrintFile)
     EXPECT_EQ("Some error occurred", result.failureReason().message);
 }
 
+TEST_F(LprPrinterApiTest, printBigFile)
+{
+    ASSERT_TRUE(serverRunner->serverIsRunning());
+
+    QByteArray json = dataFromFile(":/data/status.json").trimmed();
+    ASSERT_FALSE(json.isEmpty());
+    serverRunner->setServerAnswer(json);
+
+    QTemporaryFile file;
+    ASSERT_TRUE(file.open());
+    QByteArray data;
+    for (int i = 0; i < 64 * 1024; ++i)
+        data.append(QByteArray::number(i).rightJustified(16, '0'));
+    ASSERT_EQ(data.size(), file.write(data));
+    file.close();
+
+    auto result = lprPrinterApi->printFile(file.fileName(), "printer42", 2);
+    result.wait();
+
+    EXPECT_EQ(FakeServer::Method::Post, serverRunner->lastQueryMethod());
+    EXPECT_EQ(QUrl("/lpr/print?copies=2&printer=printer42"), serverRunner->lastQueryUrl());
+    EXPECT_EQ(data, serverRunner->lastQueryBody());
+
+    ASSERT_TRUE(result.isSucceeded());
+    EXPECT_TRUE(result.result());
+}
+
 TEST_F(LprPrinterApiTest, printFileFromWrongFile)
 {
     ASSERT_TRUE(serverRunner->serverIsRunning());
@@ -274,6 +274,81 @@ TEST(EplLabelGeneratorTest, sanity)
     }
 }
 
+TEST(EplLabelGeneratorTest, labelsPerSecond)
+{
+    {
+        EplLabelGenerator generator;
+        generator.startLabel(795, 788, 4, 10, 24);
+        EXPECT_DOUBLE_EQ(1.0, generator.labelsPerSecond());
+    }
+    {
+        EplLabelGenerator generator(300);
+        generator.startLabel(795, 576, 2, 10, 24);
+        EXPECT_DOUBLE_EQ(1.0, generator.labelsPerSecond());
+    }
+}
+
+TEST(EplLabelGeneratorTest, labelWithCopies)
+{
+    EXPECT_EQ("N\nA10,10,0,4,1,1,N,\"P1\"\nP1,20\n",
+              EplLabelGenerator::labelWithCopies("N\nA10,10,0,4,1,1,N,\"P1\"\nP1\n", 20));
+    EXPECT_EQ("N\r\nP2,6\r\n", EplLabelGenerator::labelWithCopies("N\r\nP2,3\r\n", 2));
+    EXPECT_EQ("N\nP1\nN\nP1\nN\nP1\nN\nP1\n", EplLabelGenerator::labelWithCopies("N\nP1\nN\nP1\n", 2));
+    EXPECT_EQ("^XA^FDtext^FS^XZ^XA^FDtext^FS^XZ", EplLabelGenerator::labelWithCopies("^XA^FDtext^FS^XZ", 2));
+    EXPECT_EQ(QByteArray("N\nP1\nA10,10,0,4,1,1,N,\"1\"\n").repeated(2),
+              EplLabelGenerator::labelWithCopies("N\nP1\nA10,10,0,4,1,1,N,\"1\"\n", 2));
+    EXPECT_EQ("N\nP1\n", EplLabelGenerator::labelWithCopies("N\nP1\n", 1));
+
+    // Raster bytes that look like print command are not rewritten
+    QByteArray raster("\nP1\n\xff\xff\nP2\n", 10);
+    QByteArray rasterLabel = QByteArray("N\nGW10,10,2,5,").append(raster).append("\nP1\n");
+    EXPECT_EQ(QByteArray("N\nGW10,10,2,5,").append(raster).append("\nP1,3\n"),
+              EplLabelGenerator::labelWithCopies(rasterLabel, 3));
+    EXPECT_EQ(1, EplLabelGenerator::printedLabelsCount(rasterLabel));
+    QByteArray brokenRasterLabel = QByteArray("N\nGW10,10,2,50,").append(raster).append("\nP1\n");
+    EXPECT_EQ(brokenRasterLabel.repeated(3), EplLabelGenerator::labelWithCopies(brokenRasterLabel, 3));
+
+    EplLabelGenerator generator;
+    generator.startLabel();
+    generator.addClearBufferCommand();
+    generator.addPrintCommand();
+    QByteArray label = generator.labelData();
+    QByteArray copies = EplLabelGenerator::labelWithCopies(label, 5);
+    ASSERT_FALSE(copies.isEmpty());
+    EXPECT_TRUE(copies.endsWith("P1,5\n"));
+}
+
+TEST(EplLabelGeneratorTest, labelProfile)
+{
+    EplLabelProfile profile;
+    profile.dpi = 300;
+    profile.width = 1200;
+    profile.height = 900;
+    profile.speed = 3;
+    profile.gapLength = 36;
+    EplLabelGenerator generator(profile);
+    EXPECT_EQ(QSize(1200, 900), generator.labelSize());
+    generator.startLabel(profile);
+    EXPECT_EQ("I8,A,001\nOD\nq1200\nQ900,36\nS3\nD10\nJF\n\n", generator.labelData());
+    EplLabelProfile result = generator.profile();
+    EXPECT_EQ(300, result.dpi);
+    EXPECT_EQ(1200, result.width);
+    EXPECT_EQ(900, result.height);
+    EXPECT_EQ(3, result.speed);
+    EXPECT_EQ(36, result.gapLength);
+    EXPECT_FALSE(result.nativeQrCode);
+}
+
+TEST(EplLabelGeneratorTest, nativeQrCode)
+{
+    EplLabelProfile profile;
+    profile.nativeQrCode = true;
+    EplLabelGenerator generator(profile);
+    QRect rect = generator.addQrCode("HELLO", 10, 20, 200);
+    EXPECT_EQ("b10,20,Q,m2,s9,eQ,iA,\"HELLO\"\n", generator.labelData());
+    EXPECT_EQ(QRect(10, 20, 189, 189), rect);
+}
+
 TEST(EplLabelGeneratorTest, emptyLabel)
 {
     EplLabelGenerator generator;
@@ -0,0 +1,218 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef PROOF_UTILS_TESTS_FAKELPRTOOLS_H
+#define PROOF_UTILS_TESTS_FAKELPRTOOLS_H
+
+#include "proofutils/lprcommandrunner_p.h"
+
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QTimer>
+#include <QVector>
+
+#include <algorithm>
+
+// Emulates lpr, lp, lpq and lpoptions through LprCommandRunner command handler while alive
+class FakeLprTools
+{
+public:
+    enum class PrinterState
+    {
+        Ready,
+        NotReady,
+        Offline,
+        Missing
+    };
+
+    struct PrintedJob
+    {
+        QString title;
+        QByteArray data;
+        QString printer;
+    };
+
+    explicit FakeLprTools(const QString &printerName) : m_printerName(printerName)
+    {
+        Proof::LprCommandRunner::instance()->setCommandHandler(
+            [this](const QString &program, const QStringList &arguments, const QByteArray &input) {
+                return handle(QFileInfo(program).baseName(), arguments, input);
+            });
+    }
+    FakeLprTools(const FakeLprTools &other) = delete;
+    FakeLprTools &operator=(const FakeLprTools &other) = delete;
+    FakeLprTools(FakeLprTools &&other) = delete;
+    FakeLprTools &operator=(FakeLprTools &&other) = delete;
+    ~FakeLprTools() { Proof::LprCommandRunner::instance()->setCommandHandler({}); }
+
+    void setPrinterState(PrinterState state)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_state = state;
+    }
+    // Other printers share state set without printer name
+    void setPrinterState(const QString &printer, PrinterState state)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_printerStates[printer] = state;
+    }
+    // Applied to every command
+    void setLatency(int msecs)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_latency = msecs;
+    }
+    void setExitCode(const QString &program, int exitCode)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_exitCodes[program] = exitCode;
+    }
+    void setNotStarted(const QString &program)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_notStarted << program;
+    }
+    // Printed jobs are listed in lpq for this number of lpq calls
+    void setQueuedPolls(int polls)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_queuedPolls = polls;
+    }
+
+    int callsCount(const QString &program) const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_calls.value(program);
+    }
+    QVector<PrintedJob> printedJobs() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_printed;
+    }
+
+private:
+    struct QueuedJob
+    {
+        QString title;
+        int id;
+        int pollsLeft;
+    };
+
+    Future<Proof::LprCommandResult> handle(const QString &program, const QStringList &arguments,
+                                           const QByteArray &input)
+    {
+        QMutexLocker locker(&m_mutex);
+        ++m_calls[program];
+        int printerIndex = std::max({arguments.indexOf(QStringLiteral("-P")), arguments.indexOf(QStringLiteral("-p")),
+                                     arguments.indexOf(QStringLiteral("-d"))});
+        QString printer = printerIndex >= 0 ? arguments.value(printerIndex + 1) : m_printerName;
+        PrinterState state = m_printerStates.value(printer, m_state);
+        Proof::LprCommandResult result;
+        if (m_notStarted.contains(program)) {
+            result.error = QProcess::FailedToStart;
+        } else if (program == QLatin1String("lpr")) {
+            result.exitCode = m_exitCodes.value(program);
+            if (!result.exitCode) {
+                int titleIndex = arguments.indexOf(QStringLiteral("-J")) + 1;
+                QString title = titleIndex > 0 ? arguments.value(titleIndex) : QString();
+                m_printed << PrintedJob{title, input, printer};
+                if (!title.isEmpty() && m_queuedPolls > 0)
+                    m_queue << QueuedJob{title, ++m_lastJobId, m_queuedPolls};
+            }
+        } else if (program == QLatin1String("lp")) {
+            result.exitCode = m_exitCodes.value(program);
+            if (!result.exitCode) {
+                int titleIndex = arguments.indexOf(QStringLiteral("-t")) + 1;
+                QString title = titleIndex > 0 ? arguments.value(titleIndex) : QString();
+                m_printed << PrintedJob{title, input, printer};
+                int id = ++m_lastJobId;
+                if (m_queuedPolls > 0)
+                    m_queue << QueuedJob{title, id, m_queuedPolls};
+                QString reply = QStringLiteral("request id is %1-%2 (0 file(s))\n").arg(printer).arg(id);
+                result.standardOutput = reply.toUtf8();
+            }
+        } else if (program == QLatin1String("lpq")) {
+            result.exitCode = m_exitCodes.value(program);
+            result.standardOutput = queueInfo(printer, state);
+            if (result.standardOutput.isEmpty())
+                result.standardError = "lpq: Unknown destination";
+        } else if (program == QLatin1String("lpoptions")) {
+            result.exitCode = m_exitCodes.value(program);
+            if (state == PrinterState::Offline)
+                result.standardOutput = "printer-state=5 printer-state-reasons=offline-report";
+            else if (state != PrinterState::Missing)
+                result.standardOutput = "printer-state=3 printer-state-reasons=none";
+        } else {
+            result.error = QProcess::FailedToStart;
+        }
+
+        Promise<Proof::LprCommandResult> promise;
+        if (m_latency > 0)
+            QTimer::singleShot(m_latency, [promise, result] { promise.success(result); });
+        else
+            promise.success(result);
+        return promise.future();
+    }
+
+    QByteArray queueInfo(const QString &printer, PrinterState state)
+    {
+        QString info;
+        switch (state) {
+        case PrinterState::Missing:
+            return QByteArray();
+        case PrinterState::NotReady:
+            info = QStringLiteral("%1 is not ready\n").arg(printer);
+            break;
+        default:
+            info = QStringLiteral("%1 is ready\n").arg(printer);
+            break;
+        }
+        if (m_queue.isEmpty())
+            return (info + QStringLiteral("no entries\n")).toLatin1();
+        info += QStringLiteral("Rank    Owner   Job     File(s)                         Total Size\n");
+        for (auto &job : m_queue) {
+            info += QStringLiteral("1st     proof   %1     %2     1024 bytes\n").arg(job.id).arg(job.title);
+            --job.pollsLeft;
+        }
+        auto printed = [](const QueuedJob &job) { return job.pollsLeft <= 0; };
+        m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(), printed), m_queue.end());
+        return info.toLatin1();
+    }
+
+    const QString m_printerName;
+    mutable QMutex m_mutex;
+    PrinterState m_state = PrinterState::Ready;
+    QHash<QString, PrinterState> m_printerStates;
+    int m_latency = 0;
+    QHash<QString, int> m_exitCodes;
+    QStringList m_notStarted;
+    int m_queuedPolls = 0;
+    QHash<QString, int> m_calls;
+    QVector<PrintedJob> m_printed;
+    QVector<QueuedJob> m_queue;
+    int m_lastJobId = 1000;
+};
+
+#endif // PROOF_UTILS_TESTS_FAKELPRTOOLS_H
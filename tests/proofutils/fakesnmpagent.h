@@ -0,0 +1,134 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef PROOF_UTILS_TESTS_FAKESNMPAGENT_H
+#define PROOF_UTILS_TESTS_FAKESNMPAGENT_H
+
+#include "proofutils/snmpstatuspoller_p.h"
+
+#include <QAtomicInteger>
+#include <QMutex>
+#include <QSemaphore>
+#include <QThread>
+#include <QUdpSocket>
+
+// Answers SNMPv2c GET requests for printer status objects on localhost while alive
+class FakeSnmpAgent : public QThread
+{
+public:
+    FakeSnmpAgent()
+    {
+        start();
+        m_started.acquire();
+    }
+    FakeSnmpAgent(const FakeSnmpAgent &other) = delete;
+    FakeSnmpAgent &operator=(const FakeSnmpAgent &other) = delete;
+    FakeSnmpAgent(FakeSnmpAgent &&other) = delete;
+    FakeSnmpAgent &operator=(FakeSnmpAgent &&other) = delete;
+    ~FakeSnmpAgent()
+    {
+        m_stopped = true;
+        wait();
+    }
+
+    quint16 port() const { return m_port; }
+    int requestsCount() const { return m_requestsCount; }
+
+    void setStatus(Proof::SnmpPrinterStatus::DeviceStatus deviceStatus,
+                   Proof::SnmpPrinterStatus::PrinterStatus printerStatus,
+                   const QByteArray &detectedErrorState = QByteArray(1, '\0'))
+    {
+        QMutexLocker locker(&m_mutex);
+        m_status.deviceStatus = deviceStatus;
+        m_status.printerStatus = printerStatus;
+        m_status.detectedErrorState = detectedErrorState;
+    }
+    // Requests are not answered until this number of them is dropped
+    void setDroppedRequests(int count) { m_droppedRequests = count; }
+    // Applied before every answer
+    void setLatency(int msecs) { m_latency = msecs; }
+
+protected:
+    void run() override
+    {
+        QUdpSocket socket;
+        socket.bind(QHostAddress::LocalHost, 0);
+        m_port = socket.localPort();
+        m_started.release();
+        while (!m_stopped) {
+            if (!socket.waitForReadyRead(20))
+                continue;
+            while (socket.hasPendingDatagrams()) {
+                QByteArray datagram(static_cast<int>(socket.pendingDatagramSize()), Qt::Uninitialized);
+                QHostAddress sender;
+                quint16 senderPort = 0;
+                socket.readDatagram(datagram.data(), datagram.size(), &sender, &senderPort);
+                ++m_requestsCount;
+                if (m_droppedRequests.fetchAndAddOrdered(-1) > 0)
+                    continue;
+                m_droppedRequests = 0;
+                Proof::SnmpMessage request;
+                if (!Proof::SnmpMessage::decode(datagram, &request))
+                    continue;
+                if (m_latency)
+                    msleep(static_cast<unsigned long>(m_latency.load()));
+                socket.writeDatagram(answer(request).encode(), sender, senderPort);
+            }
+        }
+    }
+
+private:
+    Proof::SnmpMessage answer(const Proof::SnmpMessage &request)
+    {
+        QMutexLocker locker(&m_mutex);
+        Proof::SnmpMessage response = request;
+        response.pduType = Proof::SnmpMessage::GetResponse;
+        for (auto &varBind : response.varBinds) {
+            if (varBind.oid == Proof::SnmpPrinterStatus::HR_DEVICE_STATUS_OID)
+                varBind.value = static_cast<qint64>(m_status.deviceStatus);
+            else if (varBind.oid == Proof::SnmpPrinterStatus::HR_PRINTER_STATUS_OID)
+                varBind.value = static_cast<qint64>(m_status.printerStatus);
+            else if (varBind.oid == Proof::SnmpPrinterStatus::HR_PRINTER_DETECTED_ERROR_STATE_OID)
+                varBind.value = m_status.detectedErrorState;
+        }
+        return response;
+    }
+
+    QSemaphore m_started;
+    QAtomicInteger<bool> m_stopped = false;
+    QAtomicInteger<quint16> m_port = 0;
+    QAtomicInteger<int> m_requestsCount = 0;
+    QAtomicInteger<int> m_droppedRequests = 0;
+    QAtomicInteger<int> m_latency = 0;
+    QMutex m_mutex;
+    Proof::SnmpPrinterStatus m_status = []() {
+        Proof::SnmpPrinterStatus status;
+        status.deviceStatus = Proof::SnmpPrinterStatus::DeviceStatus::Running;
+        status.printerStatus = Proof::SnmpPrinterStatus::PrinterStatus::Idle;
+        status.detectedErrorState = QByteArray(1, '\0');
+        return status;
+    }();
+};
+
+#endif // PROOF_UTILS_TESTS_FAKESNMPAGENT_H
@@ -0,0 +1,166 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+// clazy:skip
+
+#include "proofutils/labelpipeline.h"
+
+#include "gtest/proof/test_global.h"
+
+#include "fakelprtools.h"
+
+#include <QThread>
+
+#include <atomic>
+
+using namespace Proof;
+
+static LabelPipeline::LabelBuilder textLabel(int index, int generationDelay = 0)
+{
+    return [index, generationDelay](EplLabelGenerator &generator) {
+        if (generationDelay)
+            QThread::msleep(static_cast<unsigned long>(generationDelay));
+        generator.addText(QStringLiteral("label %1").arg(index), 10, 10);
+    };
+}
+
+TEST(LabelPipelineTest, order)
+{
+    FakeLprTools tools("FakeZebra");
+    LabelPrinter printer(LabelPrinterParams("Zebra", "", "FakeZebra"));
+    LabelPipeline pipeline(&printer);
+    pipeline.setGenerationThreads(4);
+    QVector<CancelableFuture<bool>> futures;
+    // Later labels are generated faster, so they are ready before earlier ones
+    for (int i = 0; i < 12; ++i)
+        futures << pipeline.addLabel(textLabel(i, (12 - i) * 3));
+    for (const auto &f : futures) {
+        f.wait(10000);
+        ASSERT_TRUE(f.isCompleted());
+        EXPECT_TRUE(f.isSucceeded());
+    }
+
+    auto printed = tools.printedJobs();
+    ASSERT_EQ(12, printed.count());
+    for (int i = 0; i < printed.count(); ++i) {
+        EXPECT_TRUE(printed[i].data.contains(QStringLiteral("\"label %1\"").arg(i).toLatin1())) << printed[i].data;
+        EXPECT_TRUE(printed[i].data.startsWith("I8,A,001\n")) << printed[i].data;
+        EXPECT_TRUE(printed[i].data.endsWith("P1\n")) << printed[i].data;
+    }
+
+    auto stats = pipeline.stats();
+    EXPECT_EQ(12, stats.generated);
+    EXPECT_EQ(12, stats.printed);
+    EXPECT_EQ(0, stats.failed);
+    EXPECT_GT(stats.generationTime, 0);
+    EXPECT_GT(stats.printTime, 0);
+    EXPECT_EQ(0, pipeline.pendingLabelsCount());
+}
+
+TEST(LabelPipelineTest, addLabels)
+{
+    FakeLprTools tools("FakeZebra");
+    LabelPrinter printer(LabelPrinterParams("Zebra", "", "FakeZebra"));
+    LabelPipeline pipeline(&printer);
+    QVector<LabelPipeline::LabelBuilder> builders;
+    for (int i = 0; i < 5; ++i)
+        builders << textLabel(i);
+    auto f = pipeline.addLabels(builders);
+    f.wait(10000);
+    ASSERT_TRUE(f.isCompleted());
+    EXPECT_TRUE(f.isSucceeded());
+    EXPECT_EQ(5, tools.printedJobs().count());
+}
+
+TEST(LabelPipelineTest, boundedQueue)
+{
+    FakeLprTools tools("FakeZebra");
+    LabelPrinter printer(LabelPrinterParams("Zebra", "", "FakeZebra"));
+    auto readiness = printer.printerIsReady();
+    readiness.wait(10000);
+    ASSERT_TRUE(readiness.isSucceeded());
+    tools.setLatency(200);
+
+    LabelPipeline pipeline(&printer);
+    pipeline.setQueueCapacity(2);
+    pipeline.setPrintsInFlight(1);
+    std::atomic_int built{0};
+    QVector<CancelableFuture<bool>> futures;
+    for (int i = 0; i < 10; ++i) {
+        futures << pipeline.addLabel([&built, i](EplLabelGenerator &generator) {
+            ++built;
+            generator.addText(QString::number(i), 10, 10);
+        });
+    }
+    QThread::msleep(100);
+    // One label is printing and at most two are waiting for printer
+    EXPECT_LE(built.load(), 3);
+    EXPECT_EQ(10, pipeline.pendingLabelsCount());
+
+    for (const auto &f : futures)
+        f.cancel();
+    for (const auto &f : futures) {
+        f.wait(10000);
+        ASSERT_TRUE(f.isCompleted());
+    }
+}
+
+TEST(LabelPipelineTest, cancel)
+{
+    FakeLprTools tools("FakeZebra");
+    tools.setLatency(50);
+    LabelPrinter printer(LabelPrinterParams("Zebra", "", "FakeZebra"));
+    LabelPipeline pipeline(&printer);
+    pipeline.setPrintsInFlight(1);
+    auto first = pipeline.addLabel(textLabel(0));
+    auto second = pipeline.addLabel(textLabel(1));
+    auto third = pipeline.addLabel(textLabel(2));
+    second.cancel();
+    for (const auto &f : {first, second, third}) {
+        f.wait(10000);
+        ASSERT_TRUE(f.isCompleted());
+    }
+    EXPECT_TRUE(first.isSucceeded());
+    ASSERT_TRUE(second.isFailed());
+    EXPECT_TRUE(third.isSucceeded());
+
+    auto printed = tools.printedJobs();
+    ASSERT_EQ(2, printed.count());
+    EXPECT_TRUE(printed[0].data.contains("\"label 0\""));
+    EXPECT_TRUE(printed[1].data.contains("\"label 2\""));
+}
+
+TEST(LabelPipelineTest, printFailure)
+{
+    FakeLprTools tools("FakeZebra");
+    tools.setPrinterState(FakeLprTools::PrinterState::Offline);
+    LabelPrinter printer(LabelPrinterParams("Zebra", "", "FakeZebra"));
+    LabelPipeline pipeline(&printer);
+    auto f = pipeline.addLabel(textLabel(0));
+    f.wait(10000);
+    ASSERT_TRUE(f.isCompleted());
+    ASSERT_TRUE(f.isFailed());
+    EXPECT_EQ(UtilsErrorCode::PrinterOffline, f.failureReason().errorCode);
+    EXPECT_EQ(1, pipeline.stats().failed);
+}
@@ -1,9 +1,12 @@
 // clazy:skip
 
 #include "proofutils/labelprinter.h"
+#include "proofutils/printlane_p.h"
 
 #include "gtest/proof/test_global.h"
 
+#include "fakelprtools.h"
+
 using namespace Proof;
 using testing::Test;
 
@@ -84,6 +87,37 @@ TEST_F(LabelPrinterTest, print)
     EXPECT_TRUE(f.result());
 }
 
+TEST_F(LabelPrinterTest, servicePriorities)
+{
+    ASSERT_TRUE(serverRunner->serverIsRunning());
+    serverRunner->setServerAnswer(R"({"is_ready": true})");
+    LabelPrinter printer(LabelPrinterParams("someTitle", "127.0.0.1", "shortNameHere", 9091, true, false));
+    auto first = printer.printLabel("first", false, PrintPriority::Normal);
+    auto bulk = printer.printLabel("bulk", false, PrintPriority::Bulk);
+    auto interactive = printer.printLabel("interactive", false, PrintPriority::Interactive);
+    for (auto f : {first, bulk, interactive}) {
+        f.wait(5000);
+        ASSERT_TRUE(f.isCompleted());
+        EXPECT_TRUE(f.isSucceeded());
+    }
+    // Interactive label overtakes bulk one that was waiting for service
+    EXPECT_TRUE(serverRunner->lastQueryBody().contains(QByteArray("bulk").toBase64()));
+    EXPECT_EQ(0, printer.queuedJobsCount());
+    EXPECT_EQ(0, printer.runningJobsCount());
+}
+
+TEST_F(LabelPrinterTest, serviceLaneCapacity)
+{
+    LabelPrinterParams params("someTitle", "127.0.0.1", "shortNameHere", 9091, true, false);
+    LabelPrinter printer(params);
+    auto lane = PrintLane::forPrinter("service:127.0.0.1:9091", "shortNameHere");
+    EXPECT_EQ(1, lane->capacity());
+
+    params.serviceLaneCapacity = 3;
+    LabelPrinter widePrinter(params);
+    EXPECT_EQ(3, lane->capacity());
+}
+
 TEST_F(LabelPrinterTest, printNegative)
 {
     ASSERT_TRUE(serverRunner->serverIsRunning());
@@ -96,3 +130,172 @@ TEST_F(LabelPrinterTest, printNegative)
     EXPECT_TRUE(f.isFailed());
     EXPECT_EQ("some reason", f.failureReason().message);
 }
+
+TEST_F(LabelPrinterTest, printToCapture)
+{
+    LabelPrinterParams params("someTitle", "127.0.0.1", "shortNameHere", 9091, true, false);
+    params.captureMode = PrintCapture::Mode::Memory;
+    params.captureRingSize = 10;
+    LabelPrinter printer(params);
+    ASSERT_TRUE(printer.capture());
+
+    auto ready = printer.printerIsReady();
+    ready.wait(1000);
+    ASSERT_TRUE(ready.isCompleted());
+    EXPECT_TRUE(ready.result());
+
+    QVector<Future<bool>> results;
+    for (int i = 0; i < 100; ++i)
+        results << printer.printLabel(QByteArray::number(i));
+    for (const auto &f : qAsConst(results)) {
+        f.wait(1000);
+        ASSERT_TRUE(f.isCompleted());
+        EXPECT_TRUE(f.result());
+    }
+    EXPECT_EQ(100u, printer.capture()->jobsCount());
+    auto records = printer.capture()->records();
+    ASSERT_EQ(10, records.count());
+    EXPECT_EQ("99", records.last().data);
+    EXPECT_LT(0.0, printer.capture()->jobsPerSecond());
+}
+
+TEST_F(LabelPrinterTest, warmUpAll)
+{
+    FakeLprTools tools("WarmZebra");
+    LabelPrinterParams readyParams("ready", "", "WarmZebra");
+    readyParams.readinessCacheTime = 3000;
+    LabelPrinter readyPrinter(readyParams);
+    LabelPrinter brokenPrinter(LabelPrinterParams("broken", "", "OtherZebra"));
+    LabelPrinterParams captureParams("capture", "127.0.0.1", "shortNameHere", 9091, true, false);
+    captureParams.captureMode = PrintCapture::Mode::Discard;
+    LabelPrinter capturePrinter(captureParams);
+
+    auto f = LabelPrinter::warmUpAll({&readyPrinter, &brokenPrinter, &capturePrinter});
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    ASSERT_TRUE(f.isSucceeded());
+    auto results = f.result();
+    ASSERT_EQ(3, results.count());
+    EXPECT_EQ("ready", results[0].printerTitle);
+    EXPECT_TRUE(results[0].ready);
+    EXPECT_EQ("broken", results[1].printerTitle);
+    EXPECT_FALSE(results[1].ready);
+    EXPECT_EQ(UtilsErrorCode::PrinterInfoError, results[1].errorCode);
+    EXPECT_FALSE(results[1].message.isEmpty());
+    EXPECT_TRUE(results[2].ready);
+    EXPECT_EQ(2, tools.callsCount("lpq"));
+
+    auto print = readyPrinter.printLabel("some label");
+    print.wait(5000);
+    ASSERT_TRUE(print.isCompleted());
+    EXPECT_TRUE(print.isSucceeded());
+    EXPECT_EQ(2, tools.callsCount("lpq"));
+}
+
+TEST_F(LabelPrinterTest, transportFailover)
+{
+    ASSERT_TRUE(serverRunner->serverIsRunning());
+    serverRunner->setServerAnswer(R"({"is_ready": true})");
+    FakeLprTools tools("FailoverZebra");
+    tools.setPrinterState(FakeLprTools::PrinterState::Offline);
+    LabelPrinterParams params("failover", "127.0.0.1", "FailoverZebra", 9091);
+    params.transportFailover = true;
+    LabelPrinter printer(params);
+    ASSERT_TRUE(printer.transportFailoverEnabled());
+    EXPECT_EQ(LabelPrinter::Transport::Hardware, printer.preferredTransport());
+
+    auto f = printer.printLabel("some label");
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    EXPECT_TRUE(f.isSucceeded());
+    EXPECT_TRUE(tools.printedJobs().isEmpty());
+    EXPECT_EQ(1, tools.callsCount("lpoptions"));
+    EXPECT_EQ(LabelPrinter::Transport::Service, printer.preferredTransport());
+
+    f = printer.printLabel("some label");
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    EXPECT_TRUE(f.isSucceeded());
+    EXPECT_EQ(1, tools.callsCount("lpoptions"));
+}
+
+TEST_F(LabelPrinterTest, transportFailoverUnderLoad)
+{
+    ASSERT_TRUE(serverRunner->serverIsRunning());
+    serverRunner->setServerAnswer(R"({"is_ready": true})");
+    FakeLprTools tools("FailoverZebra");
+    tools.setPrinterState(FakeLprTools::PrinterState::Offline);
+    tools.setLatency(200);
+    LabelPrinterParams params("failover", "127.0.0.1", "FailoverZebra", 9091);
+    params.transportFailover = true;
+    LabelPrinter printer(params);
+
+    auto first = printer.printLabel("first label");
+    auto second = printer.printLabel("second label");
+    first.wait(5000);
+    ASSERT_TRUE(first.isCompleted());
+    EXPECT_TRUE(first.isSucceeded());
+    // Second label is still in flight, but failed transport is not pinned anymore
+    auto third = printer.printLabel("third label");
+    for (const auto &f : {second, third}) {
+        f.wait(5000);
+        ASSERT_TRUE(f.isCompleted());
+        EXPECT_TRUE(f.isSucceeded());
+    }
+    EXPECT_EQ(2, tools.callsCount("lpoptions"));
+}
+
+TEST_F(LabelPrinterTest, transportFailoverToHardware)
+{
+    ASSERT_TRUE(serverRunner->serverIsRunning());
+    FakeLprTools tools("FailoverZebra");
+    LabelPrinterParams params("failover", "127.0.0.1", "FailoverZebra", 9091);
+    params.transportFailover = true;
+    LabelPrinter printer(params);
+
+    auto f = printer.printLabel("some label");
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    EXPECT_TRUE(f.isSucceeded());
+    ASSERT_EQ(1, tools.printedJobs().count());
+    EXPECT_EQ(LabelPrinter::Transport::Hardware, printer.preferredTransport());
+
+    LabelPrinter hardwareOnly(LabelPrinterParams("hardware", "127.0.0.1", "FailoverZebra", 9091));
+    EXPECT_FALSE(hardwareOnly.transportFailoverEnabled());
+}
+
+TEST_F(LabelPrinterTest, transportFailoverAmbiguousFailure)
+{
+    ASSERT_TRUE(serverRunner->serverIsRunning());
+    serverRunner->setServerAnswer(R"({"is_ready": true})");
+    FakeLprTools tools("FailoverZebra");
+    tools.setExitCode("lpr", 1);
+    LabelPrinterParams params("failover", "127.0.0.1", "FailoverZebra", 9091);
+    params.transportFailover = true;
+    LabelPrinter printer(params);
+
+    auto f = printer.printLabel("some label");
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    ASSERT_TRUE(f.isFailed());
+    EXPECT_EQ(UtilsErrorCode::LprProcessNonZeroExitCode, f.failureReason().errorCode);
+    EXPECT_EQ(1, tools.callsCount("lpr"));
+    EXPECT_EQ(LabelPrinter::Transport::Hardware, printer.preferredTransport());
+}
+
+TEST_F(LabelPrinterTest, transportFailoverCancel)
+{
+    ASSERT_TRUE(serverRunner->serverIsRunning());
+    FakeLprTools tools("FailoverZebra");
+    tools.setLatency(200);
+    LabelPrinterParams params("failover", "127.0.0.1", "FailoverZebra", 9091);
+    params.transportFailover = true;
+    LabelPrinter printer(params);
+
+    auto f = printer.printLabel("some label");
+    f.cancel();
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    EXPECT_TRUE(f.isFailed());
+    EXPECT_EQ(LabelPrinter::Transport::Hardware, printer.preferredTransport());
+}
@@ -0,0 +1,165 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+// clazy:skip
+
+#include "proofutils/labelprinterpool.h"
+
+#include "gtest/proof/test_global.h"
+
+#include "fakelprtools.h"
+
+using namespace Proof;
+
+static QVector<LabelPrinterParams> poolParams()
+{
+    return {LabelPrinterParams("Zebra 1", "", "FakeZebra1"), LabelPrinterParams("Zebra 2", "", "FakeZebra2")};
+}
+
+TEST(LabelPrinterPoolTest, balance)
+{
+    FakeLprTools tools("FakeZebra1");
+    tools.setLatency(20);
+    LabelPrinterPool pool(poolParams());
+    ASSERT_EQ(2, pool.printers().count());
+    QVector<CancelableFuture<bool>> futures;
+    for (int i = 0; i < 20; ++i)
+        futures << pool.printLabel(QByteArray::number(i));
+    for (const auto &f : futures) {
+        f.wait(10000);
+        ASSERT_TRUE(f.isCompleted());
+        EXPECT_TRUE(f.isSucceeded());
+    }
+
+    auto printed = tools.printedJobs();
+    ASSERT_EQ(20, printed.count());
+    int firstPrinterJobs = std::count_if(printed.cbegin(), printed.cend(),
+                                         [](const auto &job) { return job.printer == "FakeZebra1"; });
+    EXPECT_GT(firstPrinterJobs, 0);
+    EXPECT_LT(firstPrinterJobs, 20);
+    EXPECT_EQ(2, pool.healthyPrintersCount());
+}
+
+TEST(LabelPrinterPoolTest, groupOrdering)
+{
+    FakeLprTools tools("FakeZebra1");
+    tools.setLatency(50);
+    LabelPrinterPool pool(poolParams());
+    QVector<CancelableFuture<bool>> futures;
+    for (int i = 0; i < 10; ++i) {
+        futures << pool.printLabel(QByteArray("a") + QByteArray::number(i), "a");
+        futures << pool.printLabel(QByteArray("b") + QByteArray::number(i), "b");
+    }
+    for (const auto &f : futures) {
+        f.wait(10000);
+        ASSERT_TRUE(f.isCompleted());
+        EXPECT_TRUE(f.isSucceeded());
+    }
+
+    QHash<char, QStringList> printers;
+    QHash<char, QByteArrayList> labels;
+    for (const auto &job : tools.printedJobs()) {
+        printers[job.data[0]] << job.printer;
+        labels[job.data[0]] << job.data;
+    }
+    for (char group : {'a', 'b'}) {
+        ASSERT_EQ(10, labels[group].count());
+        for (int i = 0; i < 10; ++i)
+            EXPECT_EQ(QByteArray(1, group) + QByteArray::number(i), labels[group][i]);
+        EXPECT_EQ(1, printers[group].toSet().count());
+    }
+}
+
+TEST(LabelPrinterPoolTest, failover)
+{
+    FakeLprTools tools("FakeZebra1");
+    tools.setPrinterState("FakeZebra2", FakeLprTools::PrinterState::Offline);
+    LabelPrinterPool pool(poolParams());
+    QVector<CancelableFuture<bool>> futures;
+    for (int i = 0; i < 6; ++i)
+        futures << pool.printLabel("label");
+    for (const auto &f : futures) {
+        f.wait(10000);
+        ASSERT_TRUE(f.isCompleted());
+        EXPECT_TRUE(f.isSucceeded());
+    }
+
+    auto printed = tools.printedJobs();
+    ASSERT_EQ(6, printed.count());
+    for (const auto &job : printed)
+        EXPECT_EQ("FakeZebra1", job.printer);
+    EXPECT_TRUE(pool.isPrinterHealthy(0));
+    EXPECT_FALSE(pool.isPrinterHealthy(1));
+    EXPECT_EQ(1, pool.healthyPrintersCount());
+}
+
+TEST(LabelPrinterPoolTest, ambiguousFailureIsNotResent)
+{
+    FakeLprTools tools("FakeZebra1");
+    tools.setExitCode("lpr", 1);
+    LabelPrinterPool pool(poolParams());
+    auto f = pool.printLabel("label");
+    f.wait(10000);
+    ASSERT_TRUE(f.isCompleted());
+    ASSERT_TRUE(f.isFailed());
+    EXPECT_EQ(UtilsErrorCode::LprProcessNonZeroExitCode, f.failureReason().errorCode);
+    EXPECT_EQ(1, tools.callsCount("lpr"));
+    EXPECT_EQ(2, pool.healthyPrintersCount());
+}
+
+TEST(LabelPrinterPoolTest, allPrintersFailed)
+{
+    FakeLprTools tools("FakeZebra1");
+    tools.setPrinterState(FakeLprTools::PrinterState::Offline);
+    LabelPrinterPool pool(poolParams());
+    auto f = pool.printLabel("label");
+    f.wait(10000);
+    ASSERT_TRUE(f.isCompleted());
+    ASSERT_TRUE(f.isFailed());
+    EXPECT_EQ(UtilsErrorCode::PrinterOffline, f.failureReason().errorCode);
+    EXPECT_TRUE(tools.printedJobs().isEmpty());
+    EXPECT_EQ(2, tools.callsCount("lpoptions"));
+    EXPECT_EQ(0, pool.healthyPrintersCount());
+}
+
+TEST(LabelPrinterPoolTest, cancelKeepsPrinterHealthy)
+{
+    FakeLprTools tools("FakeZebra1");
+    tools.setLatency(200);
+    LabelPrinterPool pool(poolParams());
+    int healthChanges = 0;
+    QObject::connect(&pool, &LabelPrinterPool::printerHealthChanged, [&healthChanges](int, bool) { ++healthChanges; });
+    auto f = pool.printLabel("label");
+    f.cancel();
+    f.wait(10000);
+    ASSERT_TRUE(f.isCompleted());
+    EXPECT_TRUE(f.isFailed());
+
+    auto next = pool.printLabel("label");
+    next.wait(10000);
+    ASSERT_TRUE(next.isCompleted());
+    EXPECT_TRUE(next.isSucceeded());
+    EXPECT_EQ(2, pool.healthyPrintersCount());
+    EXPECT_EQ(0, healthChanges);
+}
@@ -0,0 +1,118 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+// clazy:skip
+
+#include "proofutils/labelprinterregistry.h"
+
+#include "gtest/proof/test_global.h"
+
+#include <QThread>
+
+using namespace Proof;
+
+class LabelPrinterRegistryTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        registry = LabelPrinterRegistry::instance();
+        registry->clear();
+        registry->registerPrinter("zebra1", LabelPrinterParams("Zebra 1", "", "FakeZebra1"));
+        registry->registerPrinter("zebra2", LabelPrinterParams("Zebra 2", "", "FakeZebra2"));
+    }
+
+    void TearDown() override { registry->clear(); }
+
+    LabelPrinterRegistry *registry = nullptr;
+};
+
+TEST_F(LabelPrinterRegistryTest, sharedInstance)
+{
+    EXPECT_EQ((QStringList{"zebra1", "zebra2"}), registry->printerNames());
+    EXPECT_TRUE(registry->contains("zebra1"));
+    auto first = registry->printer("zebra1");
+    ASSERT_TRUE(first);
+    EXPECT_EQ("Zebra 1", first->title());
+    EXPECT_EQ(first, registry->printer("zebra1"));
+    auto second = registry->printer("zebra2");
+    ASSERT_TRUE(second);
+    EXPECT_NE(first, second);
+}
+
+TEST_F(LabelPrinterRegistryTest, unknownPrinter)
+{
+    EXPECT_FALSE(registry->contains("zebra3"));
+    EXPECT_FALSE(registry->printer("zebra3"));
+    EXPECT_FALSE(registry->selectedPrinter());
+}
+
+TEST_F(LabelPrinterRegistryTest, reregister)
+{
+    auto first = registry->printer("zebra1");
+    ASSERT_TRUE(first);
+    registry->registerPrinter("zebra1", LabelPrinterParams("Zebra 1 renamed", "", "FakeZebra1"));
+    EXPECT_EQ((QStringList{"zebra1", "zebra2"}), registry->printerNames());
+    auto second = registry->printer("zebra1");
+    ASSERT_TRUE(second);
+    EXPECT_NE(first, second);
+    EXPECT_EQ("Zebra 1 renamed", second->title());
+}
+
+TEST_F(LabelPrinterRegistryTest, paramsComparison)
+{
+    LabelPrinterParams params("Zebra 1", "", "FakeZebra1");
+    LabelPrinterParams other = params;
+    EXPECT_TRUE(params == other);
+    other.spoolFileName = "labels.spool";
+    EXPECT_TRUE(params != other);
+    other = params;
+    other.captureMode = PrintCapture::Mode::Discard;
+    EXPECT_TRUE(params != other);
+    other = params;
+    other.snmpPort = 161;
+    EXPECT_TRUE(params != other);
+    other = params;
+    other.serviceLaneCapacity = 4;
+    EXPECT_TRUE(params != other);
+}
+
+TEST_F(LabelPrinterRegistryTest, concurrentAccess)
+{
+    QVector<LabelPrinterSP> printers(8);
+    QVector<QThread *> threads;
+    for (int i = 0; i < printers.count(); ++i) {
+        threads << QThread::create([this, &printers, i]() { printers[i] = registry->printer("zebra2"); });
+        threads.last()->start();
+    }
+    for (QThread *thread : qAsConst(threads)) {
+        thread->wait(10000);
+        delete thread;
+    }
+    ASSERT_TRUE(printers.first());
+    for (const auto &printer : qAsConst(printers))
+        EXPECT_EQ(printers.first(), printer);
+    if (qApp)
+        EXPECT_EQ(qApp->thread(), printers.first()->thread());
+}
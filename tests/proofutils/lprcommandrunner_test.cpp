@@ -0,0 +1,96 @@
+// clazy:skip
+
+#include "proofutils/lprcommandrunner_p.h"
+
+#include "gtest/proof/test_global.h"
+
+#include <QThread>
+
+using namespace Proof;
+
+TEST(LprCommandRunnerTest, inputAndOutput)
+{
+    auto f = LprCommandRunner::instance()->run("cat", {}, "some label");
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    ASSERT_TRUE(f.isSucceeded());
+    LprCommandResult result = f.result();
+    EXPECT_TRUE(result.isStarted());
+    EXPECT_TRUE(result.isSucceeded());
+    EXPECT_EQ("some label", result.standardOutput);
+}
+
+TEST(LprCommandRunnerTest, exitCode)
+{
+    auto f = LprCommandRunner::instance()->run("sh", {"-c", "echo error >&2; exit 3"});
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    LprCommandResult result = f.result();
+    EXPECT_TRUE(result.isStarted());
+    EXPECT_FALSE(result.isSucceeded());
+    EXPECT_EQ(3, result.exitCode);
+    EXPECT_EQ("error\n", result.standardError);
+}
+
+TEST(LprCommandRunnerTest, notStarted)
+{
+    auto f = LprCommandRunner::instance()->run("proof_this_binary_does_not_exist", {});
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    LprCommandResult result = f.result();
+    EXPECT_FALSE(result.isStarted());
+    EXPECT_FALSE(result.isSucceeded());
+}
+
+TEST(LprCommandRunnerTest, timeout)
+{
+    auto runner = LprCommandRunner::instance();
+    int oldTimeout = runner->timeout();
+    runner->setTimeout(100);
+    auto f = runner->run("sleep", {"5"});
+    f.wait(3000);
+    runner->setTimeout(oldTimeout);
+    ASSERT_TRUE(f.isCompleted());
+    LprCommandResult result = f.result();
+    EXPECT_TRUE(result.isStarted());
+    EXPECT_FALSE(result.isSucceeded());
+    EXPECT_EQ(QProcess::Timedout, result.error);
+}
+
+TEST(LprCommandRunnerTest, abort)
+{
+    Promise<bool> abortSignal;
+    auto f = LprCommandRunner::instance()->run("sleep", {"5"}, QByteArray(), abortSignal.future());
+    QThread::msleep(200);
+    EXPECT_FALSE(f.isCompleted());
+    abortSignal.failure(Failure("canceled", UTILS_MODULE_CODE, UtilsErrorCode::PrintJobCanceled));
+    f.wait(3000);
+    ASSERT_TRUE(f.isCompleted());
+    LprCommandResult result = f.result();
+    EXPECT_TRUE(result.aborted);
+    EXPECT_FALSE(result.isSucceeded());
+}
+
+TEST(LprCommandRunnerTest, abortBeforeStart)
+{
+    Promise<bool> abortSignal;
+    abortSignal.failure(Failure("canceled", UTILS_MODULE_CODE, UtilsErrorCode::PrintJobCanceled));
+    auto f = LprCommandRunner::instance()->run("cat", {}, "some label", abortSignal.future());
+    f.wait(3000);
+    ASSERT_TRUE(f.isCompleted());
+    LprCommandResult result = f.result();
+    EXPECT_TRUE(result.aborted);
+    EXPECT_TRUE(result.standardOutput.isEmpty());
+}
+
+TEST(LprCommandRunnerTest, parallelProcesses)
+{
+    QVector<Future<LprCommandResult>> results;
+    for (int i = 0; i < 20; ++i)
+        results << LprCommandRunner::instance()->run("sh", {"-c", QString("echo %1").arg(i)});
+    for (int i = 0; i < results.count(); ++i) {
+        results[i].wait(5000);
+        ASSERT_TRUE(results[i].isCompleted());
+        EXPECT_EQ(QByteArray::number(i) + "\n", results[i].result().standardOutput);
+    }
+}
@@ -0,0 +1,376 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+// clazy:skip
+
+#include "proofutils/lprprinter.h"
+
+#include "gtest/proof/test_global.h"
+
+#include "fakelprtools.h"
+#include "fakesnmpagent.h"
+
+#include <QElapsedTimer>
+#include <QThread>
+
+using namespace Proof;
+using namespace Proof::Hardware;
+
+TEST(LprPrinterTest, printRawData)
+{
+    FakeLprTools tools("FakeZebra");
+    LprPrinter printer("", "FakeZebra");
+    auto f = printer.printRawData("some label");
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    ASSERT_TRUE(f.isSucceeded());
+    EXPECT_TRUE(f.result());
+    EXPECT_EQ(1, tools.callsCount("lpq"));
+    EXPECT_EQ(1, tools.callsCount("lpoptions"));
+    auto printed = tools.printedJobs();
+    ASSERT_EQ(1, printed.count());
+    EXPECT_EQ("some label", printed[0].data);
+}
+
+TEST(LprPrinterTest, readinessCache)
+{
+    FakeLprTools tools("FakeZebra");
+    LprPrinter printer("", "FakeZebra");
+    EXPECT_EQ(0, printer.readinessCacheTime());
+    printer.setReadinessCacheTime(3000);
+    auto warmUp = printer.warmUp();
+    warmUp.wait(5000);
+    ASSERT_TRUE(warmUp.isCompleted());
+    EXPECT_TRUE(warmUp.isSucceeded());
+    EXPECT_EQ(1, tools.callsCount("lpq"));
+
+    for (int i = 0; i < 3; ++i) {
+        auto f = printer.printRawData("some label");
+        f.wait(5000);
+        ASSERT_TRUE(f.isCompleted());
+        EXPECT_TRUE(f.isSucceeded());
+    }
+    EXPECT_EQ(1, tools.callsCount("lpq"));
+    EXPECT_EQ(3, tools.printedJobs().count());
+
+    auto ready = printer.printerIsReady();
+    ready.wait(5000);
+    ASSERT_TRUE(ready.isCompleted());
+    EXPECT_EQ(2, tools.callsCount("lpq"));
+
+    printer.setReadinessCacheTime(0);
+    auto f = printer.printRawData("some label");
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    EXPECT_EQ(3, tools.callsCount("lpq"));
+}
+
+TEST(LprPrinterTest, snmpStatus)
+{
+    FakeLprTools tools("FakeZebra");
+    FakeSnmpAgent agent;
+    LprPrinter printer("", "FakeZebra", true);
+    printer.setReadinessCacheTime(0);
+    printer.setStatusSource(LprPrinter::StatusSource::Snmp, agent.port());
+    EXPECT_EQ(LprPrinter::StatusSource::Snmp, printer.statusSource());
+    auto f = printer.printRawData("some label");
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    EXPECT_TRUE(f.isSucceeded());
+    EXPECT_EQ(1, agent.requestsCount());
+
+    agent.setStatus(SnmpPrinterStatus::DeviceStatus::Warning, SnmpPrinterStatus::PrinterStatus::Idle,
+                    QByteArray::fromHex("08"));
+    f = printer.printRawData("some label");
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    ASSERT_TRUE(f.isFailed());
+    EXPECT_EQ(UtilsErrorCode::PrinterOffline, f.failureReason().errorCode);
+    EXPECT_EQ(0, tools.callsCount("lpq"));
+    EXPECT_EQ(1, tools.printedJobs().count());
+}
+
+TEST(LprPrinterTest, copies)
+{
+    FakeLprTools tools("FakeZebra");
+    LprPrinter printer("", "FakeZebra");
+    auto f = printer.printRawData("N\nP1\n", true, PrintPriority::Normal, 20);
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    EXPECT_TRUE(f.isSucceeded());
+    f = printer.printRawData("raw", true, PrintPriority::Normal, 3);
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    EXPECT_TRUE(f.isSucceeded());
+
+    auto printed = tools.printedJobs();
+    ASSERT_EQ(2, printed.count());
+    EXPECT_EQ("N\nP1,20\n", printed[0].data);
+    EXPECT_EQ("rawrawraw", printed[1].data);
+}
+
+TEST(LprPrinterTest, ignorePrinterState)
+{
+    FakeLprTools tools("FakeZebra");
+    tools.setPrinterState(FakeLprTools::PrinterState::Offline);
+    LprPrinter printer("", "FakeZebra");
+    auto f = printer.printRawData("some label", true);
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    EXPECT_TRUE(f.isSucceeded());
+    EXPECT_EQ(0, tools.callsCount("lpq"));
+    EXPECT_EQ(1, tools.printedJobs().count());
+}
+
+TEST(LprPrinterTest, printerNotReady)
+{
+    FakeLprTools tools("FakeZebra");
+    tools.setPrinterState(FakeLprTools::PrinterState::NotReady);
+    LprPrinter printer("", "FakeZebra");
+    auto f = printer.printRawData("some label");
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    ASSERT_TRUE(f.isFailed());
+    EXPECT_EQ(UtilsErrorCode::PrinterNotReady, f.failureReason().errorCode);
+    EXPECT_TRUE(tools.printedJobs().isEmpty());
+}
+
+TEST(LprPrinterTest, printerOffline)
+{
+    FakeLprTools tools("FakeZebra");
+    tools.setPrinterState(FakeLprTools::PrinterState::Offline);
+    LprPrinter printer("", "FakeZebra");
+    auto f = printer.printRawData("some label");
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    ASSERT_TRUE(f.isFailed());
+    EXPECT_EQ(UtilsErrorCode::PrinterOffline, f.failureReason().errorCode);
+    EXPECT_TRUE(tools.printedJobs().isEmpty());
+}
+
+TEST(LprPrinterTest, printerMissing)
+{
+    FakeLprTools tools("FakeZebra");
+    tools.setPrinterState(FakeLprTools::PrinterState::Missing);
+    LprPrinter printer("", "FakeZebra");
+    auto f = printer.printRawData("some label");
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    ASSERT_TRUE(f.isFailed());
+    EXPECT_EQ(UtilsErrorCode::PrinterInfoCannotBeQueried, f.failureReason().errorCode);
+}
+
+TEST(LprPrinterTest, lpqNotStarted)
+{
+    FakeLprTools tools("FakeZebra");
+    tools.setNotStarted("lpq");
+    {
+        LprPrinter printer("", "FakeZebra");
+        auto f = printer.printRawData("some label");
+        f.wait(5000);
+        ASSERT_TRUE(f.isCompleted());
+        EXPECT_TRUE(f.isSucceeded());
+        EXPECT_EQ(1, tools.callsCount("lpoptions"));
+    }
+    {
+        LprPrinter printer("", "FakeZebra", true);
+        auto f = printer.printRawData("some label");
+        f.wait(5000);
+        ASSERT_TRUE(f.isCompleted());
+        ASSERT_TRUE(f.isFailed());
+        EXPECT_EQ(UtilsErrorCode::LpqCannotBeStarted, f.failureReason().errorCode);
+    }
+}
+
+TEST(LprPrinterTest, lprNonZeroExit)
+{
+    FakeLprTools tools("FakeZebra");
+    tools.setExitCode("lpr", 1);
+    LprPrinter printer("", "FakeZebra");
+    auto f = printer.printRawData("some label");
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    ASSERT_TRUE(f.isFailed());
+    EXPECT_EQ(UtilsErrorCode::LprProcessNonZeroExitCode, f.failureReason().errorCode);
+}
+
+TEST(LprPrinterTest, cancelRunning)
+{
+    FakeLprTools tools("FakeZebra");
+    tools.setLatency(500);
+    LprPrinter printer("", "FakeZebra");
+    auto f = printer.printRawData("some label", true);
+    QThread::msleep(100);
+    f.cancel();
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    ASSERT_TRUE(f.isFailed());
+}
+
+TEST(LprPrinterTest, destroyedWithQueuedJobs)
+{
+    FakeLprTools tools("FakeZebra");
+    tools.setLatency(50);
+    QVector<CancelableFuture<bool>> futures;
+    {
+        LprPrinter printer("", "FakeZebra");
+        for (int i = 0; i < 3; ++i)
+            futures << printer.printRawData(QByteArray::number(i));
+    }
+    for (const auto &f : futures) {
+        f.wait(5000);
+        ASSERT_TRUE(f.isCompleted());
+        EXPECT_TRUE(f.isSucceeded());
+    }
+    EXPECT_EQ(3, tools.printedJobs().count());
+}
+
+TEST(LprPrinterTest, cancelCoalescedLabels)
+{
+    FakeLprTools tools("FakeZebra");
+    tools.setLatency(300);
+    LprPrinter printer("", "FakeZebra");
+    printer.setCoalescingEnabled(true);
+    printer.setCoalescingWindow(20);
+    auto running = printer.printRawData("first", true, PrintPriority::Interactive);
+    QVector<CancelableFuture<bool>> coalesced = {printer.printRawData("second", true),
+                                                 printer.printRawData("third", true)};
+    QThread::msleep(100);
+    ASSERT_EQ(1, printer.queuedJobsCount());
+    for (auto &f : coalesced)
+        f.cancel();
+    running.wait(5000);
+    ASSERT_TRUE(running.isSucceeded());
+    for (const auto &f : coalesced) {
+        f.wait(5000);
+        ASSERT_TRUE(f.isCompleted());
+        EXPECT_TRUE(f.isFailed());
+    }
+    EXPECT_EQ(0, printer.queuedJobsCount());
+    EXPECT_EQ(1, tools.printedJobs().count());
+}
+
+TEST(LprPrinterTest, coalescedLabelOverflow)
+{
+    FakeLprTools tools("FakeZebra");
+    tools.setLatency(200);
+    LprPrinter printer("", "FakeZebra");
+    printer.setCoalescingEnabled(true);
+    printer.setCoalescingWindow(1000);
+    printer.setMaxQueuedJobs(1);
+    auto running = printer.printRawData("first", true, PrintPriority::Interactive);
+    auto rejected = printer.printRawData("second", true);
+    ASSERT_TRUE(rejected.isCompleted());
+    ASSERT_TRUE(rejected.isFailed());
+    EXPECT_EQ(UtilsErrorCode::PrintQueueFull, rejected.failureReason().errorCode);
+    running.wait(5000);
+    EXPECT_TRUE(running.isSucceeded());
+}
+
+TEST(LprPrinterTest, printRawDataTracked)
+{
+    FakeLprTools tools("TrackedZebra");
+    tools.setQueuedPolls(2);
+    LprPrinter printer("", "TrackedZebra");
+    printer.setJobPollInterval(20);
+    auto f = printer.printRawDataTracked("some label", true);
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    ASSERT_TRUE(f.isSucceeded());
+    EXPECT_EQ("1001", f.result());
+    auto printed = tools.printedJobs();
+    ASSERT_EQ(1, printed.count());
+    EXPECT_FALSE(printed[0].title.isEmpty());
+    EXPECT_LE(3, tools.callsCount("lpq"));
+}
+
+TEST(LprPrinterTest, printRawDataTrackedLeftQueueBeforePoll)
+{
+    FakeLprTools tools("TrackedZebra");
+    LprPrinter printer("", "TrackedZebra");
+    printer.setJobPollInterval(20);
+    auto f = printer.printRawDataTracked("some label", true);
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    ASSERT_TRUE(f.isSucceeded());
+    EXPECT_EQ("1001", f.result());
+    EXPECT_EQ(1, tools.callsCount("lp"));
+    EXPECT_EQ(0, tools.callsCount("lpr"));
+}
+
+// Drives many concurrent submissions through ready checks, lanes and lpr with simulated tools latency
+TEST(LprPrinterTest, loadConcurrentPrintRawData)
+{
+    const int jobsCount = 300;
+    FakeLprTools tools("LoadZebra");
+    tools.setLatency(2);
+    LprPrinter printer("", "LoadZebra");
+    printer.setLaneCapacity(1);
+    printer.setReadinessCacheTime(0);
+
+    QElapsedTimer timer;
+    timer.start();
+    QVector<Future<bool>> results;
+    results.reserve(jobsCount);
+    for (int i = 0; i < jobsCount; ++i)
+        results << printer.printRawData(QByteArray::number(i));
+
+    for (const auto &f : qAsConst(results)) {
+        f.wait(30000);
+        ASSERT_TRUE(f.isCompleted());
+        ASSERT_TRUE(f.isSucceeded());
+    }
+    qint64 elapsed = timer.elapsed();
+
+    // Each job takes lpq, lpoptions and lpr with 2ms latency each, jobs of one lane are strictly ordered
+    auto printed = tools.printedJobs();
+    ASSERT_EQ(jobsCount, printed.count());
+    for (int i = 0; i < jobsCount; ++i)
+        EXPECT_EQ(QByteArray::number(i), printed[i].data);
+    EXPECT_EQ(jobsCount, tools.callsCount("lpq"));
+    EXPECT_EQ(jobsCount, tools.callsCount("lpoptions"));
+    EXPECT_LE(jobsCount * 6, elapsed);
+    EXPECT_EQ(0, printer.queuedJobsCount());
+    EXPECT_EQ(0, printer.runningJobsCount());
+}
+
+TEST(LprPrinterTest, loadParallelLane)
+{
+    const int jobsCount = 300;
+    FakeLprTools tools("ParallelZebra");
+    tools.setLatency(2);
+    LprPrinter printer("", "ParallelZebra");
+    printer.setLaneCapacity(4);
+
+    QVector<Future<bool>> results;
+    for (int i = 0; i < jobsCount; ++i)
+        results << printer.printRawData(QByteArray::number(i), true, PrintPriority::Bulk);
+    for (const auto &f : qAsConst(results)) {
+        f.wait(30000);
+        ASSERT_TRUE(f.isCompleted());
+        ASSERT_TRUE(f.isSucceeded());
+    }
+    EXPECT_EQ(jobsCount, tools.printedJobs().count());
+    EXPECT_EQ(0, tools.callsCount("lpq"));
+}
@@ -0,0 +1,106 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+// clazy:skip
+
+#include "proofutils/printcapture.h"
+
+#include "gtest/proof/test_global.h"
+
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+
+using namespace Proof;
+
+TEST(PrintCaptureTest, modeFromString)
+{
+    EXPECT_EQ(PrintCapture::Mode::File, PrintCapture::modeFromString("file"));
+    EXPECT_EQ(PrintCapture::Mode::Directory, PrintCapture::modeFromString(" Directory"));
+    EXPECT_EQ(PrintCapture::Mode::Memory, PrintCapture::modeFromString("memory"));
+    EXPECT_EQ(PrintCapture::Mode::Discard, PrintCapture::modeFromString("discard"));
+    EXPECT_EQ(PrintCapture::Mode::None, PrintCapture::modeFromString("printer"));
+    EXPECT_FALSE(PrintCapture::create(PrintCapture::Mode::None));
+}
+
+TEST(PrintCaptureTest, file)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    QString fileName = dir.filePath("capture.prn");
+    auto capture = PrintCapture::create(PrintCapture::Mode::File, fileName);
+    ASSERT_TRUE(capture);
+    EXPECT_TRUE(capture->write("first\n"));
+    EXPECT_TRUE(capture->write("second\n"));
+    QFile file(fileName);
+    ASSERT_TRUE(file.open(QIODevice::ReadOnly));
+    EXPECT_EQ("first\nsecond\n", file.readAll());
+    EXPECT_EQ(2u, capture->jobsCount());
+    EXPECT_EQ(13, capture->bytesCount());
+    EXPECT_FALSE(PrintCapture::create(PrintCapture::Mode::File, QString()));
+}
+
+TEST(PrintCaptureTest, directory)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    auto capture = PrintCapture::create(PrintCapture::Mode::Directory, dir.filePath("labels"));
+    ASSERT_TRUE(capture);
+    for (int i = 0; i < 3; ++i)
+        EXPECT_TRUE(capture->write(QByteArray::number(i)));
+    QStringList files = QDir(dir.filePath("labels")).entryList(QDir::Files, QDir::Name);
+    ASSERT_EQ(3, files.count());
+    QFile file(dir.filePath("labels/" + files.last()));
+    ASSERT_TRUE(file.open(QIODevice::ReadOnly));
+    EXPECT_EQ("2", file.readAll());
+}
+
+TEST(PrintCaptureTest, memoryRing)
+{
+    auto capture = PrintCapture::create(PrintCapture::Mode::Memory, QString(), 3);
+    ASSERT_TRUE(capture);
+    for (int i = 0; i < 5; ++i)
+        EXPECT_TRUE(capture->write(QByteArray::number(i)));
+    auto records = capture->records();
+    ASSERT_EQ(3, records.count());
+    EXPECT_EQ(3u, records[0].sequence);
+    EXPECT_EQ("2", records[0].data);
+    EXPECT_EQ("4", records[2].data);
+    EXPECT_LE(records[0].submittedAtNsecs, records[2].submittedAtNsecs);
+    EXPECT_EQ(5u, capture->jobsCount());
+    capture->reset();
+    EXPECT_EQ(0u, capture->jobsCount());
+    EXPECT_TRUE(capture->records().isEmpty());
+}
+
+TEST(PrintCaptureTest, discard)
+{
+    auto capture = PrintCapture::create(PrintCapture::Mode::Discard);
+    ASSERT_TRUE(capture);
+    EXPECT_TRUE(capture->write("label"));
+    auto records = capture->records();
+    ASSERT_EQ(1, records.count());
+    EXPECT_EQ(5, records[0].size);
+    EXPECT_TRUE(records[0].data.isEmpty());
+}
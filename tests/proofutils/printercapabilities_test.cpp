@@ -0,0 +1,83 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+// clazy:skip
+
+#include "proofutils/printercapabilities.h"
+
+#include "proofnetwork/lprprinter/ippapi.h"
+
+#include "gtest/proof/test_global.h"
+
+using namespace Proof;
+using namespace Proof::NetworkServices;
+
+TEST(PrinterCapabilitiesTest, fromIpp)
+{
+    IppPrinterCapabilities ippCapabilities;
+    ippCapabilities.makeAndModel = "Zebra GK420d";
+    ippCapabilities.resolution = 203;
+    ippCapabilities.mediaWidth = 10160;
+    ippCapabilities.mediaLength = 15240;
+    ippCapabilities.documentFormats = {"application/octet-stream", "application/vnd.cups-raw"};
+
+    PrinterCapabilities capabilities = PrinterCapabilities::fromIpp(ippCapabilities);
+    EXPECT_EQ("Zebra GK420d", capabilities.makeAndModel);
+    EXPECT_EQ(203, capabilities.dpi);
+    EXPECT_EQ(812, capabilities.printWidth);
+    EXPECT_EQ(1218, capabilities.labelLength);
+    EXPECT_TRUE(capabilities.rawSupported);
+    EXPECT_TRUE(capabilities.nativeQrCode);
+
+    EplLabelProfile profile = capabilities.labelProfile();
+    EXPECT_EQ(203, profile.dpi);
+    EXPECT_EQ(812, profile.width);
+    EXPECT_EQ(1218, profile.height);
+    EXPECT_EQ(24, profile.gapLength);
+    EXPECT_TRUE(profile.nativeQrCode);
+}
+
+TEST(PrinterCapabilitiesTest, partialCapabilities)
+{
+    IppPrinterCapabilities ippCapabilities;
+    ippCapabilities.makeAndModel = "Zebra LP2844";
+    ippCapabilities.resolution = 305;
+    ippCapabilities.documentFormats = {"application/pdf"};
+
+    PrinterCapabilities capabilities = PrinterCapabilities::fromIpp(ippCapabilities);
+    EXPECT_EQ(0, capabilities.printWidth);
+    EXPECT_FALSE(capabilities.rawSupported);
+    EXPECT_FALSE(capabilities.nativeQrCode);
+
+    EplLabelProfile profile = capabilities.labelProfile();
+    EXPECT_EQ(300, profile.dpi);
+    EXPECT_EQ(795 * 300 / 203, profile.width);
+    EXPECT_EQ(1250 * 300 / 203, profile.height);
+    EXPECT_EQ(24 * 300 / 203, profile.gapLength);
+
+    EplLabelProfile defaultProfile = PrinterCapabilities().labelProfile();
+    EXPECT_EQ(203, defaultProfile.dpi);
+    EXPECT_EQ(795, defaultProfile.width);
+    EXPECT_EQ(1250, defaultProfile.height);
+}
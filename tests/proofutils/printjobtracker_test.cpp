@@ -0,0 +1,116 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+// clazy:skip
+
+#include "proofutils/printjobtracker_p.h"
+
+#include "gtest/proof/test_global.h"
+
+#include "fakelprtools.h"
+
+#include <QSet>
+
+using namespace Proof;
+
+TEST(PrintJobTrackerTest, sharedPerPrinter)
+{
+    auto tracker = PrintJobTracker::forPrinter("127.0.0.1", "Zebra");
+    auto sameTracker = PrintJobTracker::forPrinter(" 127.0.0.1", "zebra ");
+    auto otherTracker = PrintJobTracker::forPrinter("127.0.0.1", "Zebra2");
+    EXPECT_EQ(tracker, sameTracker);
+    EXPECT_NE(tracker, otherTracker);
+    EXPECT_EQ(0, tracker->trackedCount());
+}
+
+TEST(PrintJobTrackerTest, uniqueJobTitle)
+{
+    QSet<QString> titles;
+    for (int i = 0; i < 100; ++i) {
+        QString title = PrintJobTracker::uniqueJobTitle();
+        EXPECT_GE(29, title.length());
+        EXPECT_FALSE(title.contains(' '));
+        titles << title;
+    }
+    EXPECT_EQ(100, titles.count());
+}
+
+TEST(PrintJobTrackerTest, parseCupsQueue)
+{
+    QString queueInfo = "Zebra is ready and printing\n"
+                        "Rank    Owner   Job     File(s)                         Total Size\n"
+                        "active  proof   1033    proof-12-1                      1024 bytes\n"
+                        "1st     proof   1034    proof-12-2                      2048 bytes\n";
+    auto found = PrintJobTracker::parseQueue(queueInfo, {"proof-12-1", "proof-12-2", "proof-12-3"});
+    ASSERT_EQ(2, found.count());
+    EXPECT_EQ("1033", found["proof-12-1"]);
+    EXPECT_EQ("1034", found["proof-12-2"]);
+    EXPECT_FALSE(found.contains("proof-12-3"));
+}
+
+TEST(PrintJobTrackerTest, parseWindowsQueue)
+{
+    QString queueInfo = "Windows LPD Server\n"
+                        "Printer Zebra\n\n"
+                        "Owner       Status         Jobname              Job-Id    Size   Pages  Priority\n"
+                        "----------------------------------------------------------------------------\n"
+                        "proof       Printing       proof-7-15           12        1024   0      1\n"
+                        "proof       Waiting        proof-7-16           13        1024   0      1\n";
+    auto found = PrintJobTracker::parseQueue(queueInfo, {"proof-7-15", "proof-7-16", "proof-7-1"});
+    ASSERT_EQ(2, found.count());
+    EXPECT_EQ("12", found["proof-7-15"]);
+    EXPECT_EQ("13", found["proof-7-16"]);
+}
+
+TEST(PrintJobTrackerTest, parseEmptyQueue)
+{
+    auto found = PrintJobTracker::parseQueue("Zebra is ready\nno entries\n", {"proof-1-1"});
+    EXPECT_TRUE(found.isEmpty());
+}
+
+TEST(PrintJobTrackerTest, parseRequestId)
+{
+    EXPECT_EQ("1033", PrintJobTracker::parseRequestId("request id is Zebra-1033 (0 file(s))\n"));
+    EXPECT_EQ("7", PrintJobTracker::parseRequestId("request id is Zebra-GK420-7 (1 file(s))"));
+    EXPECT_TRUE(PrintJobTracker::parseRequestId("").isEmpty());
+    EXPECT_TRUE(PrintJobTracker::parseRequestId("lp: Error - unable to access \"label\"").isEmpty());
+}
+
+TEST(PrintJobTrackerTest, jobWithoutIdLeftQueue)
+{
+    FakeLprTools tools("LostZebra");
+    auto tracker = PrintJobTracker::forPrinter("", "LostZebra");
+    tracker->setQueueCommand("lpq", {"-P", "LostZebra"});
+    tracker->setPollInterval(10);
+    auto lost = tracker->track(PrintJobTracker::uniqueJobTitle());
+    auto known = tracker->track(PrintJobTracker::uniqueJobTitle(), "1042");
+    for (const auto &f : {lost, known})
+        f.wait(5000);
+    ASSERT_TRUE(lost.isCompleted());
+    ASSERT_TRUE(lost.isFailed());
+    EXPECT_EQ(UtilsErrorCode::PrintJobStateUnknown, lost.failureReason().errorCode);
+    ASSERT_TRUE(known.isCompleted());
+    ASSERT_TRUE(known.isSucceeded());
+    EXPECT_EQ("1042", known.result());
+}
@@ -0,0 +1,305 @@
+// clazy:skip
+
+#include "proofutils/printlane_p.h"
+
+#include "gtest/proof/test_global.h"
+
+#include <QThread>
+
+using namespace Proof;
+
+TEST(PrintLaneTest, sharedPerPrinter)
+{
+    auto lane = PrintLane::forPrinter("127.0.0.1", "Zebra");
+    auto sameLane = PrintLane::forPrinter(" 127.0.0.1", "zebra ");
+    auto otherLane = PrintLane::forPrinter("127.0.0.1", "Zebra2");
+    EXPECT_EQ(lane, sameLane);
+    EXPECT_NE(lane, otherLane);
+    EXPECT_EQ(1, lane->capacity());
+}
+
+TEST(PrintLaneTest, strictOrdering)
+{
+    auto lane = PrintLane::forPrinter("127.0.0.1", "orderingPrinter");
+    QVector<Promise<bool>> promises(3);
+    QVector<Future<bool>> results;
+    for (int i = 0; i < promises.count(); ++i) {
+        Promise<bool> promise = promises[i];
+        results << lane->enqueue([promise] { return promise.future(); });
+    }
+    EXPECT_EQ(1, lane->runningCount());
+    EXPECT_EQ(2, lane->queuedCount());
+
+    promises[0].success(true);
+    results[0].wait(1000);
+    ASSERT_TRUE(results[0].isCompleted());
+    EXPECT_TRUE(results[0].result());
+    EXPECT_FALSE(results[1].isCompleted());
+    EXPECT_EQ(1, lane->runningCount());
+    EXPECT_EQ(1, lane->queuedCount());
+
+    promises[1].failure(Failure("failed", UTILS_MODULE_CODE, UtilsErrorCode::LabelPrinterError));
+    results[1].wait(1000);
+    ASSERT_TRUE(results[1].isCompleted());
+    EXPECT_TRUE(results[1].isFailed());
+    EXPECT_EQ("failed", results[1].failureReason().message);
+
+    promises[2].success(true);
+    results[2].wait(1000);
+    ASSERT_TRUE(results[2].isCompleted());
+    EXPECT_EQ(0, lane->runningCount());
+    EXPECT_EQ(0, lane->queuedCount());
+}
+
+TEST(PrintLaneTest, differentPrintersInParallel)
+{
+    auto first = PrintLane::forPrinter("127.0.0.1", "parallelPrinter1");
+    auto second = PrintLane::forPrinter("127.0.0.1", "parallelPrinter2");
+    Promise<bool> firstPromise;
+    Promise<bool> secondPromise;
+    auto firstResult = first->enqueue([firstPromise] { return firstPromise.future(); });
+    auto secondResult = second->enqueue([secondPromise] { return secondPromise.future(); });
+    EXPECT_EQ(1, first->runningCount());
+    EXPECT_EQ(1, second->runningCount());
+    secondPromise.success(true);
+    secondResult.wait(1000);
+    ASSERT_TRUE(secondResult.isCompleted());
+    EXPECT_FALSE(firstResult.isCompleted());
+    firstPromise.success(true);
+    firstResult.wait(1000);
+    ASSERT_TRUE(firstResult.isCompleted());
+}
+
+TEST(PrintLaneTest, capacity)
+{
+    auto lane = PrintLane::forPrinter("127.0.0.1", "capacityPrinter");
+    lane->setCapacity(2);
+    EXPECT_EQ(2, lane->capacity());
+    QVector<Promise<bool>> promises(3);
+    QVector<Future<bool>> results;
+    for (int i = 0; i < promises.count(); ++i) {
+        Promise<bool> promise = promises[i];
+        results << lane->enqueue([promise] { return promise.future(); });
+    }
+    EXPECT_EQ(2, lane->runningCount());
+    EXPECT_EQ(1, lane->queuedCount());
+    for (auto &promise : promises)
+        promise.success(true);
+    for (const auto &result : results) {
+        result.wait(1000);
+        ASSERT_TRUE(result.isCompleted());
+    }
+    lane->setCapacity(0);
+    EXPECT_EQ(1, lane->capacity());
+}
+
+TEST(PrintLaneTest, priorities)
+{
+    auto lane = PrintLane::forPrinter("127.0.0.1", "priorityPrinter");
+    lane->setAgingInterval(0);
+    Promise<bool> blocker;
+    auto blockerResult = lane->enqueue([blocker] { return blocker.future(); });
+
+    QStringList started;
+    auto job = [&started](const QString &name) {
+        return [&started, name] {
+            started << name;
+            return Future<bool>::successful(true);
+        };
+    };
+    QVector<Future<bool>> results;
+    results << lane->enqueue(job("bulk1"), PrintPriority::Bulk);
+    results << lane->enqueue(job("normal1"));
+    results << lane->enqueue(job("bulk2"), PrintPriority::Bulk);
+    results << lane->enqueue(job("interactive1"), PrintPriority::Interactive);
+    results << lane->enqueue(job("normal2"), PrintPriority::Normal);
+    results << lane->enqueue(job("interactive2"), PrintPriority::Interactive);
+    EXPECT_EQ(6, lane->queuedCount());
+    EXPECT_EQ(2, lane->queuedCount(PrintPriority::Interactive));
+    EXPECT_EQ(2, lane->queuedCount(PrintPriority::Normal));
+    EXPECT_EQ(2, lane->queuedCount(PrintPriority::Bulk));
+
+    blocker.success(true);
+    for (const auto &result : qAsConst(results)) {
+        result.wait(1000);
+        ASSERT_TRUE(result.isCompleted());
+    }
+    EXPECT_EQ(QStringList({"interactive1", "interactive2", "normal1", "normal2", "bulk1", "bulk2"}), started);
+}
+
+TEST(PrintLaneTest, priorityAging)
+{
+    auto lane = PrintLane::forPrinter("127.0.0.1", "agingPrinter");
+    lane->setAgingInterval(10);
+    EXPECT_EQ(10, lane->agingInterval());
+    Promise<bool> blocker;
+    auto blockerResult = lane->enqueue([blocker] { return blocker.future(); });
+
+    QStringList started;
+    auto bulk = lane->enqueue(
+        [&started] {
+            started << "bulk";
+            return Future<bool>::successful(true);
+        },
+        PrintPriority::Bulk);
+    QThread::msleep(100);
+    auto interactive = lane->enqueue(
+        [&started] {
+            started << "interactive";
+            return Future<bool>::successful(true);
+        },
+        PrintPriority::Interactive);
+
+    blocker.success(true);
+    bulk.wait(1000);
+    interactive.wait(1000);
+    ASSERT_TRUE(bulk.isCompleted());
+    ASSERT_TRUE(interactive.isCompleted());
+    EXPECT_EQ(QStringList({"bulk", "interactive"}), started);
+}
+
+TEST(PrintLaneTest, overflowReject)
+{
+    auto lane = PrintLane::forPrinter("127.0.0.1", "rejectingPrinter");
+    lane->setMaxJobs(2);
+    lane->setMaxBytes(100);
+    EXPECT_EQ(PrintQueueOverflowPolicy::Reject, lane->overflowPolicy());
+    int notifications = 0;
+    int observerId = lane->addObserver([&notifications] { ++notifications; });
+
+    Promise<bool> first;
+    auto firstResult = lane->enqueue([first] { return first.future(); }, PrintPriority::Normal, 60);
+    EXPECT_EQ(1, lane->availableJobs());
+    EXPECT_EQ(40, lane->availableBytes());
+    auto tooBig = lane->enqueue([] { return Future<bool>::successful(true); }, PrintPriority::Normal, 50);
+    ASSERT_TRUE(tooBig.isCompleted());
+    EXPECT_TRUE(tooBig.isFailed());
+    EXPECT_EQ(UtilsErrorCode::PrintQueueFull, tooBig.failureReason().errorCode);
+
+    Promise<bool> second;
+    auto secondResult = lane->enqueue([second] { return second.future(); }, PrintPriority::Normal, 40);
+    EXPECT_EQ(0, lane->availableJobs());
+    EXPECT_EQ(100, lane->bytesCount());
+    auto tooMany = lane->enqueue([] { return Future<bool>::successful(true); });
+    ASSERT_TRUE(tooMany.isCompleted());
+    EXPECT_TRUE(tooMany.isFailed());
+
+    first.success(true);
+    second.success(true);
+    secondResult.wait(1000);
+    ASSERT_TRUE(secondResult.isCompleted());
+    EXPECT_EQ(0, lane->bytesCount());
+    EXPECT_EQ(2, lane->availableJobs());
+    EXPECT_LT(0, notifications);
+    lane->removeObserver(observerId);
+    lane->setMaxJobs(0);
+    lane->setMaxBytes(0);
+    EXPECT_EQ(-1, lane->availableJobs());
+    EXPECT_EQ(-1, lane->availableBytes());
+}
+
+TEST(PrintLaneTest, overflowBlock)
+{
+    auto lane = PrintLane::forPrinter("127.0.0.1", "blockingPrinter");
+    lane->setMaxJobs(1);
+    lane->setOverflowPolicy(PrintQueueOverflowPolicy::Block);
+
+    Promise<bool> first;
+    auto firstResult = lane->enqueue([first] { return first.future(); });
+    bool secondStarted = false;
+    auto secondResult = lane->enqueue([&secondStarted] {
+        secondStarted = true;
+        return Future<bool>::successful(true);
+    });
+    EXPECT_FALSE(secondResult.isCompleted());
+    EXPECT_EQ(1, lane->blockedCount());
+    EXPECT_EQ(0, lane->queuedCount());
+
+    first.success(true);
+    secondResult.wait(1000);
+    ASSERT_TRUE(secondResult.isCompleted());
+    EXPECT_TRUE(secondResult.result());
+    EXPECT_TRUE(secondStarted);
+    EXPECT_EQ(0, lane->blockedCount());
+}
+
+TEST(PrintLaneTest, overflowDropOldest)
+{
+    auto lane = PrintLane::forPrinter("127.0.0.1", "droppingPrinter");
+    lane->setMaxJobs(3);
+    lane->setOverflowPolicy(PrintQueueOverflowPolicy::DropOldest);
+
+    Promise<bool> running;
+    auto runningResult = lane->enqueue([running] { return running.future(); });
+    auto oldest = lane->enqueue([] { return Future<bool>::successful(true); }, PrintPriority::Bulk);
+    auto older = lane->enqueue([] { return Future<bool>::successful(true); });
+    auto newest = lane->enqueue([] { return Future<bool>::successful(true); }, PrintPriority::Interactive);
+
+    ASSERT_TRUE(oldest.isCompleted());
+    EXPECT_TRUE(oldest.isFailed());
+    EXPECT_EQ(UtilsErrorCode::PrintJobDropped, oldest.failureReason().errorCode);
+    EXPECT_FALSE(older.isCompleted());
+    EXPECT_FALSE(runningResult.isCompleted());
+    EXPECT_EQ(2, lane->queuedCount());
+
+    running.success(true);
+    newest.wait(1000);
+    older.wait(1000);
+    ASSERT_TRUE(newest.isCompleted());
+    ASSERT_TRUE(older.isCompleted());
+    EXPECT_TRUE(older.result());
+}
+
+TEST(PrintLaneTest, cancelQueued)
+{
+    auto lane = PrintLane::forPrinter("127.0.0.1", "cancelingPrinter");
+    lane->setMaxJobs(2);
+    Promise<bool> running;
+    auto runningResult = lane->enqueue([running] { return running.future(); }, PrintPriority::Normal, 10);
+    bool queuedStarted = false;
+    auto queued = lane->enqueue(
+        [&queuedStarted] {
+            queuedStarted = true;
+            return Future<bool>::successful(true);
+        },
+        PrintPriority::Normal, 20);
+    EXPECT_EQ(1, lane->queuedCount());
+    EXPECT_EQ(30, lane->bytesCount());
+    EXPECT_EQ(0, lane->availableJobs());
+
+    queued.cancel();
+    queued.wait(1000);
+    ASSERT_TRUE(queued.isCompleted());
+    EXPECT_TRUE(queued.isFailed());
+    EXPECT_EQ(0, lane->queuedCount());
+    EXPECT_EQ(10, lane->bytesCount());
+    EXPECT_EQ(1, lane->availableJobs());
+
+    running.success(true);
+    runningResult.wait(1000);
+    ASSERT_TRUE(runningResult.isCompleted());
+    EXPECT_FALSE(queuedStarted);
+    EXPECT_EQ(0, lane->bytesCount());
+    lane->setMaxJobs(0);
+}
+
+TEST(PrintLaneTest, cancelRunning)
+{
+    auto lane = PrintLane::forPrinter("127.0.0.1", "cancelingRunningPrinter");
+    Promise<bool> running;
+    bool jobCanceled = false;
+    auto result = lane->enqueue([running, &jobCanceled](const Future<bool> &canceled) {
+        canceled.onFailure([running, &jobCanceled](const Failure &) {
+            jobCanceled = true;
+            running.failure(Failure("killed", UTILS_MODULE_CODE, UtilsErrorCode::PrintJobCanceled));
+        });
+        return running.future();
+    });
+    EXPECT_EQ(1, lane->runningCount());
+    result.cancel();
+    result.wait(1000);
+    ASSERT_TRUE(result.isCompleted());
+    EXPECT_TRUE(result.isFailed());
+    EXPECT_TRUE(jobCanceled);
+    EXPECT_EQ(0, lane->runningCount());
+}
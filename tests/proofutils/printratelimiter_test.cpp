@@ -0,0 +1,103 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+// clazy:skip
+
+#include "proofutils/printratelimiter_p.h"
+
+#include "gtest/proof/test_global.h"
+
+using namespace Proof;
+
+TEST(PrintRateLimiterTest, labelsCount)
+{
+    EXPECT_EQ(1, PrintRateLimiter::labelsCount(""));
+    EXPECT_EQ(1, PrintRateLimiter::labelsCount("N\nA10,10,0,4,1,1,N,\"P1\"\nP1\n"));
+    EXPECT_EQ(3, PrintRateLimiter::labelsCount("N\nP1\nN\nP2\n"));
+    EXPECT_EQ(6, PrintRateLimiter::labelsCount("N\nP3,2\n"));
+    EXPECT_EQ(4, PrintRateLimiter::labelsCount("N\r\nP4\r\n"));
+    EXPECT_EQ(2, PrintRateLimiter::labelsCount("N\nGW0,0,1,4,\nP9\n\nP2\n"));
+}
+
+TEST(PrintRateLimiterTest, disabled)
+{
+    auto limiter = PrintRateLimiterSP::create();
+    EXPECT_FALSE(limiter->isEnabled());
+    for (int i = 0; i < 10; ++i)
+        EXPECT_EQ(0, limiter->reserve(100));
+    Future<bool> acquired = limiter->acquire(100, Promise<bool>().future());
+    ASSERT_TRUE(acquired.isCompleted());
+    EXPECT_TRUE(acquired.result());
+}
+
+TEST(PrintRateLimiterTest, pacing)
+{
+    auto limiter = PrintRateLimiterSP::create(10.0, 2);
+    EXPECT_TRUE(limiter->isEnabled());
+    EXPECT_EQ(0, limiter->reserve(1));
+    EXPECT_EQ(0, limiter->reserve(1));
+    EXPECT_NEAR(100, limiter->reserve(1), 20);
+    EXPECT_NEAR(300, limiter->reserve(2), 20);
+    limiter->setRate(10.0, 2);
+    EXPECT_EQ(0, limiter->reserve(1));
+}
+
+TEST(PrintRateLimiterTest, jobBiggerThanBurst)
+{
+    auto limiter = PrintRateLimiterSP::create(10.0, 2);
+    EXPECT_EQ(0, limiter->reserve(5));
+    EXPECT_NEAR(400, limiter->reserve(1), 20);
+}
+
+TEST(PrintRateLimiterTest, release)
+{
+    auto limiter = PrintRateLimiterSP::create(10.0, 1);
+    EXPECT_EQ(0, limiter->reserve(1));
+    limiter->release(1);
+    EXPECT_EQ(0, limiter->reserve(1));
+}
+
+TEST(PrintRateLimiterTest, acquire)
+{
+    auto limiter = PrintRateLimiterSP::create(20.0, 1);
+    EXPECT_EQ(0, limiter->reserve(1));
+    Future<bool> acquired = limiter->acquire(1, Promise<bool>().future());
+    EXPECT_FALSE(acquired.isCompleted());
+    acquired.wait(1000);
+    ASSERT_TRUE(acquired.isCompleted());
+    EXPECT_TRUE(acquired.result());
+}
+
+TEST(PrintRateLimiterTest, acquireCanceled)
+{
+    auto limiter = PrintRateLimiterSP::create(20.0, 1);
+    EXPECT_EQ(0, limiter->reserve(1));
+    Promise<bool> canceled;
+    Future<bool> acquired = limiter->acquire(1, canceled.future());
+    canceled.failure(Failure("canceled", 0, 0));
+    acquired.wait(1000);
+    ASSERT_TRUE(acquired.isCompleted());
+    ASSERT_TRUE(acquired.isFailed());
+    EXPECT_EQ(UtilsErrorCode::PrintJobCanceled, acquired.failureReason().errorCode);
+}
@@ -0,0 +1,335 @@
+// clazy:skip
+
+#include "proofutils/printspool.h"
+
+#include "gtest/proof/test_global.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QMap>
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QTemporaryDir>
+
+#include <cstdio>
+
+using namespace Proof;
+
+namespace {
+QVector<quint64> appendLabels(const PrintSpoolSP &spool, const QVector<QByteArray> &labels)
+{
+    QVector<quint64> result;
+    for (const auto &label : labels) {
+        auto future = spool->append(label);
+        future.wait(5000);
+        EXPECT_TRUE(future.isCompleted());
+        EXPECT_TRUE(future.isSucceeded());
+        result << future.result();
+    }
+    return result;
+}
+
+// Copies journal as it is on disk at the moment, as if process was killed right now
+QString crashCopy(const PrintSpoolSP &spool, const QString &targetName)
+{
+    QFile::remove(targetName);
+    EXPECT_TRUE(QFile::copy(spool->fileName(), targetName));
+    return targetName;
+}
+} // namespace
+
+TEST(PrintSpoolTest, pendingEntriesSurviveCrash)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    auto spool = PrintSpool::open(dir.filePath("labels.spool"));
+    ASSERT_TRUE(spool);
+    EXPECT_EQ(0, spool->pendingCount());
+
+    auto sequences = appendLabels(spool, {"first label", "second label", "third label"});
+    ASSERT_EQ(3, sequences.count());
+    EXPECT_LT(sequences[0], sequences[1]);
+    EXPECT_LT(sequences[1], sequences[2]);
+    spool->markDone(sequences[1]);
+    EXPECT_EQ(2, spool->pendingCount());
+
+    auto restored = PrintSpool::open(crashCopy(spool, dir.filePath("crashed.spool")));
+    ASSERT_TRUE(restored);
+    auto entries = restored->pendingEntries();
+    ASSERT_EQ(2, entries.count());
+    EXPECT_EQ(sequences[0], entries[0].sequence);
+    EXPECT_EQ("first label", entries[0].data);
+    EXPECT_EQ(sequences[2], entries[1].sequence);
+    EXPECT_EQ("third label", entries[1].data);
+
+    auto next = restored->append("fourth label");
+    next.wait(5000);
+    ASSERT_TRUE(next.isCompleted());
+    EXPECT_GT(next.result(), sequences[2]);
+}
+
+// Runs as separate process started by writerKilledDuringAppend, appends labels until it is killed
+TEST(PrintSpoolTest, crashWriter)
+{
+    QString fileName = QString::fromLocal8Bit(qgetenv("PROOF_PRINT_SPOOL_WRITER"));
+    if (fileName.isEmpty())
+        return;
+    auto spool = PrintSpool::open(fileName);
+    ASSERT_TRUE(spool);
+    for (int i = 1;; ++i) {
+        auto future = spool->append(QByteArray("label ").append(QByteArray::number(i)));
+        future.wait();
+        ASSERT_TRUE(future.isSucceeded());
+        // Odd labels are reported as durable, even ones are marked done, which is not synced
+        if (i % 2) {
+            printf("synced %llu\n", static_cast<unsigned long long>(future.result()));
+            fflush(stdout);
+        } else {
+            spool->markDone(future.result());
+        }
+        // Next append is not waited for, so process is killed with unsynced records too
+        spool->append(QByteArray("unsynced ").append(QByteArray::number(i)));
+    }
+}
+
+TEST(PrintSpoolTest, writerKilledDuringAppend)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    QString fileName = dir.filePath("labels.spool");
+
+    QProcess writer;
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    environment.insert(QStringLiteral("PROOF_PRINT_SPOOL_WRITER"), fileName);
+    writer.setProcessEnvironment(environment);
+    writer.start(QCoreApplication::applicationFilePath(),
+                 {QStringLiteral("--gtest_filter=PrintSpoolTest.crashWriter")});
+    ASSERT_TRUE(writer.waitForStarted(5000));
+
+    QVector<quint64> synced;
+    while (synced.count() < 50 && writer.state() == QProcess::Running) {
+        if (!writer.canReadLine() && !writer.waitForReadyRead(5000))
+            break;
+        while (writer.canReadLine()) {
+            QByteArray line = writer.readLine().trimmed();
+            if (line.startsWith("synced "))
+                synced << line.mid(7).toULongLong();
+        }
+    }
+    // SIGKILL, spool gets no chance to finish anything
+    writer.kill();
+    ASSERT_TRUE(writer.waitForFinished(5000));
+    ASSERT_LE(50, synced.count());
+
+    auto restored = PrintSpool::open(fileName);
+    ASSERT_TRUE(restored);
+    QMap<quint64, QByteArray> entries;
+    const auto pendingEntries = restored->pendingEntries();
+    for (const auto &entry : pendingEntries)
+        entries[entry.sequence] = entry.data;
+    for (quint64 sequence : qAsConst(synced))
+        EXPECT_TRUE(entries.contains(sequence)) << sequence;
+    for (auto it = entries.cbegin(); it != entries.cend(); ++it)
+        EXPECT_TRUE(it.value().startsWith("label ") || it.value().startsWith("unsynced ")) << it.value().constData();
+
+    auto next = restored->append("after crash");
+    next.wait(5000);
+    ASSERT_TRUE(next.isSucceeded());
+    EXPECT_GT(next.result(), synced.last());
+}
+
+TEST(PrintSpoolTest, tornRecordIsIgnored)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    auto spool = PrintSpool::open(dir.filePath("labels.spool"));
+    ASSERT_TRUE(spool);
+    appendLabels(spool, {"complete label", "torn label"});
+    QString crashed = crashCopy(spool, dir.filePath("crashed.spool"));
+    spool.reset();
+
+    QFile file(crashed);
+    ASSERT_TRUE(file.open(QIODevice::ReadWrite));
+    QByteArray content = file.readAll();
+    int tornOffset = content.indexOf("torn label");
+    ASSERT_NE(-1, tornOffset);
+    file.seek(tornOffset);
+    file.write("TORN");
+    file.close();
+
+    auto restored = PrintSpool::open(crashed);
+    ASSERT_TRUE(restored);
+    auto entries = restored->pendingEntries();
+    ASSERT_EQ(1, entries.count());
+    EXPECT_EQ("complete label", entries[0].data);
+}
+
+TEST(PrintSpoolTest, unknownFileIsNotTouched)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    QFile file(dir.filePath("foreign.spool"));
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write("definitely not a print spool");
+    file.close();
+
+    EXPECT_FALSE(PrintSpool::open(file.fileName()));
+    ASSERT_TRUE(file.open(QIODevice::ReadOnly));
+    EXPECT_EQ("definitely not a print spool", file.readAll());
+}
+
+TEST(PrintSpoolTest, compaction)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    auto spool = PrintSpool::open(dir.filePath("labels.spool"));
+    ASSERT_TRUE(spool);
+
+    QVector<QByteArray> labels;
+    for (int i = 0; i < 40; ++i)
+        labels << QByteArray(64 * 1024, 'a' + static_cast<char>(i % 26));
+    auto sequences = appendLabels(spool, labels);
+    qint64 grownSize = QFileInfo(spool->fileName()).size();
+    EXPECT_GT(grownSize, 40 * 64 * 1024);
+
+    for (int i = 0; i < sequences.count() - 1; ++i)
+        spool->markDone(sequences[i]);
+    EXPECT_EQ(1, spool->pendingCount());
+    EXPECT_LT(QFileInfo(spool->fileName()).size(), grownSize);
+
+    auto restored = PrintSpool::open(crashCopy(spool, dir.filePath("crashed.spool")));
+    ASSERT_TRUE(restored);
+    auto entries = restored->pendingEntries();
+    ASSERT_EQ(1, entries.count());
+    EXPECT_EQ(sequences.last(), entries[0].sequence);
+    EXPECT_EQ(labels.last(), entries[0].data);
+
+    spool->markDone(sequences.last());
+    EXPECT_EQ(0, spool->pendingCount());
+    restored.reset();
+    restored = PrintSpool::open(crashCopy(spool, dir.filePath("crashed.spool")));
+    ASSERT_TRUE(restored);
+    EXPECT_EQ(0, restored->pendingCount());
+}
+
+TEST(PrintSpoolTest, printAlwaysCompletesEntry)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    auto spool = PrintSpool::open(dir.filePath("labels.spool"));
+    ASSERT_TRUE(spool);
+
+    QByteArray sent;
+    auto result = spool->print("label", [&sent](const QByteArray &data) {
+        sent = data;
+        Promise<bool> promise;
+        promise.failure(Failure("offline", UTILS_MODULE_CODE, UtilsErrorCode::PrinterOffline));
+        return CancelableFuture<bool>(promise);
+    });
+    result.wait(5000);
+    ASSERT_TRUE(result.isCompleted());
+    EXPECT_TRUE(result.isFailed());
+    EXPECT_EQ("label", sent);
+    EXPECT_EQ(0, spool->pendingCount());
+}
+
+TEST(PrintSpoolTest, spoolKeepsUnprintedUntilReplay)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    auto spool = PrintSpool::open(dir.filePath("labels.spool"));
+    ASSERT_TRUE(spool);
+
+    Promise<bool> printed;
+    auto acknowledged = spool->spool("first", [printed](const QByteArray &) { return printed.future(); });
+    acknowledged.wait(5000);
+    ASSERT_TRUE(acknowledged.isCompleted());
+    EXPECT_TRUE(acknowledged.result());
+    EXPECT_EQ(1, spool->pendingCount());
+    printed.failure(Failure("offline", UTILS_MODULE_CODE, UtilsErrorCode::PrinterOffline));
+    EXPECT_EQ(1, spool->pendingCount());
+
+    auto second = spool->spool("second", [](const QByteArray &) { return Future<bool>::successful(true); });
+    second.wait(5000);
+    ASSERT_TRUE(second.isCompleted());
+    EXPECT_EQ(1, spool->pendingCount());
+
+    QVector<QByteArray> replayed;
+    auto replay = spool->replay([&replayed](const QByteArray &data) {
+        replayed << data;
+        return Future<bool>::successful(true);
+    });
+    replay.wait(5000);
+    ASSERT_TRUE(replay.isCompleted());
+    EXPECT_TRUE(replay.result());
+    ASSERT_EQ(1, replayed.count());
+    EXPECT_EQ("first", replayed[0]);
+    EXPECT_EQ(0, spool->pendingCount());
+}
+
+TEST(PrintSpoolTest, sameFileIsShared)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    auto spool = PrintSpool::open(dir.filePath("labels.spool"));
+    ASSERT_TRUE(spool);
+    appendLabels(spool, {"label"});
+
+    auto another = PrintSpool::open(dir.filePath("./labels.spool"));
+    EXPECT_EQ(spool, another);
+    EXPECT_EQ(1, another->pendingCount());
+}
+
+TEST(PrintSpoolTest, replaySkipsLabelsBeingSent)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    auto spool = PrintSpool::open(dir.filePath("labels.spool"));
+    ASSERT_TRUE(spool);
+
+    Promise<bool> printed;
+    auto acknowledged = spool->spool("first", [printed](const QByteArray &) { return printed.future(); });
+    acknowledged.wait(5000);
+    ASSERT_TRUE(acknowledged.isCompleted());
+    EXPECT_EQ(1, spool->pendingCount());
+
+    int replayed = 0;
+    auto replay = spool->replay([&replayed](const QByteArray &) {
+        ++replayed;
+        return Future<bool>::successful(true);
+    });
+    replay.wait(5000);
+    ASSERT_TRUE(replay.isCompleted());
+    EXPECT_TRUE(replay.result());
+    EXPECT_EQ(0, replayed);
+    EXPECT_EQ(1, spool->pendingCount());
+
+    printed.success(true);
+    EXPECT_EQ(0, spool->pendingCount());
+}
+
+TEST(PrintSpoolTest, cancelPrint)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    auto spool = PrintSpool::open(dir.filePath("labels.spool"));
+    ASSERT_TRUE(spool);
+
+    Promise<bool> sent;
+    Promise<bool> printed;
+    auto result = spool->print("label", [sent, printed](const QByteArray &) {
+        sent.success(true);
+        return CancelableFuture<bool>(printed);
+    });
+    sent.future().wait(5000);
+    ASSERT_TRUE(sent.isFilled());
+    result.cancel();
+    printed.future().wait(1000);
+    ASSERT_TRUE(printed.isFilled());
+    EXPECT_TRUE(printed.future().isFailed());
+    result.wait(1000);
+    ASSERT_TRUE(result.isCompleted());
+    EXPECT_TRUE(result.isFailed());
+    EXPECT_EQ(0, spool->pendingCount());
+}
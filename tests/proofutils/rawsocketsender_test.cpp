@@ -0,0 +1,104 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+// clazy:skip
+
+#include "proofutils/rawsocketsender_p.h"
+
+#include "gtest/proof/test_global.h"
+
+#include <QAtomicInteger>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+
+using namespace Proof;
+
+TEST(RawSocketSenderTest, sendFile)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    QString fileName = dir.filePath("batch.epl");
+    QByteArray content;
+    for (int i = 0; i < 50000; ++i)
+        content.append(QByteArray::number(i)).append('\n');
+    QFile file(fileName);
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write(content);
+    file.close();
+
+    QTcpServer server;
+    ASSERT_TRUE(server.listen(QHostAddress::LocalHost));
+    QAtomicInteger<qint64> lastSent = 0;
+    QAtomicInteger<qint64> lastTotal = 0;
+    auto f = RawSocketSender::sendFile("127.0.0.1", server.serverPort(), fileName, 3, Promise<bool>().future(),
+                                       [&lastSent, &lastTotal](qint64 sent, qint64 total) {
+                                           lastSent = sent;
+                                           lastTotal = total;
+                                       });
+    ASSERT_TRUE(server.waitForNewConnection(5000));
+    QTcpSocket *socket = server.nextPendingConnection();
+    ASSERT_TRUE(socket);
+    QByteArray received;
+    while (received.size() < content.size() * 3 && socket->waitForReadyRead(5000))
+        received.append(socket->readAll());
+
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    ASSERT_TRUE(f.isSucceeded());
+    EXPECT_EQ(content.repeated(3), received);
+    EXPECT_EQ(content.size() * 3, lastSent.load());
+    EXPECT_EQ(content.size() * 3, lastTotal.load());
+}
+
+TEST(RawSocketSenderTest, connectionRefused)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    QString fileName = dir.filePath("batch.epl");
+    QFile file(fileName);
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write("label");
+    file.close();
+
+    QTcpServer server;
+    ASSERT_TRUE(server.listen(QHostAddress::LocalHost));
+    quint16 port = server.serverPort();
+    server.close();
+    auto f = RawSocketSender::sendFile("127.0.0.1", port, fileName, 1, Promise<bool>().future(), {}, 1000);
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    ASSERT_TRUE(f.isFailed());
+    EXPECT_EQ(UtilsErrorCode::PrinterConnectionError, f.failureReason().errorCode);
+}
+
+TEST(RawSocketSenderTest, missingFile)
+{
+    auto f = RawSocketSender::sendFile("127.0.0.1", 9100, "/proof/this/file/does/not/exist", 1,
+                                       Promise<bool>().future());
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    ASSERT_TRUE(f.isFailed());
+    EXPECT_EQ(UtilsErrorCode::PrintFileCannotBeOpened, f.failureReason().errorCode);
+}
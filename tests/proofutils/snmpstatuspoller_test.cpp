@@ -0,0 +1,156 @@
+/* Copyright 2019, OpenSoft Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice, this list of
+ * conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ *     * Neither the name of OpenSoft Inc. nor the names of its contributors may be used to endorse
+ * or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+// clazy:skip
+
+#include "proofutils/snmpstatuspoller_p.h"
+
+#include "gtest/proof/test_global.h"
+
+#include "fakesnmpagent.h"
+
+using namespace Proof;
+
+TEST(SnmpStatusPollerTest, encodeDecode)
+{
+    SnmpMessage message;
+    message.community = "private";
+    message.pduType = SnmpMessage::GetResponse;
+    message.requestId = 123456789;
+    message.varBinds = {SnmpVarBind{SnmpPrinterStatus::HR_DEVICE_STATUS_OID, qint64(2)},
+                        SnmpVarBind{"1.3.6.1.2.1.1.1.0", QByteArray(200, 'a')},
+                        SnmpVarBind{"1.3.6.1.4.1.99999.1", qint64(-129)},
+                        SnmpVarBind{"1.3.6.1.4.1.99999.2", QVariant()}};
+    QByteArray encoded = message.encode();
+    SnmpMessage decoded;
+    ASSERT_TRUE(SnmpMessage::decode(encoded, &decoded));
+    EXPECT_EQ("private", decoded.community);
+    EXPECT_EQ(SnmpMessage::GetResponse, decoded.pduType);
+    EXPECT_EQ(123456789, decoded.requestId);
+    ASSERT_EQ(4, decoded.varBinds.count());
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(message.varBinds[i].oid, decoded.varBinds[i].oid) << i;
+        EXPECT_EQ(message.varBinds[i].value, decoded.varBinds[i].value) << i;
+    }
+    EXPECT_FALSE(SnmpMessage::decode(encoded.left(encoded.size() - 3), &decoded));
+    EXPECT_FALSE(SnmpMessage::decode("garbage", &decoded));
+}
+
+TEST(SnmpStatusPollerTest, encodeRequest)
+{
+    SnmpMessage message;
+    message.community = "public";
+    message.requestId = 1;
+    message.varBinds = {SnmpVarBind{"1.3.6.1.2.1.1.1.0", QVariant()}};
+    QByteArray expected = QByteArray::fromHex("302602010104067075626c6963a01902010102010002010030"
+                                              "0e300c06082b060102010101000500");
+    EXPECT_EQ(expected.toHex(), message.encode().toHex());
+}
+
+TEST(SnmpStatusPollerTest, printerStatus)
+{
+    SnmpPrinterStatus status;
+    status.deviceStatus = SnmpPrinterStatus::DeviceStatus::Running;
+    status.printerStatus = SnmpPrinterStatus::PrinterStatus::Idle;
+    status.detectedErrorState = QByteArray(1, '\0');
+    EXPECT_TRUE(status.isReady());
+    EXPECT_TRUE(status.errors().isEmpty());
+
+    status.deviceStatus = SnmpPrinterStatus::DeviceStatus::Warning;
+    status.detectedErrorState = QByteArray(1, static_cast<char>(0x80));
+    EXPECT_TRUE(status.isReady());
+    EXPECT_EQ(QStringList{"lowPaper"}, status.errors());
+
+    status.detectedErrorState = QByteArray::fromHex("0440");
+    EXPECT_FALSE(status.isReady());
+    EXPECT_EQ((QStringList{"jammed", "outputTrayMissing"}), status.errors());
+    EXPECT_EQ("jammed, outputTrayMissing", status.reason());
+
+    status.detectedErrorState = QByteArray(1, '\0');
+    status.deviceStatus = SnmpPrinterStatus::DeviceStatus::Down;
+    EXPECT_FALSE(status.isReady());
+    EXPECT_EQ("device down", status.reason());
+}
+
+TEST(SnmpStatusPollerTest, fetchStatus)
+{
+    FakeSnmpAgent agent;
+    agent.setStatus(SnmpPrinterStatus::DeviceStatus::Down, SnmpPrinterStatus::PrinterStatus::Other,
+                    QByteArray::fromHex("02"));
+    auto f = SnmpStatusPoller::instance()->fetchStatus("127.0.0.1", agent.port());
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    ASSERT_TRUE(f.isSucceeded());
+    EXPECT_EQ(SnmpPrinterStatus::DeviceStatus::Down, f.result().deviceStatus);
+    EXPECT_EQ(SnmpPrinterStatus::PrinterStatus::Other, f.result().printerStatus);
+    EXPECT_EQ(QStringList{"offline"}, f.result().errors());
+    EXPECT_FALSE(f.result().isReady());
+    EXPECT_EQ(1, agent.requestsCount());
+}
+
+TEST(SnmpStatusPollerTest, concurrentRequests)
+{
+    FakeSnmpAgent agent;
+    agent.setLatency(100);
+    QVector<Future<SnmpPrinterStatus>> futures;
+    for (int i = 0; i < 10; ++i)
+        futures << SnmpStatusPoller::instance()->fetchStatus("127.0.0.1", agent.port());
+    for (const auto &f : futures) {
+        f.wait(5000);
+        ASSERT_TRUE(f.isCompleted());
+        ASSERT_TRUE(f.isSucceeded());
+        EXPECT_TRUE(f.result().isReady());
+    }
+    EXPECT_EQ(1, agent.requestsCount());
+}
+
+TEST(SnmpStatusPollerTest, retry)
+{
+    FakeSnmpAgent agent;
+    agent.setDroppedRequests(1);
+    SnmpStatusPoller poller;
+    poller.setTimeout(200);
+    poller.setRetries(1);
+    auto f = poller.fetchStatus("127.0.0.1", agent.port());
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    ASSERT_TRUE(f.isSucceeded());
+    EXPECT_TRUE(f.result().isReady());
+    EXPECT_EQ(2, agent.requestsCount());
+}
+
+TEST(SnmpStatusPollerTest, timeout)
+{
+    FakeSnmpAgent agent;
+    agent.setDroppedRequests(100);
+    SnmpStatusPoller poller;
+    poller.setTimeout(100);
+    poller.setRetries(2);
+    auto f = poller.fetchStatus("127.0.0.1", agent.port());
+    f.wait(5000);
+    ASSERT_TRUE(f.isCompleted());
+    ASSERT_TRUE(f.isFailed());
+    EXPECT_EQ(UtilsErrorCode::PrinterInfoCannotBeQueried, f.failureReason().errorCode);
+    EXPECT_EQ(3, agent.requestsCount());
+}